@@ -0,0 +1,414 @@
+#include "BlockCompress.h"
+
+#include <math.h>
+#include <string.h>
+
+// BC7 4-bit index interpolation weights (out of 64)
+static const int s_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static inline int clampInt(int value, int low, int high)
+{
+    return (value < low) ? low : (value > high) ? high : value;
+}
+
+// copy a 4x4 block out of the level, repeating the last row/column at the edges
+static void fetchBlock(const uint8_t* rgba, int width, int height, int blockX, int blockY, uint8_t block[64])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = clampInt(blockY * 4 + y, 0, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = clampInt(blockX * 4 + x, 0, width - 1);
+            memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+        }
+    }
+}
+
+// principal axis of the block colors (first `channels` components),
+// returns the mean and the axis and the projected extent along it
+static void principalAxis(const uint8_t block[64], int channels, float mean[4], float axis[4], float& tMin, float& tMax)
+{
+    for (int c = 0; c < 4; c++)
+        mean[c] = 0.0f;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            mean[c] += block[i * 4 + c];
+    for (int c = 0; c < channels; c++)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[4];
+        for (int c = 0; c < channels; c++)
+            d[c] = block[i * 4 + c] - mean[c];
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                covariance[a][b] += d[a] * d[b];
+    }
+
+    // power iteration, starting from the grey diagonal
+    for (int c = 0; c < 4; c++)
+        axis[c] = (c < channels) ? 1.0f : 0.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++)
+            length += next[c] * next[c];
+        if (length < 1e-8f)
+            break;
+        length = 1.0f / sqrtf(length);
+        for (int c = 0; c < channels; c++)
+            axis[c] = next[c] * length;
+    }
+
+    tMin = 1e30f;
+    tMax = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (block[i * 4 + c] - mean[c]) * axis[c];
+        tMin = (t < tMin) ? t : tMin;
+        tMax = (t > tMax) ? t : tMax;
+    }
+}
+
+// BC1 -----------------------------------------------------------------------
+
+static inline uint16_t packRgb565(const float color[4])
+{
+    int r = clampInt((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = clampInt((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = clampInt((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpackRgb565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void compressBC1Block(const uint8_t block[64], uint8_t out[8])
+{
+    float mean[4], axis[4], tMin, tMax;
+    principalAxis(block, 3, mean, axis, tMin, tMax);
+
+    float high[4], low[4];
+    for (int c = 0; c < 4; c++)
+    {
+        high[c] = mean[c] + axis[c] * tMax;
+        low[c] = mean[c] + axis[c] * tMin;
+    }
+
+    uint16_t color0 = packRgb565(high);
+    uint16_t color1 = packRgb565(low);
+    // color0 > color1 selects the four color mode
+    if (color0 < color1)
+    {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestError = 0x7fffffff;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+
+    out[0] = (uint8_t)(color0 & 0xff);
+    out[1] = (uint8_t)(color0 >> 8);
+    out[2] = (uint8_t)(color1 & 0xff);
+    out[3] = (uint8_t)(color1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+// BC4 / BC5 -----------------------------------------------------------------
+
+static void compressBC4Block(const uint8_t block[64], int channel, uint8_t out[8])
+{
+    int high = 0, low = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        int v = block[i * 4 + channel];
+        high = (v > high) ? v : high;
+        low = (v < low) ? v : low;
+    }
+
+    // high > low selects the eight value ramp: 0 = high, 1 = low, 2..7 in between
+    uint64_t indices = 0;
+    if (high != low)
+    {
+        int range = high - low;
+        for (int i = 0; i < 16; i++)
+        {
+            int v = block[i * 4 + channel];
+            int step = ((high - v) * 7 + range / 2) / range;
+            int index = (step == 0) ? 0 : (step == 7) ? 1 : step + 1;
+            indices |= (uint64_t)index << (i * 3);
+        }
+    }
+
+    out[0] = (uint8_t)high;
+    out[1] = (uint8_t)low;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+static void compressBC5Block(const uint8_t block[64], uint8_t out[16])
+{
+    compressBC4Block(block, 0, out);
+    compressBC4Block(block, 1, out + 8);
+}
+
+// BC7 mode 6 ----------------------------------------------------------------
+
+struct BC7Endpoints
+{
+    int value[2][4];    // 7-bit endpoint per channel
+    int pbit[2];
+};
+
+// quantize a float endpoint to 7 bits + shared p-bit, picking the better p-bit
+static void quantizeBC7Endpoint(const float color[4], int value[4], int& pbit)
+{
+    int bestError = 0x7fffffff;
+    for (int p = 0; p < 2; p++)
+    {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c] = clampInt((int)floorf((color[c] - p) * 0.5f + 0.5f), 0, 127);
+            int d = ((candidate[c] << 1) | p) - (int)(color[c] + 0.5f);
+            error += d * d;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            pbit = p;
+            memcpy(value, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// choose the best index per pixel, returns the total squared error
+static int assignBC7Indices(const uint8_t block[64], const BC7Endpoints& endpoints, int indices[16])
+{
+    int palette[16][4];
+    for (int c = 0; c < 4; c++)
+    {
+        int e0 = (endpoints.value[0][c] << 1) | endpoints.pbit[0];
+        int e1 = (endpoints.value[1][c] << 1) | endpoints.pbit[1];
+        for (int i = 0; i < 16; i++)
+            palette[i][c] = ((64 - s_bc7Weights[i]) * e0 + s_bc7Weights[i] * e1 + 32) >> 6;
+    }
+
+    int totalError = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int bestError = 0x7fffffff;
+        for (int p = 0; p < 16; p++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int d = block[i * 4 + c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = p;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+// least squares endpoints for a fixed set of indices
+static bool refitBC7Endpoints(const uint8_t block[64], const int indices[16], float e0[4], float e1[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float w = s_bc7Weights[indices[i]] / 64.0f;
+        float a = 1.0f - w;
+        aa += a * a;
+        ab += a * w;
+        bb += w * w;
+        for (int c = 0; c < 4; c++)
+        {
+            ax[c] += a * block[i * 4 + c];
+            bx[c] += w * block[i * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f)
+        return false;
+    determinant = 1.0f / determinant;
+    for (int c = 0; c < 4; c++)
+    {
+        e0[c] = (ax[c] * bb - bx[c] * ab) * determinant;
+        e1[c] = (bx[c] * aa - ax[c] * ab) * determinant;
+        e0[c] = (e0[c] < 0.0f) ? 0.0f : (e0[c] > 255.0f) ? 255.0f : e0[c];
+        e1[c] = (e1[c] < 0.0f) ? 0.0f : (e1[c] > 255.0f) ? 255.0f : e1[c];
+    }
+    return true;
+}
+
+static inline void writeBits(uint8_t out[16], int& position, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++, position++)
+    {
+        if (value & (1u << i))
+            out[position >> 3] |= (uint8_t)(1u << (position & 7));
+    }
+}
+
+static void compressBC7Block(const uint8_t block[64], uint8_t out[16])
+{
+    float mean[4], axis[4], tMin, tMax;
+    principalAxis(block, 4, mean, axis, tMin, tMax);
+
+    float e0[4], e1[4];
+    for (int c = 0; c < 4; c++)
+    {
+        e0[c] = mean[c] + axis[c] * tMin;
+        e1[c] = mean[c] + axis[c] * tMax;
+        e0[c] = (e0[c] < 0.0f) ? 0.0f : (e0[c] > 255.0f) ? 255.0f : e0[c];
+        e1[c] = (e1[c] < 0.0f) ? 0.0f : (e1[c] > 255.0f) ? 255.0f : e1[c];
+    }
+
+    BC7Endpoints endpoints;
+    quantizeBC7Endpoint(e0, endpoints.value[0], endpoints.pbit[0]);
+    quantizeBC7Endpoint(e1, endpoints.value[1], endpoints.pbit[1]);
+    int indices[16];
+    int error = assignBC7Indices(block, endpoints, indices);
+
+    // one least squares pass usually buys a few dB over the bounding endpoints
+    if (error > 0 && refitBC7Endpoints(block, indices, e0, e1))
+    {
+        BC7Endpoints refined;
+        int refinedIndices[16];
+        quantizeBC7Endpoint(e0, refined.value[0], refined.pbit[0]);
+        quantizeBC7Endpoint(e1, refined.value[1], refined.pbit[1]);
+        int refinedError = assignBC7Indices(block, refined, refinedIndices);
+        if (refinedError < error)
+        {
+            endpoints = refined;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // the anchor (first) index is stored without its top bit, so it must be < 8
+    if (indices[0] & 8)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int swap = endpoints.value[0][c];
+            endpoints.value[0][c] = endpoints.value[1][c];
+            endpoints.value[1][c] = swap;
+        }
+        int swap = endpoints.pbit[0];
+        endpoints.pbit[0] = endpoints.pbit[1];
+        endpoints.pbit[1] = swap;
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    memset(out, 0, 16);
+    int position = 0;
+    writeBits(out, position, 1u << 6, 7);   // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        writeBits(out, position, endpoints.value[0][c], 7);
+        writeBits(out, position, endpoints.value[1][c], 7);
+    }
+    writeBits(out, position, endpoints.pbit[0], 1);
+    writeBits(out, position, endpoints.pbit[1], 1);
+    writeBits(out, position, indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        writeBits(out, position, indices[i], 4);
+}
+
+// ---------------------------------------------------------------------------
+
+size_t BlockBytes(BlockFormat format)
+{
+    return (format == BLOCK_BC1) ? 8 : 16;
+}
+
+size_t CompressedLevelSize(BlockFormat format, int width, int height)
+{
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * BlockBytes(format);
+}
+
+void CompressLevel(BlockFormat format, const uint8_t* rgba, int width, int height, uint8_t* out)
+{
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockBytes = BlockBytes(format);
+
+    uint8_t block[64];
+    for (int by = 0; by < blocksY; by++)
+    {
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            fetchBlock(rgba, width, height, bx, by, block);
+            switch (format)
+            {
+            case BLOCK_BC1: compressBC1Block(block, out); break;
+            case BLOCK_BC5: compressBC5Block(block, out); break;
+            case BLOCK_BC7: compressBC7Block(block, out); break;
+            }
+            out += blockBytes;
+        }
+    }
+}
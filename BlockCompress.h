@@ -0,0 +1,22 @@
+#ifndef BLOCKCOMPRESS_H
+#define BLOCKCOMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CPU block compressors used by the texture cooker. Each takes one RGBA8
+// level (width x height, tightly packed) and writes 4x4 blocks row by row,
+// clamping at the edges so non multiple-of-4 mips are handled.
+
+enum BlockFormat
+{
+    BLOCK_BC1,  // RGB, 8 bytes per block
+    BLOCK_BC5,  // two channels (normal XY) from R and G, 16 bytes per block
+    BLOCK_BC7   // RGBA, mode 6 only, 16 bytes per block
+};
+
+size_t BlockBytes(BlockFormat format);
+size_t CompressedLevelSize(BlockFormat format, int width, int height);
+void CompressLevel(BlockFormat format, const uint8_t* rgba, int width, int height, uint8_t* out);
+
+#endif // BLOCKCOMPRESS_H
@@ -0,0 +1,196 @@
+#pragma once
+#ifndef CAMERA_CONTROLLER_H
+#define CAMERA_CONTROLLER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <math.h>
+
+#include "camera.h"
+#include "Frustum.h"
+#include "Input.h"
+
+#define CAMERA_FIXED_STEP (1.0 / 120.0)
+#define CAMERA_MAX_STEPS 12             // per update; a longer hitch drops time instead of catching up
+#define CAMERA_ACCELERATION 12.0f       // 1/s, how quickly velocity follows the keys
+#define CAMERA_BOOST 10.0f              // speed factor while shift is held
+
+// Free-fly controller on top of Camera. Mouse look (right button held)
+// applies once per frame from raw deltas; WASD/QE movement is integrated
+// at a fixed CAMERA_FIXED_STEP so speed and feel do not depend on the frame
+// rate, and the position handed out is interpolated between the last two
+// steps. View, projection, their product, the inverses and the frustum
+// are cached and only rebuilt when something they depend on changed.
+class CameraController
+{
+public:
+    explicit CameraController(Camera& camera)
+        : camera(camera), velocity(0.0f), accumulator(0.0),
+          previousPosition(camera.Position), renderPosition(camera.Position),
+          viewDirty(true), projectionDirty(true), combinedDirty(true)
+    {
+        setProjection(45.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+    }
+
+    CameraController(const CameraController&) = delete;
+    CameraController& operator=(const CameraController&) = delete;
+
+    // ------------------------------------------------------------------------
+    void setProjection(float fovDegrees, float aspect, float nearPlane, float farPlane)
+    {
+        projection = glm::perspective(glm::radians(fovDegrees), aspect, nearPlane, farPlane);
+        projectionDirty = true;
+        combinedDirty = true;
+    }
+    // place the camera looking at target, dropping any motion in progress
+    // ------------------------------------------------------------------------
+    void lookAt(const glm::vec3& eye, const glm::vec3& target)
+    {
+        glm::vec3 direction = glm::normalize(target - eye);
+        camera.Position = eye;
+        camera.SetOrientation(glm::degrees(atan2f(direction.z, direction.x)), glm::degrees(asinf(glm::clamp(direction.y, -1.0f, 1.0f))));
+        previousPosition = renderPosition = eye;
+        velocity = glm::vec3(0.0f);
+        accumulator = 0.0;
+        viewDirty = true;
+    }
+    // frameTime in seconds since the last update, reads the Input state
+    // ------------------------------------------------------------------------
+    void update(double frameTime)
+    {
+        glm::vec2 mouse = Input::GetMouseDelta();
+        if (Input::IsButtonDown(MOUSE_RIGHT) && (mouse.x != 0.0f || mouse.y != 0.0f))
+        {
+            camera.ProcessMouseMovement(mouse.x, -mouse.y);
+            viewDirty = true;
+        }
+
+        accumulator += frameTime;
+        int steps = 0;
+        while (accumulator >= CAMERA_FIXED_STEP && steps < CAMERA_MAX_STEPS)
+        {
+            previousPosition = camera.Position;
+            step((float)CAMERA_FIXED_STEP);
+            accumulator -= CAMERA_FIXED_STEP;
+            steps++;
+        }
+        if (accumulator >= CAMERA_FIXED_STEP)
+            accumulator = 0.0;
+
+        glm::vec3 position = glm::mix(previousPosition, camera.Position, (float)(accumulator / CAMERA_FIXED_STEP));
+        if (position != renderPosition)
+        {
+            renderPosition = position;
+            viewDirty = true;
+        }
+    }
+    // ------------------------------------------------------------------------
+    const glm::vec3& getPosition() const
+    {
+        return renderPosition;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getView() const
+    {
+        refresh();
+        return view;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getProjection() const
+    {
+        return projection;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getViewProjection() const
+    {
+        refresh();
+        return viewProjection;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getInverseView() const
+    {
+        refresh();
+        return inverseView;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getInverseProjection() const
+    {
+        refresh();
+        return inverseProjection;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4& getInverseViewProjection() const
+    {
+        refresh();
+        return inverseViewProjection;
+    }
+    // world-space planes of the current view-projection
+    // ------------------------------------------------------------------------
+    const Frustum& getFrustum() const
+    {
+        refresh();
+        return frustum;
+    }
+
+private:
+    Camera& camera;
+    glm::vec3 velocity;
+    double accumulator;
+    glm::vec3 previousPosition;
+    glm::vec3 renderPosition;
+
+    glm::mat4 projection;
+    mutable glm::mat4 view;
+    mutable glm::mat4 viewProjection;
+    mutable glm::mat4 inverseView;
+    mutable glm::mat4 inverseProjection;
+    mutable glm::mat4 inverseViewProjection;
+    mutable Frustum frustum;
+    mutable bool viewDirty;
+    mutable bool projectionDirty;
+    mutable bool combinedDirty;
+
+    void step(float dt)
+    {
+        glm::vec3 wish(0.0f);
+        if (Input::IsKeyDown('W')) wish += camera.Front;
+        if (Input::IsKeyDown('S')) wish -= camera.Front;
+        if (Input::IsKeyDown('D')) wish += camera.Right;
+        if (Input::IsKeyDown('A')) wish -= camera.Right;
+        if (Input::IsKeyDown('E')) wish += camera.WorldUp;
+        if (Input::IsKeyDown('Q')) wish -= camera.WorldUp;
+        if (glm::dot(wish, wish) > 0.0f)
+            wish = glm::normalize(wish) * camera.MovementSpeed * (Input::IsKeyDown(VK_SHIFT) ? CAMERA_BOOST : 1.0f);
+
+        // exponential approach, the same response at any step length
+        velocity += (wish - velocity) * (1.0f - expf(-CAMERA_ACCELERATION * dt));
+        camera.Position += velocity * dt;
+    }
+
+    void refresh() const
+    {
+        if (viewDirty)
+        {
+            view = glm::lookAt(renderPosition, renderPosition + camera.Front, camera.Up);
+            inverseView = glm::inverse(view);
+            viewDirty = false;
+            combinedDirty = true;
+        }
+        if (projectionDirty)
+        {
+            inverseProjection = glm::inverse(projection);
+            projectionDirty = false;
+        }
+        if (combinedDirty)
+        {
+            viewProjection = projection * view;
+            inverseViewProjection = inverseView * inverseProjection;
+            frustum = Frustum::FromMatrix(viewProjection);
+            combinedDirty = false;
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,282 @@
+#pragma once
+#ifndef CLOUD_NOISE_H
+#define CLOUD_NOISE_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <stdint.h>
+
+#include "Shader.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include "Logger.h"
+
+// sizes the generators are written for (perlinworley.comp, worley.comp, weather.comp)
+#define CLOUD_NOISE_SHAPE_SIZE 128
+#define CLOUD_NOISE_DETAIL_SIZE 32
+#define CLOUD_NOISE_WEATHER_SIZE 1024
+// work units: weather tiles of this size, volume slabs this many slices deep
+#define CLOUD_NOISE_WEATHER_TILE 128
+#define CLOUD_NOISE_SLAB 4
+// generator tunables, specialization constants of the shaders (see ShaderConstant):
+// workgroup sides (the slab and the tile must be multiples) and the shape's perlin octaves
+#define CLOUD_NOISE_VOLUME_GROUP 4
+#define CLOUD_NOISE_WEATHER_GROUP 16
+#define CLOUD_NOISE_PERLIN_OCTAVES 3
+// a new weather map fades in over this long
+#define CLOUD_NOISE_BLEND_SECONDS 4.0f
+// frames of GPU timestamps in flight, read back without waiting
+#define CLOUD_NOISE_TIMING_FRAMES 4
+// texture units bind() uses for volumetric_clouds.comp
+#define CLOUD_NOISE_SHAPE_UNIT 4
+#define CLOUD_NOISE_DETAIL_UNIT 5
+#define CLOUD_NOISE_WEATHER_UNIT 6
+#define CLOUD_NOISE_PREVIOUS_WEATHER_UNIT 7
+
+// Cloud noise textures generated incrementally instead of in one stall.
+// The two noise volumes and the weather map are split into work units (a
+// tile of the map, a slab of slices of a volume) and update() dispatches
+// as many as fit in a per-frame GPU millisecond budget. The cost of a unit
+// is measured per generator with timestamp queries a few frames later, so
+// the budget holds on any GPU without a readback stall.
+// The weather map is double buffered: a regeneration fills the hidden map
+// while clouds keep sampling the visible one, then the two swap and the
+// clouds shader cross-fades between them over CLOUD_NOISE_BLEND_SECONDS.
+// The volumes have no parameters, they are only built once (sliced too).
+class CloudNoise
+{
+public:
+    CloudNoise()
+        : shapeShader("shaders/perlinworley.comp", { { "GROUP_SIZE", 0, CLOUD_NOISE_VOLUME_GROUP }, { "GROUP_SIZE", 1, CLOUD_NOISE_VOLUME_GROUP },
+              { "GROUP_SIZE", 2, CLOUD_NOISE_VOLUME_GROUP }, { "PERLIN_OCTAVES", 3, CLOUD_NOISE_PERLIN_OCTAVES } }),
+          detailShader("shaders/worley.comp", { { "GROUP_SIZE", 0, CLOUD_NOISE_VOLUME_GROUP }, { "GROUP_SIZE", 1, CLOUD_NOISE_VOLUME_GROUP },
+              { "GROUP_SIZE", 2, CLOUD_NOISE_VOLUME_GROUP } }),
+          weatherShader("shaders/weather.comp", { { "TILE_SIZE", 0, CLOUD_NOISE_WEATHER_GROUP }, { "TILE_SIZE", 1, CLOUD_NOISE_WEATHER_GROUP } }),
+          shape(GL_TEXTURE_3D), detail(GL_TEXTURE_3D), front(0), blend(1.0f), weatherValid(false),
+          seed(0.0f), frame(0)
+    {
+        shape.storage3D(Levels(CLOUD_NOISE_SHAPE_SIZE), GL_RGBA8, CLOUD_NOISE_SHAPE_SIZE, CLOUD_NOISE_SHAPE_SIZE, CLOUD_NOISE_SHAPE_SIZE);
+        detail.storage3D(Levels(CLOUD_NOISE_DETAIL_SIZE), GL_RGBA8, CLOUD_NOISE_DETAIL_SIZE, CLOUD_NOISE_DETAIL_SIZE, CLOUD_NOISE_DETAIL_SIZE);
+        GLTexture* volumes[2] = { &shape, &detail };
+        for (int i = 0; i < 2; i++)
+        {
+            volumes[i]->parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            volumes[i]->parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            volumes[i]->parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+            volumes[i]->parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+            volumes[i]->parameter(GL_TEXTURE_WRAP_R, GL_REPEAT);
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            weather[i].reset(new GLTexture(GL_TEXTURE_2D));
+            weather[i]->storage2D(1, GL_RGBA8, CLOUD_NOISE_WEATHER_SIZE, CLOUD_NOISE_WEATHER_SIZE);
+            weather[i]->parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            weather[i]->parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            weather[i]->parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+            weather[i]->parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+        }
+
+        int weatherTiles = CLOUD_NOISE_WEATHER_SIZE / CLOUD_NOISE_WEATHER_TILE;
+        jobs[JOB_SHAPE] = { &shapeShader, CLOUD_NOISE_SHAPE_SIZE / CLOUD_NOISE_SLAB, 0, 0.0 };
+        jobs[JOB_DETAIL] = { &detailShader, CLOUD_NOISE_DETAIL_SIZE / CLOUD_NOISE_SLAB, 0, 0.0 };
+        jobs[JOB_WEATHER] = { &weatherShader, weatherTiles * weatherTiles, 0, 0.0 };
+
+        glCreateQueries(GL_TIMESTAMP, 2 * CLOUD_NOISE_TIMING_FRAMES, &timestamps[0][0]);
+        for (int i = 0; i < CLOUD_NOISE_TIMING_FRAMES; i++)
+            timings[i].units = 0;
+    }
+
+    ~CloudNoise()
+    {
+        glDeleteQueries(2 * CLOUD_NOISE_TIMING_FRAMES, &timestamps[0][0]);
+    }
+
+    CloudNoise(const CloudNoise&) = delete;
+    CloudNoise& operator=(const CloudNoise&) = delete;
+
+    // start filling the hidden weather map from a new seed; restarts a
+    // regeneration still in progress, the visible map is never touched
+    // ------------------------------------------------------------------------
+    void regenerateWeather(const glm::vec3& weatherSeed)
+    {
+        seed = weatherSeed;
+        jobs[JOB_WEATHER].done = 0;
+    }
+    // advance the fade and generate what fits in budgetMs of GPU time
+    // ------------------------------------------------------------------------
+    void update(float budgetMs, float deltaTime)
+    {
+        collectTimings();
+
+        blend += deltaTime / CLOUD_NOISE_BLEND_SECONDS;
+        if (blend > 1.0f)
+            blend = 1.0f;
+
+        // volumes first, the weather map only once the hidden one is no longer faded from
+        int active = -1;
+        for (int i = 0; i < JOB_COUNT && active < 0; i++)
+        {
+            if (jobs[i].done < jobs[i].units && (i != JOB_WEATHER || blend >= 1.0f))
+                active = i;
+        }
+
+        int slot = (int)(frame % CLOUD_NOISE_TIMING_FRAMES);
+        frame++;
+        if (active < 0)
+            return;
+
+        // one unit until the first measurement, at least one so it always finishes
+        Job& job = jobs[active];
+        int units = 1;
+        if (job.msPerUnit > 0.0 && budgetMs / job.msPerUnit > 1.0)
+            units = (int)(budgetMs / job.msPerUnit);
+        if (units > job.units - job.done)
+            units = job.units - job.done;
+
+        // a slot whose results never came back is reused, its numbers are lost
+        timings[slot].job = active;
+        timings[slot].units = units;
+        glQueryCounter(timestamps[slot][0], GL_TIMESTAMP);
+
+        job.shader->use();
+        if (active == JOB_WEATHER)
+        {
+            GLuint target = weather[1 - front]->ID;
+            job.shader->setVec3("seed", seed);
+            glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            int tilesPerRow = CLOUD_NOISE_WEATHER_SIZE / CLOUD_NOISE_WEATHER_TILE;
+            for (int i = 0; i < units; i++, job.done++)
+            {
+                int x = (job.done % tilesPerRow) * CLOUD_NOISE_WEATHER_TILE;
+                int y = (job.done / tilesPerRow) * CLOUD_NOISE_WEATHER_TILE;
+                glProgramUniform2i(job.shader->ID, glGetUniformLocation(job.shader->ID, "u_offset"), x, y);
+                glDispatchCompute(CLOUD_NOISE_WEATHER_TILE / CLOUD_NOISE_WEATHER_GROUP, CLOUD_NOISE_WEATHER_TILE / CLOUD_NOISE_WEATHER_GROUP, 1);
+            }
+        }
+        else
+        {
+            GLTexture& volume = active == JOB_SHAPE ? shape : detail;
+            int size = active == JOB_SHAPE ? CLOUD_NOISE_SHAPE_SIZE : CLOUD_NOISE_DETAIL_SIZE;
+            glBindImageTexture(0, volume.ID, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
+            for (int i = 0; i < units; i++, job.done++)
+            {
+                glProgramUniform3i(job.shader->ID, glGetUniformLocation(job.shader->ID, "u_offset"), 0, 0, job.done * CLOUD_NOISE_SLAB);
+                glDispatchCompute(size / CLOUD_NOISE_VOLUME_GROUP, size / CLOUD_NOISE_VOLUME_GROUP, CLOUD_NOISE_SLAB / CLOUD_NOISE_VOLUME_GROUP);
+            }
+        }
+        Profiler::CountDispatch(units);
+        glQueryCounter(timestamps[slot][1], GL_TIMESTAMP);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        if (job.done < job.units)
+            return;
+        if (active == JOB_WEATHER)
+        {
+            // the first map appears at once, later ones fade in over the old
+            front = 1 - front;
+            blend = weatherValid ? 0.0f : 1.0f;
+            weatherValid = true;
+        }
+        else
+        {
+            (active == JOB_SHAPE ? shape : detail).generateMipmap();
+            LOG_INFO("Cloud noise volume %d^3 generated", active == JOB_SHAPE ? CLOUD_NOISE_SHAPE_SIZE : CLOUD_NOISE_DETAIL_SIZE);
+        }
+    }
+    // volumes and a first weather map exist
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        return jobs[JOB_SHAPE].done == jobs[JOB_SHAPE].units && jobs[JOB_DETAIL].done == jobs[JOB_DETAIL].units && weatherValid;
+    }
+    // a weather regeneration is being generated or faded in
+    // ------------------------------------------------------------------------
+    bool isChangingWeather() const
+    {
+        return jobs[JOB_WEATHER].done < jobs[JOB_WEATHER].units || blend < 1.0f;
+    }
+    // textures and the fade for volumetric_clouds.comp
+    // ------------------------------------------------------------------------
+    void bind(const Shader& shader) const
+    {
+        GLState::BindTextureUnit(CLOUD_NOISE_SHAPE_UNIT, shape.ID);
+        GLState::BindTextureUnit(CLOUD_NOISE_DETAIL_UNIT, detail.ID);
+        GLState::BindTextureUnit(CLOUD_NOISE_WEATHER_UNIT, weather[front]->ID);
+        GLState::BindTextureUnit(CLOUD_NOISE_PREVIOUS_WEATHER_UNIT, weather[1 - front]->ID);
+        shader.setInt("cloud", CLOUD_NOISE_SHAPE_UNIT);
+        shader.setInt("worley32", CLOUD_NOISE_DETAIL_UNIT);
+        shader.setInt("weatherTex", CLOUD_NOISE_WEATHER_UNIT);
+        shader.setInt("weatherTexPrevious", CLOUD_NOISE_PREVIOUS_WEATHER_UNIT);
+        shader.setFloat("weatherBlend", blend);
+    }
+
+private:
+    enum { JOB_SHAPE, JOB_DETAIL, JOB_WEATHER, JOB_COUNT };
+
+    struct Job
+    {
+        Shader* shader;
+        int units;
+        int done;
+        double msPerUnit;   // smoothed measurement, 0 until the first one
+    };
+
+    struct Timing
+    {
+        int job;
+        int units;      // 0 = nothing recorded in this slot
+    };
+
+    Shader shapeShader;
+    Shader detailShader;
+    Shader weatherShader;
+    GLTexture shape;
+    GLTexture detail;
+    std::unique_ptr<GLTexture> weather[2];
+    int front;              // visible weather map, the other one is faded from or being generated
+    float blend;
+    bool weatherValid;
+    glm::vec3 seed;
+    Job jobs[JOB_COUNT];
+    GLuint timestamps[CLOUD_NOISE_TIMING_FRAMES][2];
+    Timing timings[CLOUD_NOISE_TIMING_FRAMES];
+    uint64_t frame;
+
+    static int Levels(int size)
+    {
+        int levels = 1;
+        while (size > 1) { size /= 2; levels++; }
+        return levels;
+    }
+
+    // fold in every finished measurement, pending ones are checked again next frame
+    void collectTimings()
+    {
+        for (int i = 0; i < CLOUD_NOISE_TIMING_FRAMES; i++)
+        {
+            Timing& timing = timings[i];
+            if (timing.units == 0)
+                continue;
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(timestamps[i][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(timestamps[i][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(timestamps[i][1], GL_QUERY_RESULT, &end);
+            double msPerUnit = (end - begin) / 1000000.0 / timing.units;
+            Job& job = jobs[timing.job];
+            job.msPerUnit = job.msPerUnit > 0.0 ? job.msPerUnit + (msPerUnit - job.msPerUnit) * 0.25 : msPerUnit;
+            timing.units = 0;
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+#ifndef COOKED_FONT_H
+#define COOKED_FONT_H
+
+#include <stdint.h>
+
+#include "MappedFile.h"
+
+#define COOKED_FONT_MAGIC 0x544E4643u  // "CFNT"
+#define COOKED_FONT_VERSION 2
+
+#define COOKED_FONT_DISTANCE_FIELD 0x1u
+// fully covered block, lets rectangles share the text batch
+#define COOKED_FONT_SOLID_GLYPH 0
+
+// one glyph: atlas rectangle in texels, metrics in pixels at the cooked size
+struct CookedFontGlyph
+{
+    uint32_t codepoint;
+    uint16_t x, y;
+    uint16_t width, height;
+    float bearingX;     // pen to left edge of the quad
+    float bearingY;     // baseline up to top edge of the quad
+    float advance;
+};
+
+// header, then glyphs sorted by codepoint and a width * height R8 atlas
+struct CookedFontHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t glyphCount;
+    uint32_t atlasWidth;
+    uint32_t atlasHeight;
+    float pixelSize;        // em height the metrics are measured in
+    float ascent;
+    float descent;
+    float lineHeight;
+    float distanceRange;    // distance field spread in texels, 0 for coverage atlases
+    uint32_t padding;
+    uint64_t glyphOffset;
+    uint64_t pixelOffset;
+};
+
+// Read-only view of a cooked glyph atlas; every accessor points into the mapping.
+class CookedFont
+{
+public:
+    CookedFont() {}
+
+    CookedFont(const CookedFont&) = delete;
+    CookedFont& operator=(const CookedFont&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        if (!file.open(path))
+            return false;
+        if (!validate())
+        {
+            file.close();
+            return false;
+        }
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void close()
+    {
+        file.close();
+    }
+    // ------------------------------------------------------------------------
+    const CookedFontHeader& getHeader() const
+    {
+        return *(const CookedFontHeader*)file.data();
+    }
+    // ------------------------------------------------------------------------
+    const CookedFontGlyph* getGlyphs() const
+    {
+        return (const CookedFontGlyph*)(file.data() + getHeader().glyphOffset);
+    }
+    // ------------------------------------------------------------------------
+    const uint8_t* getPixels() const
+    {
+        return file.data() + getHeader().pixelOffset;
+    }
+
+private:
+    MappedFile file;
+
+    bool validate() const
+    {
+        if (file.size() < sizeof(CookedFontHeader))
+            return false;
+
+        const CookedFontHeader& header = getHeader();
+        if (header.magic != COOKED_FONT_MAGIC || header.version != COOKED_FONT_VERSION)
+            return false;
+        if (header.atlasWidth == 0 || header.atlasHeight == 0 || header.pixelSize <= 0.0f)
+            return false;
+
+        return header.glyphOffset + (uint64_t)header.glyphCount * sizeof(CookedFontGlyph) <= file.size() &&
+            header.pixelOffset + (uint64_t)header.atlasWidth * header.atlasHeight <= file.size();
+    }
+};
+
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+#ifndef COOKED_MESH_H
+#define COOKED_MESH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdint.h>
+
+#include "MappedFile.h"
+
+#define COOKED_MESH_MAGIC 0x48534D43u  // "CMSH"
+#define COOKED_MESH_VERSION 1
+
+// 16 byte quantized vertex, bound directly as vertex attributes:
+//   position  4 x unorm16 inside the mesh bounds (w unused)
+//   normal    snorm 10:10:10:2
+//   texCoord  2 x half float
+struct CookedMeshVertex
+{
+    uint16_t position[4];
+    uint32_t normal;
+    uint16_t texCoord[2];
+};
+
+struct CookedMeshSubset
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t material;
+    uint32_t padding;
+};
+
+struct CookedMeshMaterial
+{
+    char name[64];
+    float diffuse[4];
+    float specular[3];
+    float shininess;
+    char diffuseMap[128];
+};
+
+// header, then vertices, indices, subsets and materials at the given offsets
+struct CookedMeshHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize;         // 2 or 4 bytes
+    uint32_t subsetCount;
+    uint32_t materialCount;
+    uint32_t padding;
+    float boundsMin[4];
+    float boundsMax[4];
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t subsetOffset;
+    uint64_t materialOffset;
+};
+
+// Read-only view of a cooked mesh; every accessor points into the mapping.
+class CookedMesh
+{
+public:
+    CookedMesh() {}
+
+    CookedMesh(const CookedMesh&) = delete;
+    CookedMesh& operator=(const CookedMesh&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        if (!file.open(path))
+            return false;
+        if (!validate())
+        {
+            file.close();
+            return false;
+        }
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void close()
+    {
+        file.close();
+    }
+    // ------------------------------------------------------------------------
+    const CookedMeshHeader& getHeader() const
+    {
+        return *(const CookedMeshHeader*)file.data();
+    }
+    // ------------------------------------------------------------------------
+    const CookedMeshVertex* getVertices() const
+    {
+        return (const CookedMeshVertex*)(file.data() + getHeader().vertexOffset);
+    }
+    // ------------------------------------------------------------------------
+    const void* getIndices() const
+    {
+        return file.data() + getHeader().indexOffset;
+    }
+    // ------------------------------------------------------------------------
+    const CookedMeshSubset* getSubsets() const
+    {
+        return (const CookedMeshSubset*)(file.data() + getHeader().subsetOffset);
+    }
+    // ------------------------------------------------------------------------
+    const CookedMeshMaterial* getMaterials() const
+    {
+        return (const CookedMeshMaterial*)(file.data() + getHeader().materialOffset);
+    }
+    // maps the unorm16 [0, 1] positions back onto the mesh bounds;
+    // fold it into the model matrix instead of decoding in the shader
+    // ------------------------------------------------------------------------
+    glm::mat4 getDecodeMatrix() const
+    {
+        const CookedMeshHeader& header = getHeader();
+        glm::vec3 boundsMin(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        glm::vec3 boundsMax(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
+    }
+
+private:
+    MappedFile file;
+
+    bool validate() const
+    {
+        if (file.size() < sizeof(CookedMeshHeader))
+            return false;
+
+        const CookedMeshHeader& header = getHeader();
+        if (header.magic != COOKED_MESH_MAGIC || header.version != COOKED_MESH_VERSION)
+            return false;
+        if (header.indexSize != 2 && header.indexSize != 4)
+            return false;
+
+        return header.vertexOffset + (uint64_t)header.vertexCount * sizeof(CookedMeshVertex) <= file.size() &&
+            header.indexOffset + (uint64_t)header.indexCount * header.indexSize <= file.size() &&
+            header.subsetOffset + (uint64_t)header.subsetCount * sizeof(CookedMeshSubset) <= file.size() &&
+            header.materialOffset + (uint64_t)header.materialCount * sizeof(CookedMeshMaterial) <= file.size();
+    }
+};
+
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <stdint.h>
+
+#include "Logger.h"
+#include "GLObjects.h"
+#include "MappedFile.h"
+
+#define COOKED_TEXTURE_MAGIC 0x58455443u   // "CTEX"
+#define COOKED_TEXTURE_VERSION 1
+#define COOKED_TEXTURE_MAX_LEVELS 16
+#define COOKED_TEXTURE_ALIGNMENT 16
+
+// On-disk layout, modelled on KTX2: a fixed header with a level index, then
+// the level data. Each level holds every layer back to back, so one level
+// maps straight onto one glCompressedTextureSubImage3D call.
+struct CookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t internalFormat;    // GL compressed internal format
+    uint32_t blockBytes;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t levels;
+    struct
+    {
+        uint64_t offset;        // from the start of the file, COOKED_TEXTURE_ALIGNMENT aligned
+        uint64_t size;          // all layers
+    } level[COOKED_TEXTURE_MAX_LEVELS];
+};
+
+// Memory maps a cooked texture array and uploads it straight from the
+// mapped pages: no read into a heap buffer, no decode, no format conversion.
+class CookedTexture
+{
+public:
+    CookedTexture() {}
+
+    CookedTexture(const CookedTexture&) = delete;
+    CookedTexture& operator=(const CookedTexture&) = delete;
+
+    // map the file and validate the header, false if missing or out of date
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        if (!file.open(path))
+            return false;
+        if (!validate())
+        {
+            file.close();
+            return false;
+        }
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void close()
+    {
+        file.close();
+    }
+    // ------------------------------------------------------------------------
+    bool isOpen() const
+    {
+        return file.isOpen();
+    }
+    // ------------------------------------------------------------------------
+    const CookedTextureHeader& getHeader() const
+    {
+        return *(const CookedTextureHeader*)file.data();
+    }
+    // read the level data in ahead of upload(), from any thread
+    // ------------------------------------------------------------------------
+    void prefetch() const
+    {
+        file.prefetch();
+    }
+    // allocate immutable storage on a GL_TEXTURE_2D_ARRAY and fill every level
+    // ------------------------------------------------------------------------
+    bool upload(GLTexture& texture) const
+    {
+        if (file.data() == NULL || texture.target != GL_TEXTURE_2D_ARRAY)
+            return false;
+
+        const CookedTextureHeader& header = getHeader();
+        texture.storage3D(header.levels, header.internalFormat, header.width, header.height, header.layers);
+        for (uint32_t level = 0; level < header.levels; level++)
+        {
+            GLsizei width = (header.width >> level) > 0 ? (header.width >> level) : 1;
+            GLsizei height = (header.height >> level) > 0 ? (header.height >> level) : 1;
+            glCompressedTextureSubImage3D(texture.ID, level, 0, 0, 0, width, height, header.layers,
+                header.internalFormat, (GLsizei)header.level[level].size, file.data() + header.level[level].offset);
+        }
+
+        texture.parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+        texture.parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+        texture.parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        texture.parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameterf(texture.ID, GL_TEXTURE_MAX_ANISOTROPY, 8.0f);
+        return true;
+    }
+    // bytes of level data, i.e. what the texture occupies in VRAM
+    // ------------------------------------------------------------------------
+    uint64_t getDataSize() const
+    {
+        uint64_t total = 0;
+        const CookedTextureHeader& header = getHeader();
+        for (uint32_t level = 0; level < header.levels; level++)
+            total += header.level[level].size;
+        return total;
+    }
+
+private:
+    MappedFile file;
+
+    bool validate() const
+    {
+        if (file.size() < sizeof(CookedTextureHeader))
+            return false;
+
+        const CookedTextureHeader& header = getHeader();
+        if (header.magic != COOKED_TEXTURE_MAGIC || header.version != COOKED_TEXTURE_VERSION)
+            return false;
+        if (header.levels == 0 || header.levels > COOKED_TEXTURE_MAX_LEVELS || header.layers == 0)
+            return false;
+        for (uint32_t level = 0; level < header.levels; level++)
+        {
+            if (header.level[level].offset + header.level[level].size > file.size())
+            {
+                LOG_ERROR("CookedTexture: level %u runs past the end of the file", level);
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <math.h>
+
+#include "Profiler.h"
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_MAX_SCALE 1.0f
+// share of the display's frame period the GPU frame may take
+#define DYNAMIC_RESOLUTION_BUDGET 0.9f
+// scale up only once the frame is this far under budget, the band in between is left alone
+#define DYNAMIC_RESOLUTION_UP_THRESHOLD 0.8f
+// consecutive frames over/under before acting: drop fast, climb back slowly
+#define DYNAMIC_RESOLUTION_DOWN_FRAMES 3
+#define DYNAMIC_RESOLUTION_UP_FRAMES 60
+// largest change of the scale in one step
+#define DYNAMIC_RESOLUTION_MAX_DOWN_STEP 0.15f
+#define DYNAMIC_RESOLUTION_MAX_UP_STEP 0.05f
+// weight of a new GPU time in the smoothed average
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.2f
+
+// Picks the render scale of the scene from the GPU frame time the Profiler
+// measured with timestamp queries. GPU cost is taken as proportional to the
+// pixel count, so a step scales both axes by sqrt(budget / time). The
+// controller acts only when the smoothed time has been over budget (or well
+// under it) for several frames, and after a change it waits until frames
+// rendered at the new scale come back from the Profiler, so it never reacts
+// to its own stale measurements. CPU only, the render thread feeds it once
+// per frame.
+class DynamicResolution
+{
+public:
+    DynamicResolution()
+        : budgetMs(1000.0f / 60.0f * DYNAMIC_RESOLUTION_BUDGET), scale(DYNAMIC_RESOLUTION_MAX_SCALE), smoothedMs(0.0f),
+          overFrames(0), underFrames(0), settleFrames(0)
+    {
+    }
+
+    // frame period of the display, e.g. 1000 / refresh rate
+    // ------------------------------------------------------------------------
+    void setTargetFrameTime(float frameMs)
+    {
+        budgetMs = frameMs * DYNAMIC_RESOLUTION_BUDGET;
+    }
+    // back to full resolution, e.g. when dynamic resolution is switched off
+    // ------------------------------------------------------------------------
+    void reset()
+    {
+        scale = DYNAMIC_RESOLUTION_MAX_SCALE;
+        smoothedMs = 0.0f;
+        overFrames = 0;
+        underFrames = 0;
+        settleFrames = PROFILER_FRAME_LATENCY + 1;
+    }
+    // feed the latest GPU frame time, returns true when the scale changed
+    // ------------------------------------------------------------------------
+    bool update(double gpuMs)
+    {
+        if (gpuMs <= 0.0)
+            return false;
+
+        // results still in flight were rendered at the previous scale
+        if (settleFrames > 0)
+        {
+            settleFrames--;
+            smoothedMs = (float)gpuMs;
+            return false;
+        }
+        smoothedMs += ((float)gpuMs - smoothedMs) * DYNAMIC_RESOLUTION_SMOOTHING;
+
+        overFrames = smoothedMs > budgetMs ? overFrames + 1 : 0;
+        underFrames = smoothedMs < budgetMs * DYNAMIC_RESOLUTION_UP_THRESHOLD ? underFrames + 1 : 0;
+
+        float target = scale;
+        if (overFrames >= DYNAMIC_RESOLUTION_DOWN_FRAMES && scale > DYNAMIC_RESOLUTION_MIN_SCALE)
+            target = fmaxf(scale * sqrtf(budgetMs / smoothedMs), scale - DYNAMIC_RESOLUTION_MAX_DOWN_STEP);
+        else if (underFrames >= DYNAMIC_RESOLUTION_UP_FRAMES && scale < DYNAMIC_RESOLUTION_MAX_SCALE)
+            // aim for the middle of the band, not its edge
+            target = fminf(scale * sqrtf(budgetMs * (1.0f + DYNAMIC_RESOLUTION_UP_THRESHOLD) * 0.5f / smoothedMs), scale + DYNAMIC_RESOLUTION_MAX_UP_STEP);
+        target = fminf(fmaxf(target, DYNAMIC_RESOLUTION_MIN_SCALE), DYNAMIC_RESOLUTION_MAX_SCALE);
+
+        // a change costs the settle time and a blurrier history, ignore tiny ones
+        if (fabsf(target - scale) < 0.01f)
+            return false;
+
+        scale = target;
+        overFrames = 0;
+        underFrames = 0;
+        settleFrames = PROFILER_FRAME_LATENCY + 1;
+        return true;
+    }
+    // render size for an output size at the current scale, even and at least 2
+    // ------------------------------------------------------------------------
+    int getRenderWidth(int outputWidth) const
+    {
+        return scaled(outputWidth);
+    }
+    // ------------------------------------------------------------------------
+    int getRenderHeight(int outputHeight) const
+    {
+        return scaled(outputHeight);
+    }
+    // ------------------------------------------------------------------------
+    float getScale() const
+    {
+        return scale;
+    }
+    // ------------------------------------------------------------------------
+    float getBudget() const
+    {
+        return budgetMs;
+    }
+
+private:
+    float budgetMs;
+    float scale;
+    float smoothedMs;
+    int overFrames;
+    int underFrames;
+    int settleFrames;
+
+    int scaled(int size) const
+    {
+        int result = ((int)(size * scale * 0.5f + 0.5f)) * 2;
+        if (result > size)
+            result = size;
+        return result < 2 ? 2 : result;
+    }
+};
+
+
+#endif
@@ -0,0 +1,333 @@
+#include "FontCooker.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "CookedFont.h"
+
+#pragma comment(lib, "gdi32.lib")
+
+#define FONT_FIRST_CHAR 32
+#define FONT_LAST_CHAR 126
+#define FONT_SUPERSAMPLE 4      // distance fields are measured at 4x and box filtered down
+#define FONT_GLYPH_GAP 1
+#define FONT_MIN_ATLAS_WIDTH 128
+#define FONT_SOLID_SIZE 4
+#define COOKED_FONT_ALIGNMENT 16
+#define DISTANCE_INFINITY 1e20f
+
+struct RasterGlyph
+{
+    uint32_t codepoint;
+    int width, height;
+    int x, y;
+    float bearingX, bearingY, advance;
+    std::vector<uint8_t> pixels;
+};
+
+// squared distance along one row or column (Felzenszwalb & Huttenlocher),
+// f holds 0 at seed pixels and DISTANCE_INFINITY elsewhere
+static void distanceTransform1D(const float* f, float* d, int n, int* v, float* z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -DISTANCE_INFINITY;
+    z[1] = DISTANCE_INFINITY;
+    for (int q = 1; q < n; q++)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = DISTANCE_INFINITY;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q)
+            k++;
+        float offset = (float)(q - v[k]);
+        d[q] = offset * offset + f[v[k]];
+    }
+}
+
+// squared distance from every pixel to the nearest pixel whose inside flag equals seed
+static void distanceTransform2D(const std::vector<uint8_t>& inside, bool seed, int width, int height, std::vector<float>& out)
+{
+    int n = std::max(width, height);
+    std::vector<float> f(n), d(n), z(n + 1);
+    std::vector<int> v(n);
+
+    out.resize((size_t)width * height);
+    for (size_t i = 0; i < out.size(); i++)
+        out[i] = ((inside[i] != 0) == seed) ? 0.0f : DISTANCE_INFINITY;
+
+    for (int x = 0; x < width; x++)
+    {
+        for (int y = 0; y < height; y++)
+            f[y] = out[(size_t)y * width + x];
+        distanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+        for (int y = 0; y < height; y++)
+            out[(size_t)y * width + x] = d[y];
+    }
+    for (int y = 0; y < height; y++)
+    {
+        float* row = &out[(size_t)y * width];
+        distanceTransform1D(row, d.data(), width, v.data(), z.data());
+        memcpy(row, d.data(), width * sizeof(float));
+    }
+}
+
+// GGO_GRAY8 coverage (0..64) at supersampled resolution -> one atlas channel
+static void filterGlyph(const FontRecipe& recipe, const std::vector<uint8_t>& coverage, int gridWidth, int gridHeight, RasterGlyph& glyph)
+{
+    int supersample = recipe.distanceField ? FONT_SUPERSAMPLE : 1;
+    glyph.pixels.resize((size_t)glyph.width * glyph.height);
+
+    if (!recipe.distanceField)
+    {
+        for (size_t i = 0; i < glyph.pixels.size(); i++)
+            glyph.pixels[i] = (uint8_t)((coverage[i] * 255 + 32) / 64);
+        return;
+    }
+
+    std::vector<uint8_t> inside(coverage.size());
+    for (size_t i = 0; i < coverage.size(); i++)
+        inside[i] = coverage[i] >= 32;
+
+    std::vector<float> toInside, toOutside;
+    distanceTransform2D(inside, true, gridWidth, gridHeight, toInside);
+    distanceTransform2D(inside, false, gridWidth, gridHeight, toOutside);
+
+    // signed distance in texels, positive inside; the outline sits half a pixel
+    // from the nearest pixel centre of the other side
+    float scale = 1.0f / (supersample * supersample * supersample);
+    for (int y = 0; y < glyph.height; y++)
+    {
+        for (int x = 0; x < glyph.width; x++)
+        {
+            float sum = 0.0f;
+            for (int sy = 0; sy < supersample; sy++)
+            {
+                for (int sx = 0; sx < supersample; sx++)
+                {
+                    size_t i = (size_t)(y * supersample + sy) * gridWidth + (x * supersample + sx);
+                    sum += inside[i] ? (sqrtf(toOutside[i]) - 0.5f) : -(sqrtf(toInside[i]) - 0.5f);
+                }
+            }
+            float value = 0.5f + sum * scale / (2.0f * recipe.spread);
+            value = std::min(std::max(value, 0.0f), 1.0f);
+            glyph.pixels[(size_t)y * glyph.width + x] = (uint8_t)(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+bool FontCooker::needsCook(const FontRecipe& recipe)
+{
+    uint64_t cooked, source;
+    if (!MappedFile::LastWriteTime(recipe.output.c_str(), cooked))
+        return true;
+    if (MappedFile::LastWriteTime(recipe.source.c_str(), source) && source > cooked)
+        return true;
+
+    CookedFont existing;
+    return !existing.open(recipe.output.c_str());
+}
+
+bool FontCooker::cook(const FontRecipe& recipe)
+{
+    double startTime = Timer::getAppRunTime();
+    if (AddFontResourceExA(recipe.source.c_str(), FR_PRIVATE, 0) == 0)
+    {
+        LOG_ERROR("FontCooker: cannot register %s", recipe.source.c_str());
+        return false;
+    }
+
+    int supersample = recipe.distanceField ? FONT_SUPERSAMPLE : 1;
+    // room around the outline for the distance falloff (or for bilinear filtering)
+    int padding = (recipe.distanceField ? recipe.spread : 1) * supersample;
+
+    HDC dc = CreateCompatibleDC(NULL);
+    HFONT font = CreateFontA(-recipe.pixelSize * supersample, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+        OUT_TT_ONLY_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, recipe.faceName.c_str());
+    HGDIOBJ previousFont = SelectObject(dc, font);
+
+    // GDI silently substitutes another face when the name does not match
+    char faceName[LF_FACESIZE] = { 0 };
+    GetTextFaceA(dc, LF_FACESIZE, faceName);
+    bool matched = _stricmp(faceName, recipe.faceName.c_str()) == 0;
+
+    TEXTMETRICA metrics;
+    GetTextMetricsA(dc, &metrics);
+
+    std::vector<RasterGlyph> glyphs;
+    std::vector<uint8_t> bitmap;
+    std::vector<uint8_t> coverage;
+    MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+    for (uint32_t codepoint = FONT_FIRST_CHAR; matched && codepoint <= FONT_LAST_CHAR; codepoint++)
+    {
+        GLYPHMETRICS glyphMetrics;
+        DWORD size = GetGlyphOutlineW(dc, codepoint, GGO_GRAY8_BITMAP, &glyphMetrics, 0, NULL, &identity);
+        if (size == GDI_ERROR)
+            continue;
+
+        RasterGlyph glyph;
+        glyph.codepoint = codepoint;
+        glyph.x = glyph.y = 0;
+        glyph.width = glyph.height = 0;
+        glyph.bearingX = glyph.bearingY = 0.0f;
+        glyph.advance = glyphMetrics.gmCellIncX / (float)supersample;
+
+        // blank glyphs (space) only carry an advance
+        if (size == 0)
+        {
+            glyphs.push_back(std::move(glyph));
+            continue;
+        }
+
+        bitmap.resize(size);
+        GetGlyphOutlineW(dc, codepoint, GGO_GRAY8_BITMAP, &glyphMetrics, size, bitmap.data(), &identity);
+        int blackWidth = (int)glyphMetrics.gmBlackBoxX;
+        int blackHeight = (int)glyphMetrics.gmBlackBoxY;
+        int pitch = (blackWidth + 3) & ~3;
+
+        // padded grid rounded up to whole atlas texels, rows top-down like the bitmap
+        int gridWidth = (blackWidth + 2 * padding + supersample - 1) / supersample * supersample;
+        int gridHeight = (blackHeight + 2 * padding + supersample - 1) / supersample * supersample;
+        coverage.assign((size_t)gridWidth * gridHeight, 0);
+        for (int y = 0; y < blackHeight; y++)
+            memcpy(&coverage[(size_t)(y + padding) * gridWidth + padding], &bitmap[(size_t)y * pitch], blackWidth);
+
+        glyph.width = gridWidth / supersample;
+        glyph.height = gridHeight / supersample;
+        glyph.bearingX = (glyphMetrics.gmptGlyphOrigin.x - padding) / (float)supersample;
+        glyph.bearingY = (glyphMetrics.gmptGlyphOrigin.y + padding) / (float)supersample;
+        filterGlyph(recipe, coverage, gridWidth, gridHeight, glyph);
+        glyphs.push_back(std::move(glyph));
+    }
+
+    SelectObject(dc, previousFont);
+    DeleteObject(font);
+    DeleteDC(dc);
+    RemoveFontResourceExA(recipe.source.c_str(), FR_PRIVATE, 0);
+
+    if (!matched || glyphs.empty())
+    {
+        LOG_ERROR("FontCooker: %s does not provide face \"%s\" (got \"%s\")", recipe.source.c_str(), recipe.faceName.c_str(), faceName);
+        return false;
+    }
+
+    RasterGlyph solid;
+    solid.codepoint = COOKED_FONT_SOLID_GLYPH;
+    solid.x = solid.y = 0;
+    solid.width = solid.height = FONT_SOLID_SIZE;
+    solid.bearingX = solid.bearingY = solid.advance = 0.0f;
+    solid.pixels.assign(FONT_SOLID_SIZE * FONT_SOLID_SIZE, 255);
+    glyphs.insert(glyphs.begin(), std::move(solid));
+
+    // shelf packing, tallest glyphs first, into a square-ish power of two atlas
+    std::vector<size_t> order(glyphs.size());
+    size_t area = 0;
+    int widest = 0;
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        order[i] = i;
+        area += (size_t)(glyphs[i].width + FONT_GLYPH_GAP) * (glyphs[i].height + FONT_GLYPH_GAP);
+        widest = std::max(widest, glyphs[i].width);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return glyphs[a].height > glyphs[b].height; });
+
+    int atlasWidth = FONT_MIN_ATLAS_WIDTH;
+    while ((size_t)atlasWidth * atlasWidth < area || atlasWidth < widest + 2 * FONT_GLYPH_GAP)
+        atlasWidth *= 2;
+
+    int penX = FONT_GLYPH_GAP, penY = FONT_GLYPH_GAP, shelfHeight = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        RasterGlyph& glyph = glyphs[order[i]];
+        if (glyph.width == 0)
+            continue;
+        if (penX + glyph.width + FONT_GLYPH_GAP > atlasWidth)
+        {
+            penY += shelfHeight + FONT_GLYPH_GAP;
+            penX = FONT_GLYPH_GAP;
+            shelfHeight = 0;
+        }
+        glyph.x = penX;
+        glyph.y = penY;
+        penX += glyph.width + FONT_GLYPH_GAP;
+        shelfHeight = std::max(shelfHeight, glyph.height);
+    }
+    int atlasHeight = 1;
+    while (atlasHeight < penY + shelfHeight + FONT_GLYPH_GAP)
+        atlasHeight *= 2;
+
+    CookedFontHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COOKED_FONT_MAGIC;
+    header.version = COOKED_FONT_VERSION;
+    header.flags = recipe.distanceField ? COOKED_FONT_DISTANCE_FIELD : 0;
+    header.glyphCount = (uint32_t)glyphs.size();
+    header.atlasWidth = atlasWidth;
+    header.atlasHeight = atlasHeight;
+    header.pixelSize = (float)recipe.pixelSize;
+    header.ascent = metrics.tmAscent / (float)supersample;
+    header.descent = metrics.tmDescent / (float)supersample;
+    header.lineHeight = (metrics.tmHeight + metrics.tmExternalLeading) / (float)supersample;
+    header.distanceRange = recipe.distanceField ? (float)recipe.spread : 0.0f;
+    header.glyphOffset = (sizeof(CookedFontHeader) + COOKED_FONT_ALIGNMENT - 1) & ~(uint64_t)(COOKED_FONT_ALIGNMENT - 1);
+    header.pixelOffset = (header.glyphOffset + glyphs.size() * sizeof(CookedFontGlyph) + COOKED_FONT_ALIGNMENT - 1) & ~(uint64_t)(COOKED_FONT_ALIGNMENT - 1);
+
+    std::vector<uint8_t> fileData((size_t)header.pixelOffset + (size_t)atlasWidth * atlasHeight, 0);
+    memcpy(fileData.data(), &header, sizeof(header));
+    CookedFontGlyph* cookedGlyphs = (CookedFontGlyph*)&fileData[(size_t)header.glyphOffset];
+    uint8_t* atlas = &fileData[(size_t)header.pixelOffset];
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        const RasterGlyph& glyph = glyphs[i];
+        cookedGlyphs[i].codepoint = glyph.codepoint;
+        cookedGlyphs[i].x = (uint16_t)glyph.x;
+        cookedGlyphs[i].y = (uint16_t)glyph.y;
+        cookedGlyphs[i].width = (uint16_t)glyph.width;
+        cookedGlyphs[i].height = (uint16_t)glyph.height;
+        cookedGlyphs[i].bearingX = glyph.bearingX;
+        cookedGlyphs[i].bearingY = glyph.bearingY;
+        cookedGlyphs[i].advance = glyph.advance;
+        for (int y = 0; y < glyph.height; y++)
+            memcpy(&atlas[(size_t)(glyph.y + y) * atlasWidth + glyph.x], &glyph.pixels[(size_t)y * glyph.width], glyph.width);
+    }
+
+    // write next to the target and swap in, so a crash never leaves a torn file
+    std::string temporary = recipe.output + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        LOG_ERROR("FontCooker: cannot write %s", temporary.c_str());
+        return false;
+    }
+    bool written = fwrite(fileData.data(), 1, fileData.size(), file) == fileData.size();
+    fclose(file);
+    if (!written || !MoveFileExA(temporary.c_str(), recipe.output.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        LOG_ERROR("FontCooker: failed to write %s", recipe.output.c_str());
+        DeleteFileA(temporary.c_str());
+        return false;
+    }
+
+    LOG_INFO("FontCooker: %s, %d glyphs at %dpx%s, %dx%d atlas in %.2f seconds", recipe.output.c_str(), (int)glyphs.size(), recipe.pixelSize,
+        recipe.distanceField ? " (distance field)" : "", atlasWidth, atlasHeight, Timer::getAppRunTime() - startTime);
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef FONTCOOKER_H
+#define FONTCOOKER_H
+
+#include <string>
+
+// One cooked glyph atlas: the TrueType file, the face name it registers,
+// the em size glyphs are rasterized at and where the result is written.
+struct FontRecipe
+{
+    std::string output;
+    std::string source;
+    std::string faceName;
+    int pixelSize;
+    bool distanceField;     // signed distance atlas, scales cleanly to any size
+    int spread;             // distance field range in atlas texels
+};
+
+// Offline asset step: registers the font privately with GDI, rasterizes the
+// printable ASCII range (supersampled when building a distance field),
+// shelf-packs the glyphs plus a solid block for rectangles into a
+// single-channel atlas and writes a CookedFont file. Runs from "OGL.exe
+// -cook" or at startup when the cooked file is missing or older than the font.
+class FontCooker
+{
+public:
+    static bool cook(const FontRecipe& recipe);
+    // output missing, unreadable or older than the font
+    static bool needsCook(const FontRecipe& recipe);
+};
+
+#endif // FONTCOOKER_H
@@ -0,0 +1,416 @@
+#include "FrameCapture.h"
+
+#include <objbase.h>
+
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Image.h"
+#include "Logger.h"
+
+FrameCapture::FrameCapture()
+    : writeSlot(0), readSlot(0), inFlight(0), recording(false), recordFormat(CAPTURE_PNG_SEQUENCE),
+      recordFramesPerSecond(60), videoOpen(false), videoWidth(0), videoHeight(0), sequenceIndex(0),
+      capturedFrames(0), droppedFrames(0), jobsFirst(0), jobsCount(0), queuedFrames(0), busy(false), stopping(false)
+{
+    for (int i = 0; i < FRAME_CAPTURE_RING; i++)
+    {
+        slots[i].capacity = 0;
+        slots[i].fence = NULL;
+        slots[i].width = 0;
+        slots[i].height = 0;
+        slots[i].videoFrame = false;
+    }
+    encoder = std::thread(&FrameCapture::encoderMain, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    stopRecording();
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    signal.notify_all();
+    encoder.join();
+
+    for (int i = 0; i < FRAME_CAPTURE_RING; i++)
+        if (slots[i].fence)
+            glDeleteSync(slots[i].fence);
+    if (droppedFrames > 0)
+        LOG_INFO("Frame capture dropped %llu of %llu frames", (unsigned long long)droppedFrames, (unsigned long long)(capturedFrames + droppedFrames));
+}
+
+void FrameCapture::screenshot(const std::string& path)
+{
+    requestedScreenshots.push_back(path);
+}
+
+void FrameCapture::startRecording(const std::string& path, CaptureFormat format, int framesPerSecond)
+{
+    stopRecording();
+    recording = true;
+    recordPath = path;
+    recordFormat = format;
+    recordFramesPerSecond = framesPerSecond > 0 ? framesPerSecond : 60;
+    sequenceIndex = 0;
+    LOG_INFO("Recording %s to %s", format == CAPTURE_Y4M ? "Y4M video" : "PNG sequence", path.c_str());
+}
+
+void FrameCapture::stopRecording()
+{
+    if (!recording)
+        return;
+    recording = false;
+    // frames already read back still belong to the recording
+    while (inFlight > 0)
+        collect(true);
+    finishVideo();
+    LOG_INFO("Recording of %s stopped after %llu frames", recordPath.c_str(), (unsigned long long)sequenceIndex);
+}
+
+bool FrameCapture::isRecording() const
+{
+    return recording;
+}
+
+void FrameCapture::capture(int width, int height)
+{
+    while (inFlight > 0 && collect(false))
+        ;
+
+    if (!recording && requestedScreenshots.empty())
+        return;
+    if (width <= 0 || height <= 0)
+        return;
+
+    // the oldest readback is still on the GPU: drop this frame rather than wait
+    if (inFlight == FRAME_CAPTURE_RING)
+    {
+        if (recording)
+            droppedFrames++;
+        return;
+    }
+
+    Slot& slot = slots[writeSlot];
+    GLsizeiptr size = (GLsizeiptr)width * height * 4;
+    if (slot.capacity < size)
+    {
+        GPU_MEMORY_OWNER("frame capture");
+        slot.buffer.reset(new GLBuffer());
+        slot.buffer->storage(size, NULL, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+        slot.capacity = size;
+    }
+
+    GLState::BindFramebuffer(0);
+    GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer->ID);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    slot.width = width;
+    slot.height = height;
+    slot.screenshots.swap(requestedScreenshots);
+    requestedScreenshots.clear();
+    slot.videoFrame = recording;
+
+    writeSlot = (writeSlot + 1) % FRAME_CAPTURE_RING;
+    inFlight++;
+}
+
+void FrameCapture::flush()
+{
+    while (inFlight > 0)
+        collect(true);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    signal.wait(lock, [this] { return jobsCount == 0 && !busy; });
+}
+
+uint64_t FrameCapture::getCapturedFrames() const
+{
+    return capturedFrames;
+}
+
+uint64_t FrameCapture::getDroppedFrames() const
+{
+    return droppedFrames;
+}
+
+bool FrameCapture::collect(bool wait)
+{
+    Slot& slot = slots[readSlot];
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    if (status == GL_WAIT_FAILED)
+        LOG_ERROR("Frame capture fence wait failed");
+    glDeleteSync(slot.fence);
+    slot.fence = NULL;
+
+    GLsizeiptr size = (GLsizeiptr)slot.width * slot.height * 4;
+    const uint8_t* mapped = (const uint8_t*)slot.buffer->mapRange(0, size, GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        for (size_t i = 0; i < slot.screenshots.size(); i++)
+        {
+            Job job = MakeJob(JOB_PNG, slot.screenshots[i].c_str(), slot.width, slot.height);
+            job.pixels = copyPixels(mapped, (size_t)size);
+            if (job.pixels)
+                enqueue(job);
+            else
+                LOG_ERROR("Screenshot %s dropped, every capture buffer is in use", slot.screenshots[i].c_str());
+        }
+
+        if (slot.videoFrame)
+        {
+            if (recordFormat == CAPTURE_PNG_SEQUENCE)
+            {
+                char name[MAX_PATH];
+                snprintf(name, sizeof(name), "%s_%06llu.png", recordPath.c_str(), (unsigned long long)sequenceIndex);
+                Job job = MakeJob(JOB_PNG, name, slot.width, slot.height);
+                job.droppable = true;
+                job.pixels = copyPixels(mapped, (size_t)size);
+                if (job.pixels == NULL)
+                    droppedFrames++;
+                else if (enqueue(job))
+                    sequenceIndex++;
+            }
+            else
+            {
+                if (!videoOpen)
+                {
+                    Job open = MakeJob(JOB_VIDEO_OPEN, recordPath.c_str(), slot.width, slot.height);
+                    open.framesPerSecond = recordFramesPerSecond;
+                    enqueue(open);
+                    videoOpen = true;
+                    videoWidth = slot.width;
+                    videoHeight = slot.height;
+                }
+
+                // a Y4M stream has one size, frames after a resize are dropped
+                if (slot.width != videoWidth || slot.height != videoHeight)
+                {
+                    droppedFrames++;
+                }
+                else
+                {
+                    Job job = MakeJob(JOB_VIDEO_FRAME, "", slot.width, slot.height);
+                    job.droppable = true;
+                    job.pixels = copyPixels(mapped, (size_t)size);
+                    if (job.pixels == NULL)
+                        droppedFrames++;
+                    else if (enqueue(job))
+                        sequenceIndex++;
+                }
+            }
+        }
+        slot.buffer->unmap();
+    }
+    else
+    {
+        LOG_ERROR("Frame capture could not map its readback buffer");
+        if (slot.videoFrame)
+            droppedFrames++;
+    }
+
+    slot.screenshots.clear();
+    readSlot = (readSlot + 1) % FRAME_CAPTURE_RING;
+    inFlight--;
+    return true;
+}
+
+void FrameCapture::finishVideo()
+{
+    if (!videoOpen)
+        return;
+    enqueue(MakeJob(JOB_VIDEO_CLOSE, recordPath.c_str(), videoWidth, videoHeight));
+    videoOpen = false;
+}
+
+std::vector<uint8_t>* FrameCapture::copyPixels(const uint8_t* mapped, size_t size)
+{
+    std::vector<uint8_t>* pixels;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pixels = pixelPool.acquire();
+    }
+    // the buffer kept its capacity, same sized frames copy without allocating
+    if (pixels)
+        pixels->assign(mapped, mapped + size);
+    return pixels;
+}
+
+bool FrameCapture::enqueue(const Job& job)
+{
+    bool droppable = job.droppable;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (droppable && (queuedFrames >= FRAME_CAPTURE_MAX_QUEUED || jobsCount == FRAME_CAPTURE_JOBS))
+        {
+            if (job.pixels)
+                pixelPool.release(job.pixels);
+            droppedFrames++;
+            return false;
+        }
+        // only reachable by a burst of video open/close jobs
+        signal.wait(lock, [this] { return jobsCount < FRAME_CAPTURE_JOBS; });
+        if (droppable)
+            queuedFrames++;
+        jobs[(jobsFirst + jobsCount) % FRAME_CAPTURE_JOBS] = job;
+        jobsCount++;
+    }
+    if (droppable)
+        capturedFrames++;
+    signal.notify_all();
+    return true;
+}
+
+FrameCapture::Job FrameCapture::MakeJob(JobKind kind, const char* path, int width, int height)
+{
+    Job job;
+    job.kind = kind;
+    snprintf(job.path, sizeof(job.path), "%s", path);
+    job.width = width;
+    job.height = height;
+    job.framesPerSecond = 0;
+    job.droppable = false;
+    job.pixels = NULL;
+    return job;
+}
+
+void FrameCapture::encoderMain()
+{
+    // WIC needs COM on this thread
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    FILE* video = NULL;
+    std::vector<uint8_t> planes;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            signal.wait(lock, [this] { return stopping || jobsCount > 0; });
+            if (jobsCount == 0)
+                break;
+            job = jobs[jobsFirst];
+            jobsFirst = (jobsFirst + 1) % FRAME_CAPTURE_JOBS;
+            jobsCount--;
+            busy = true;
+        }
+
+        switch (job.kind)
+        {
+        case JOB_PNG:
+        {
+            Image image;
+            image.width = job.width;
+            image.height = job.height;
+            image.pixels.swap(*job.pixels);
+            // the back buffer's alpha is whatever blending left behind
+            for (size_t i = 3; i < image.pixels.size(); i += 4)
+                image.pixels[i] = 255;
+            if (!image.save(job.path))
+                LOG_ERROR("Screenshot %s could not be written", job.path);
+            // the buffer goes back to the pool with its capacity
+            image.pixels.swap(*job.pixels);
+            break;
+        }
+
+        case JOB_VIDEO_OPEN:
+            video = fopen(job.path, "wb");
+            if (!video)
+            {
+                LOG_ERROR("Video %s could not be created", job.path);
+                break;
+            }
+            fprintf(video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", job.width, job.height, job.framesPerSecond);
+            break;
+
+        case JOB_VIDEO_FRAME:
+            if (video)
+                WriteY4mFrame(video, job, planes);
+            break;
+
+        case JOB_VIDEO_CLOSE:
+            if (video)
+            {
+                fclose(video);
+                video = NULL;
+                LOG_INFO("Video %s written", job.path);
+            }
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job.droppable)
+                queuedFrames--;
+            if (job.pixels)
+                pixelPool.release(job.pixels);
+            busy = false;
+        }
+        signal.notify_all();
+    }
+
+    if (video)
+        fclose(video);
+    CoUninitialize();
+}
+
+void FrameCapture::WriteY4mFrame(FILE* file, const Job& job, std::vector<uint8_t>& planes)
+{
+    int width = job.width;
+    int height = job.height;
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    planes.resize((size_t)width * height + 2 * (size_t)chromaWidth * chromaHeight);
+    uint8_t* yPlane = planes.data();
+    uint8_t* uPlane = yPlane + (size_t)width * height;
+    uint8_t* vPlane = uPlane + (size_t)chromaWidth * chromaHeight;
+
+    // BT.601 full range (JPEG), rows flipped to top-down
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* row = &(*job.pixels)[(size_t)(height - 1 - y) * width * 4];
+        for (int x = 0; x < width; x++)
+        {
+            const uint8_t* p = row + x * 4;
+            yPlane[(size_t)y * width + x] = (uint8_t)glm::clamp(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2] + 0.5f, 0.0f, 255.0f);
+        }
+    }
+    for (int cy = 0; cy < chromaHeight; cy++)
+    {
+        for (int cx = 0; cx < chromaWidth; cx++)
+        {
+            // 2x2 average, clamped at odd edges
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            for (int dy = 0; dy < 2; dy++)
+            {
+                int y = glm::min(cy * 2 + dy, height - 1);
+                const uint8_t* row = &(*job.pixels)[(size_t)(height - 1 - y) * width * 4];
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    const uint8_t* p = row + glm::min(cx * 2 + dx, width - 1) * 4;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            r *= 0.25f;
+            g *= 0.25f;
+            b *= 0.25f;
+            size_t index = (size_t)cy * chromaWidth + cx;
+            uPlane[index] = (uint8_t)glm::clamp(-0.168736f * r - 0.331264f * g + 0.5f * b + 128.5f, 0.0f, 255.0f);
+            vPlane[index] = (uint8_t)glm::clamp(0.5f * r - 0.418688f * g - 0.081312f * b + 128.5f, 0.0f, 255.0f);
+        }
+    }
+
+    fputs("FRAME\n", file);
+    fwrite(planes.data(), 1, planes.size(), file);
+}
@@ -0,0 +1,149 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <windows.h>
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "GLObjects.h"
+#include "Memory.h"
+
+// pixel pack buffers in flight; a readback is mapped FRAME_CAPTURE_RING - 1 frames later
+#define FRAME_CAPTURE_RING 3
+// encoded frames allowed to wait for the encoder before new ones are dropped
+#define FRAME_CAPTURE_MAX_QUEUED 8
+// frame sized pixel copies: the queued frames, the one being encoded and a few screenshots
+#define FRAME_CAPTURE_PIXEL_BUFFERS (FRAME_CAPTURE_MAX_QUEUED + 4)
+// encoder job ring: every job with pixels holds a pooled buffer, plus video open/close
+#define FRAME_CAPTURE_JOBS (FRAME_CAPTURE_PIXEL_BUFFERS + 4)
+
+enum CaptureFormat
+{
+    CAPTURE_PNG_SEQUENCE,   // <path>_000000.png, <path>_000001.png ...
+    CAPTURE_Y4M             // one uncompressed YUV4MPEG2 4:2:0 stream
+};
+
+// Copies the back buffer out without stalling the GL pipeline. capture()
+// issues glReadPixels into a pixel pack buffer from a small ring and fences
+// it; the buffer is only mapped once its fence signalled, a couple of frames
+// later, so the CPU never waits for the GPU. Mapped pixels go to an encoder
+// thread that writes PNGs through WIC or appends raw Y4M frames. When the
+// ring or the encoder queue is full the frame is dropped and counted rather
+// than slowing the renderer down, so measured frame times stay honest.
+// Pixel copies come from a pool of frame sized buffers the encoder hands
+// back, so recording does not allocate a frame's worth of heap every frame.
+// Everything except the encoder runs on the GL thread.
+class FrameCapture
+{
+public:
+    FrameCapture();
+    // flushes outstanding readbacks and finishes every queued file
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // the next captured frame is written to path as a PNG
+    void screenshot(const std::string& path);
+    // every following frame until stopRecording(); path is a prefix for
+    // CAPTURE_PNG_SEQUENCE and the file name for CAPTURE_Y4M
+    void startRecording(const std::string& path, CaptureFormat format, int framesPerSecond);
+    void stopRecording();
+    bool isRecording() const;
+
+    // once per frame after the last draw, before the swap: collects finished
+    // readbacks and starts one for this frame if anything asked for it
+    void capture(int width, int height);
+    // blocks until every readback is mapped and every queued file written
+    void flush();
+
+    uint64_t getCapturedFrames() const;
+    uint64_t getDroppedFrames() const;
+
+private:
+    enum JobKind
+    {
+        JOB_PNG,
+        JOB_VIDEO_OPEN,
+        JOB_VIDEO_FRAME,
+        JOB_VIDEO_CLOSE
+    };
+
+    struct Job
+    {
+        JobKind kind;
+        char path[MAX_PATH];
+        int width;
+        int height;
+        int framesPerSecond;
+        bool droppable;                 // recorded frame, refused when the queue is full
+        std::vector<uint8_t>* pixels;   // from pixelPool, RGBA8 bottom-up as read from GL; NULL without pixels
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<GLBuffer> buffer;
+        GLsizeiptr capacity;
+        GLsync fence;
+        int width;
+        int height;
+        std::vector<std::string> screenshots;   // paths waiting on this readback
+        bool videoFrame;
+    };
+
+    // GL thread
+    Slot slots[FRAME_CAPTURE_RING];
+    int writeSlot;
+    int readSlot;
+    int inFlight;
+    std::vector<std::string> requestedScreenshots;
+    bool recording;
+    std::string recordPath;
+    CaptureFormat recordFormat;
+    int recordFramesPerSecond;
+    bool videoOpen;
+    int videoWidth;
+    int videoHeight;
+    uint64_t sequenceIndex;
+    uint64_t capturedFrames;
+    uint64_t droppedFrames;
+
+    // shared with the encoder
+    std::thread encoder;
+    Job jobs[FRAME_CAPTURE_JOBS];      // ring in submission order
+    int jobsFirst;
+    int jobsCount;
+    FixedPool<std::vector<uint8_t>, FRAME_CAPTURE_PIXEL_BUFFERS> pixelPool;
+    int queuedFrames;
+    bool busy;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable signal;
+
+    // maps the oldest readback if its fence signalled, or waits for it
+    bool collect(bool wait);
+    void finishVideo();
+    // copy of a mapped readback in a pooled buffer, NULL when every buffer is out
+    std::vector<uint8_t>* copyPixels(const uint8_t* mapped, size_t size);
+    // droppable jobs beyond FRAME_CAPTURE_MAX_QUEUED are refused, others always
+    // queue, waiting for the encoder if the ring is full; a refused job's
+    // pixels go back to the pool
+    bool enqueue(const Job& job);
+
+    static Job MakeJob(JobKind kind, const char* path, int width, int height);
+    void encoderMain();
+    // planes is the encoder's scratch, kept across frames
+    static void WriteY4mFrame(FILE* file, const Job& job, std::vector<uint8_t>& planes);
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,180 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <stdint.h>
+#include <math.h>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE 1
+#endif
+
+// Six world-space planes (xyz = normal pointing inwards, w = distance)
+// extracted from a view-projection matrix. Order: left, right, bottom, top,
+// near, far.
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    static Frustum FromMatrix(const glm::mat4& viewProjection)
+    {
+        Frustum frustum;
+        const glm::mat4& m = viewProjection;
+        glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        frustum.planes[0] = row3 + row0;
+        frustum.planes[1] = row3 - row0;
+        frustum.planes[2] = row3 + row1;
+        frustum.planes[3] = row3 - row1;
+        frustum.planes[4] = row3 + row2;
+        frustum.planes[5] = row3 - row2;
+
+        for (int i = 0; i < 6; i++)
+        {
+            float length = glm::length(glm::vec3(frustum.planes[i]));
+            frustum.planes[i] = frustum.planes[i] / length;
+        }
+        return frustum;
+    }
+
+    // true when the box (center, half extent) is at least partially inside
+    bool intersectsAabb(const glm::vec3& center, const glm::vec3& extent) const
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            const glm::vec4& p = planes[i];
+            float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float r = fabsf(p.x) * extent.x + fabsf(p.y) * extent.y + fabsf(p.z) * extent.z;
+            if (d + r < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+
+// CPU fallback culler. Bounds are kept as structure-of-arrays so four boxes
+// are tested per plane with one SSE op. Has no GL dependency.
+class FrustumCuller
+{
+public:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    // ------------------------------------------------------------------------
+    uint32_t add(const glm::vec3& center, const glm::vec3& extent)
+    {
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        extentX.push_back(extent.x);
+        extentY.push_back(extent.y);
+        extentZ.push_back(extent.z);
+        return (uint32_t)(centerX.size() - 1);
+    }
+    // ------------------------------------------------------------------------
+    void set(size_t index, const glm::vec3& center, const glm::vec3& extent)
+    {
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extent.x;
+        extentY[index] = extent.y;
+        extentZ[index] = extent.z;
+    }
+    // ------------------------------------------------------------------------
+    void resize(size_t count)
+    {
+        centerX.resize(count); centerY.resize(count); centerZ.resize(count);
+        extentX.resize(count); extentY.resize(count); extentZ.resize(count);
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        centerX.clear(); centerY.clear(); centerZ.clear();
+        extentX.clear(); extentY.clear(); extentZ.clear();
+    }
+    // ------------------------------------------------------------------------
+    size_t size() const
+    {
+        return centerX.size();
+    }
+    // writes indices of visible boxes into outVisible, returns how many
+    // ------------------------------------------------------------------------
+    size_t cull(const Frustum& frustum, std::vector<uint32_t>& outVisible) const
+    {
+        outVisible.resize(size());
+        size_t count = cull(frustum, 0, size(), outVisible.data());
+        outVisible.resize(count);
+        return count;
+    }
+    // boxes [begin, end) only, so ranges can be culled on different threads;
+    // outVisible needs room for end - begin indices
+    // ------------------------------------------------------------------------
+    size_t cull(const Frustum& frustum, size_t begin, size_t end, uint32_t* outVisible) const
+    {
+        size_t count = 0;
+        size_t i = begin;
+
+#ifdef FRUSTUM_USE_SSE
+        __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+        for (int p = 0; p < 6; p++)
+        {
+            nx[p] = _mm_set1_ps(frustum.planes[p].x);
+            ny[p] = _mm_set1_ps(frustum.planes[p].y);
+            nz[p] = _mm_set1_ps(frustum.planes[p].z);
+            nw[p] = _mm_set1_ps(frustum.planes[p].w);
+            ax[p] = _mm_set1_ps(fabsf(frustum.planes[p].x));
+            ay[p] = _mm_set1_ps(fabsf(frustum.planes[p].y));
+            az[p] = _mm_set1_ps(fabsf(frustum.planes[p].z));
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centerX[i]);
+            __m128 cy = _mm_loadu_ps(&centerY[i]);
+            __m128 cz = _mm_loadu_ps(&centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]);
+            __m128 ey = _mm_loadu_ps(&extentY[i]);
+            __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+                __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (mask & (1 << lane))
+                    outVisible[count++] = (uint32_t)(i + lane);
+            }
+        }
+#endif
+
+        // scalar tail (or everything when SSE is unavailable)
+        for (; i < end; i++)
+        {
+            glm::vec3 center = glm::vec3(centerX[i], centerY[i], centerZ[i]);
+            glm::vec3 extent = glm::vec3(extentX[i], extentY[i], extentZ[i]);
+            if (frustum.intersectsAabb(center, extent))
+                outVisible[count++] = (uint32_t)i;
+        }
+
+        return count;
+    }
+};
+
+
+#endif
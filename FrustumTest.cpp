@@ -0,0 +1,137 @@
+#include "FrustumTest.h"
+
+#include <math.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Frustum.h"
+#include "Logger.h"
+
+// camera at the origin looking down -z, 90 degree square frustum: at depth d
+// the side planes sit at x, y = +-d
+#define FRUSTUM_TEST_NEAR 1.0f
+#define FRUSTUM_TEST_FAR 100.0f
+#define FRUSTUM_TEST_EPSILON 1e-4f
+
+struct FrustumTestBox
+{
+    const char* name;
+    glm::vec3 center;
+    glm::vec3 extent;
+    bool visible;
+};
+
+static const FrustumTestBox testBoxes[] = {
+    { "inside",               glm::vec3(0.0f, 0.0f, -10.0f),    glm::vec3(1.0f), true },
+    { "behind the camera",    glm::vec3(0.0f, 0.0f, 10.0f),     glm::vec3(1.0f), false },
+    { "left of the frustum",  glm::vec3(-30.0f, 0.0f, -10.0f),  glm::vec3(1.0f), false },
+    { "above the frustum",    glm::vec3(0.0f, 30.0f, -10.0f),   glm::vec3(1.0f), false },
+    { "straddling the left",  glm::vec3(-10.0f, 0.0f, -10.0f),  glm::vec3(1.0f), true },
+    { "straddling the top",   glm::vec3(0.0f, 10.0f, -10.0f),   glm::vec3(1.0f), true },
+    { "straddling the near",  glm::vec3(0.0f, 0.0f, -1.0f),     glm::vec3(0.25f), true },
+    { "between eye and near", glm::vec3(0.0f, 0.0f, -0.5f),     glm::vec3(0.25f), false },
+    { "straddling the far",   glm::vec3(0.0f, 0.0f, -100.0f),   glm::vec3(1.0f), true },
+    { "past the far",         glm::vec3(0.0f, 0.0f, -150.0f),   glm::vec3(1.0f), false },
+    { "large, around the eye", glm::vec3(0.0f),                 glm::vec3(50.0f), true },
+};
+static const int TEST_BOX_COUNT = sizeof(testBoxes) / sizeof(testBoxes[0]);
+
+static float planeDistance(const glm::vec4& plane, const glm::vec3& point)
+{
+    return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+}
+
+static bool checkPlanes(const Frustum& frustum)
+{
+    static const char* const planeNames[6] = { "left", "right", "bottom", "top", "near", "far" };
+    bool passed = true;
+    for (int i = 0; i < 6; i++)
+    {
+        float length = glm::length(glm::vec3(frustum.planes[i]));
+        if (fabsf(length - 1.0f) > FRUSTUM_TEST_EPSILON)
+        {
+            LOG_ERROR("Frustum test: %s plane normal has length %f", planeNames[i], length);
+            passed = false;
+        }
+        // a point well inside is in front of every plane
+        if (planeDistance(frustum.planes[i], glm::vec3(0.0f, 0.0f, -10.0f)) <= 0.0f)
+        {
+            LOG_ERROR("Frustum test: %s plane does not face inwards", planeNames[i]);
+            passed = false;
+        }
+    }
+
+    // near and far at their distances along the view axis, sides through the eye
+    float nearDistance = planeDistance(frustum.planes[4], glm::vec3(0.0f));
+    float farDistance = planeDistance(frustum.planes[5], glm::vec3(0.0f));
+    if (fabsf(nearDistance + FRUSTUM_TEST_NEAR) > 1e-3f || fabsf(farDistance - FRUSTUM_TEST_FAR) > 1e-2f)
+    {
+        LOG_ERROR("Frustum test: eye is %f from the near plane and %f from the far plane, expected %f and %f",
+            nearDistance, farDistance, -FRUSTUM_TEST_NEAR, FRUSTUM_TEST_FAR);
+        passed = false;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        float distance = planeDistance(frustum.planes[i], glm::vec3(0.0f));
+        if (fabsf(distance) > 1e-3f)
+        {
+            LOG_ERROR("Frustum test: %s plane misses the eye by %f", planeNames[i], distance);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+bool FrustumTest::run()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, FRUSTUM_TEST_NEAR, FRUSTUM_TEST_FAR);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::FromMatrix(projection * view);
+
+    bool passed = checkPlanes(frustum);
+
+    // scalar test
+    for (int i = 0; i < TEST_BOX_COUNT; i++)
+    {
+        const FrustumTestBox& box = testBoxes[i];
+        if (frustum.intersectsAabb(box.center, box.extent) != box.visible)
+        {
+            LOG_ERROR("Frustum test: box %s classified %s", box.name, box.visible ? "outside" : "inside");
+            passed = false;
+        }
+    }
+
+    // the culler, once starting at every offset so each box goes through the
+    // SSE batches and the scalar tail
+    FrustumCuller culler;
+    for (int i = 0; i < TEST_BOX_COUNT; i++)
+        culler.add(testBoxes[i].center, testBoxes[i].extent);
+    std::vector<uint32_t> visible(TEST_BOX_COUNT);
+    for (int begin = 0; begin < 4; begin++)
+    {
+        size_t count = culler.cull(frustum, begin, TEST_BOX_COUNT, visible.data());
+        size_t next = 0;
+        for (int i = begin; i < TEST_BOX_COUNT; i++)
+        {
+            bool culled = !(next < count && visible[next] == (uint32_t)i);
+            if (!culled)
+                next++;
+            if (culled == testBoxes[i].visible)
+            {
+                LOG_ERROR("Frustum test: culler from %d %s box %s", begin, culled ? "culled" : "kept", testBoxes[i].name);
+                passed = false;
+            }
+        }
+        if (next != count)
+        {
+            LOG_ERROR("Frustum test: culler from %d returned %d ids out of order or range", begin, (int)count);
+            passed = false;
+        }
+    }
+
+    if (passed)
+        LOG_INFO("Frustum test passed: 6 planes, %d boxes", TEST_BOX_COUNT);
+    return passed;
+}
@@ -0,0 +1,17 @@
+#ifndef FRUSTUMTEST_H
+#define FRUSTUMTEST_H
+
+// Headless checks of Frustum and FrustumCuller against a known camera:
+// plane extraction (normalized, inward facing, near and far where the
+// projection puts them) and box classification for boxes inside, outside,
+// straddling a side plane and straddling or past the near and far planes,
+// through both the scalar test and the culler's SSE batches. Needs no GL
+// context; runs from "OGL.exe -selftest", failures go to the log.
+class FrustumTest
+{
+public:
+    // false when any check fails
+    static bool run();
+};
+
+#endif // FRUSTUMTEST_H
@@ -0,0 +1,328 @@
+#pragma once
+#ifndef GL_OBJECTS_H
+#define GL_OBJECTS_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include "Logger.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+// Thin owning wrappers over GL object names, built on direct state access so
+// creating and filling an object never disturbs the current bindings.
+// Move-only; the destructor deletes the name. Storage calls are reported to
+// GpuMemory, so every allocation made through here is accounted for.
+
+class GLBuffer
+{
+public:
+    GLuint ID;
+
+    GLBuffer() : ID(0) { glCreateBuffers(1, &ID); }
+    ~GLBuffer() { release(); }
+    GLBuffer(const GLBuffer&) = delete;
+    GLBuffer& operator=(const GLBuffer&) = delete;
+    GLBuffer(GLBuffer&& other) noexcept : ID(other.ID) { other.ID = 0; }
+    GLBuffer& operator=(GLBuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            ID = other.ID;
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    // immutable storage (glNamedBufferStorage), size fixed for the buffer's lifetime
+    // ------------------------------------------------------------------------
+    void storage(GLsizeiptr size, const void* data, GLbitfield flags)
+    {
+        glNamedBufferStorage(ID, size, data, flags);
+        GpuMemory::Track(GPU_RESOURCE_BUFFER, ID, size, 0);
+    }
+    // mutable storage, may be respecified
+    // ------------------------------------------------------------------------
+    void data(GLsizeiptr size, const void* data, GLenum usage)
+    {
+        glNamedBufferData(ID, size, data, usage);
+        GpuMemory::Track(GPU_RESOURCE_BUFFER, ID, size, 0);
+    }
+    // ------------------------------------------------------------------------
+    void subData(GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        glNamedBufferSubData(ID, offset, size, data);
+    }
+    // ------------------------------------------------------------------------
+    void* mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+        return glMapNamedBufferRange(ID, offset, length, access);
+    }
+    // ------------------------------------------------------------------------
+    void unmap()
+    {
+        glUnmapNamedBuffer(ID);
+    }
+    // ------------------------------------------------------------------------
+    void copyTo(GLBuffer& destination, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) const
+    {
+        glCopyNamedBufferSubData(ID, destination.ID, readOffset, writeOffset, size);
+    }
+
+private:
+    void release()
+    {
+        if (ID == 0)
+            return;
+        GLState::BufferDeleted(ID);
+        GpuMemory::Untrack(GPU_RESOURCE_BUFFER, ID);
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+};
+
+
+class GLVertexArray
+{
+public:
+    GLuint ID;
+
+    GLVertexArray() : ID(0) { glCreateVertexArrays(1, &ID); }
+    ~GLVertexArray() { release(); }
+    GLVertexArray(const GLVertexArray&) = delete;
+    GLVertexArray& operator=(const GLVertexArray&) = delete;
+    GLVertexArray(GLVertexArray&& other) noexcept : ID(other.ID) { other.ID = 0; }
+    GLVertexArray& operator=(GLVertexArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            ID = other.ID;
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    // describe a float attribute read from a buffer binding slot
+    // ------------------------------------------------------------------------
+    void attrib(GLuint location, GLint size, GLenum type, GLboolean normalized, GLuint relativeOffset, GLuint bindingIndex)
+    {
+        glEnableVertexArrayAttrib(ID, location);
+        glVertexArrayAttribFormat(ID, location, size, type, normalized, relativeOffset);
+        glVertexArrayAttribBinding(ID, location, bindingIndex);
+    }
+    // integer attribute (ivec/uvec in the shader)
+    // ------------------------------------------------------------------------
+    void attribInteger(GLuint location, GLint size, GLenum type, GLuint relativeOffset, GLuint bindingIndex)
+    {
+        glEnableVertexArrayAttrib(ID, location);
+        glVertexArrayAttribIFormat(ID, location, size, type, relativeOffset);
+        glVertexArrayAttribBinding(ID, location, bindingIndex);
+    }
+    // ------------------------------------------------------------------------
+    void vertexBuffer(GLuint bindingIndex, const GLBuffer& buffer, GLintptr offset, GLsizei stride)
+    {
+        glVertexArrayVertexBuffer(ID, bindingIndex, buffer.ID, offset, stride);
+    }
+    // divisor 1 = per-instance data
+    // ------------------------------------------------------------------------
+    void bindingDivisor(GLuint bindingIndex, GLuint divisor)
+    {
+        glVertexArrayBindingDivisor(ID, bindingIndex, divisor);
+    }
+    // ------------------------------------------------------------------------
+    void elementBuffer(const GLBuffer& buffer)
+    {
+        glVertexArrayElementBuffer(ID, buffer.ID);
+    }
+
+private:
+    void release()
+    {
+        if (ID == 0)
+            return;
+        GLState::VertexArrayDeleted(ID);
+        glDeleteVertexArrays(1, &ID);
+        ID = 0;
+    }
+};
+
+
+class GLTexture
+{
+public:
+    GLuint ID;
+    GLenum target;
+
+    explicit GLTexture(GLenum textureTarget) : ID(0), target(textureTarget) { glCreateTextures(target, 1, &ID); }
+    ~GLTexture() { release(); }
+    GLTexture(const GLTexture&) = delete;
+    GLTexture& operator=(const GLTexture&) = delete;
+    GLTexture(GLTexture&& other) noexcept : ID(other.ID), target(other.target) { other.ID = 0; }
+    GLTexture& operator=(GLTexture&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            ID = other.ID;
+            target = other.target;
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    // ------------------------------------------------------------------------
+    void storage2D(GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+    {
+        glTextureStorage2D(ID, levels, internalFormat, width, height);
+        GLsizei faces = (target == GL_TEXTURE_CUBE_MAP) ? 6 : 1;
+        GpuMemory::Track(GPU_RESOURCE_TEXTURE, ID, GpuMemory::TextureBytes(internalFormat, width, height, faces, levels, false), internalFormat);
+    }
+    // also used for 2D arrays (depth = layers)
+    // ------------------------------------------------------------------------
+    void storage3D(GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth)
+    {
+        glTextureStorage3D(ID, levels, internalFormat, width, height, depth);
+        GpuMemory::Track(GPU_RESOURCE_TEXTURE, ID, GpuMemory::TextureBytes(internalFormat, width, height, depth, levels, target == GL_TEXTURE_3D), internalFormat);
+    }
+    // ------------------------------------------------------------------------
+    void subImage2D(GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+    {
+        glTextureSubImage2D(ID, level, x, y, width, height, format, type, pixels);
+    }
+    // ------------------------------------------------------------------------
+    void subImage3D(GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+    {
+        glTextureSubImage3D(ID, level, x, y, z, width, height, depth, format, type, pixels);
+    }
+    // ------------------------------------------------------------------------
+    void parameter(GLenum name, GLint value)
+    {
+        glTextureParameteri(ID, name, value);
+    }
+    // ------------------------------------------------------------------------
+    void generateMipmap()
+    {
+        glGenerateTextureMipmap(ID);
+    }
+
+private:
+    void release()
+    {
+        if (ID == 0)
+            return;
+        GLState::TextureDeleted(ID);
+        GpuMemory::Untrack(GPU_RESOURCE_TEXTURE, ID);
+        glDeleteTextures(1, &ID);
+        ID = 0;
+    }
+};
+
+
+class GLRenderbuffer
+{
+public:
+    GLuint ID;
+
+    GLRenderbuffer() : ID(0) { glCreateRenderbuffers(1, &ID); }
+    ~GLRenderbuffer() { release(); }
+    GLRenderbuffer(const GLRenderbuffer&) = delete;
+    GLRenderbuffer& operator=(const GLRenderbuffer&) = delete;
+    GLRenderbuffer(GLRenderbuffer&& other) noexcept : ID(other.ID) { other.ID = 0; }
+    GLRenderbuffer& operator=(GLRenderbuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            ID = other.ID;
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    // may be respecified (e.g. on resize)
+    // ------------------------------------------------------------------------
+    void storage(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei samples = 0)
+    {
+        if (samples > 0)
+            glNamedRenderbufferStorageMultisample(ID, samples, internalFormat, width, height);
+        else
+            glNamedRenderbufferStorage(ID, internalFormat, width, height);
+        GLsizei sampleCount = (samples > 0) ? samples : 1;
+        GpuMemory::Track(GPU_RESOURCE_RENDERBUFFER, ID, GpuMemory::TextureBytes(internalFormat, width, height, sampleCount, 1, false), internalFormat);
+    }
+
+private:
+    void release()
+    {
+        if (ID == 0)
+            return;
+        GpuMemory::Untrack(GPU_RESOURCE_RENDERBUFFER, ID);
+        glDeleteRenderbuffers(1, &ID);
+        ID = 0;
+    }
+};
+
+
+class GLFramebuffer
+{
+public:
+    GLuint ID;
+
+    GLFramebuffer() : ID(0) { glCreateFramebuffers(1, &ID); }
+    ~GLFramebuffer() { release(); }
+    GLFramebuffer(const GLFramebuffer&) = delete;
+    GLFramebuffer& operator=(const GLFramebuffer&) = delete;
+    GLFramebuffer(GLFramebuffer&& other) noexcept : ID(other.ID) { other.ID = 0; }
+    GLFramebuffer& operator=(GLFramebuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            ID = other.ID;
+            other.ID = 0;
+        }
+        return *this;
+    }
+
+    // ------------------------------------------------------------------------
+    void texture(GLenum attachment, const GLTexture& texture, GLint level = 0)
+    {
+        glNamedFramebufferTexture(ID, attachment, texture.ID, level);
+    }
+    // ------------------------------------------------------------------------
+    void renderbuffer(GLenum attachment, const GLRenderbuffer& renderbuffer)
+    {
+        glNamedFramebufferRenderbuffer(ID, attachment, GL_RENDERBUFFER, renderbuffer.ID);
+    }
+    // ------------------------------------------------------------------------
+    void drawBuffers(GLsizei count, const GLenum* buffers)
+    {
+        glNamedFramebufferDrawBuffers(ID, count, buffers);
+    }
+    // ------------------------------------------------------------------------
+    bool isComplete() const
+    {
+        GLenum status = glCheckNamedFramebufferStatus(ID, GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            LOG_ERROR("Framebuffer %u incomplete: 0x%x", ID, status);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void release()
+    {
+        if (ID == 0)
+            return;
+        GLState::FramebufferDeleted(ID);
+        glDeleteFramebuffers(1, &ID);
+        ID = 0;
+    }
+};
+
+
+#endif
@@ -0,0 +1,274 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <stdint.h>
+
+#define GL_STATE_MAX_INDEXED_BINDINGS 16
+#define GL_STATE_MAX_TEXTURE_UNITS 32
+#define GL_STATE_MAX_CAPS 16
+
+// Shadow copy of the GL binding/state we touch most. Every setter compares
+// against the last value it issued and skips the GL call when nothing would
+// change. Code that changes state behind the cache's back (third party
+// libraries, raw gl calls) must call Invalidate() afterwards.
+class GLState
+{
+public:
+    // ------------------------------------------------------------------------
+    static void UseProgram(GLuint program)
+    {
+        if (program == currentProgram) { elided++; return; }
+        currentProgram = program;
+        issued++;
+        glUseProgram(program);
+    }
+    // ------------------------------------------------------------------------
+    static void BindVertexArray(GLuint vao)
+    {
+        if (vao == currentVertexArray) { elided++; return; }
+        currentVertexArray = vao;
+        issued++;
+        glBindVertexArray(vao);
+    }
+    // non-indexed buffer targets (GL_ELEMENT_ARRAY_BUFFER is VAO state, set it on the VAO)
+    // ------------------------------------------------------------------------
+    static void BindBuffer(GLenum target, GLuint buffer)
+    {
+        int slot = bufferSlot(target);
+        if (slot < 0) { issued++; glBindBuffer(target, buffer); return; }
+        if (buffers[slot] == buffer) { elided++; return; }
+        buffers[slot] = buffer;
+        issued++;
+        glBindBuffer(target, buffer);
+    }
+    // GL_UNIFORM_BUFFER / GL_SHADER_STORAGE_BUFFER / GL_ATOMIC_COUNTER_BUFFER, whole buffer
+    // ------------------------------------------------------------------------
+    static void BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        BindBufferRange(target, index, buffer, 0, 0);
+    }
+    // size 0 means the whole buffer (glBindBufferBase)
+    // ------------------------------------------------------------------------
+    static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        IndexedBinding* binding = indexedSlot(target, index);
+        if (binding && binding->buffer == buffer && binding->offset == offset && binding->size == size) { elided++; return; }
+        if (binding)
+        {
+            binding->buffer = buffer;
+            binding->offset = offset;
+            binding->size = size;
+        }
+        issued++;
+        if (size == 0)
+            glBindBufferBase(target, index, buffer);
+        else
+            glBindBufferRange(target, index, buffer, offset, size);
+        // the indexed bind also replaces the generic binding point
+        int slot = bufferSlot(target);
+        if (slot >= 0)
+            buffers[slot] = buffer;
+    }
+    // ------------------------------------------------------------------------
+    static void BindTextureUnit(GLuint unit, GLuint texture)
+    {
+        if (unit < GL_STATE_MAX_TEXTURE_UNITS && textures[unit] == texture) { elided++; return; }
+        if (unit < GL_STATE_MAX_TEXTURE_UNITS)
+            textures[unit] = texture;
+        issued++;
+        glBindTextureUnit(unit, texture);
+    }
+    // ------------------------------------------------------------------------
+    static void BindFramebuffer(GLuint framebuffer)
+    {
+        if (framebuffer == currentFramebuffer) { elided++; return; }
+        currentFramebuffer = framebuffer;
+        issued++;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+    // ------------------------------------------------------------------------
+    static void Enable(GLenum cap)
+    {
+        setCap(cap, true);
+    }
+    // ------------------------------------------------------------------------
+    static void Disable(GLenum cap)
+    {
+        setCap(cap, false);
+    }
+    // ------------------------------------------------------------------------
+    static void DepthFunc(GLenum func)
+    {
+        if (func == depthFunc) { elided++; return; }
+        depthFunc = func;
+        issued++;
+        glDepthFunc(func);
+    }
+    // ------------------------------------------------------------------------
+    static void DepthMask(GLboolean mask)
+    {
+        if (mask == depthMask) { elided++; return; }
+        depthMask = mask;
+        issued++;
+        glDepthMask(mask);
+    }
+    // all four channels at once, per-channel masks are not used
+    // ------------------------------------------------------------------------
+    static void ColorMask(GLboolean mask)
+    {
+        if (mask == colorMask) { elided++; return; }
+        colorMask = mask;
+        issued++;
+        glColorMask(mask, mask, mask, mask);
+    }
+    // ------------------------------------------------------------------------
+    static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (x == viewport[0] && y == viewport[1] && width == viewport[2] && height == viewport[3]) { elided++; return; }
+        viewport[0] = x; viewport[1] = y; viewport[2] = width; viewport[3] = height;
+        issued++;
+        glViewport(x, y, width, height);
+    }
+    // forget everything, the next call of each setter is always issued
+    // ------------------------------------------------------------------------
+    static void Invalidate()
+    {
+        currentProgram = currentVertexArray = currentFramebuffer = INVALID;
+        for (int i = 0; i < BUFFER_SLOTS; i++) buffers[i] = INVALID;
+        for (int i = 0; i < GL_STATE_MAX_INDEXED_BINDINGS; i++)
+        {
+            uniformBindings[i].buffer = INVALID;
+            storageBindings[i].buffer = INVALID;
+        }
+        for (int i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i++) textures[i] = INVALID;
+        capCount = 0;
+        depthFunc = INVALID;
+        depthMask = 0xFF;
+        colorMask = 0xFF;
+        viewport[0] = viewport[1] = -1;
+        viewport[2] = viewport[3] = -1;
+    }
+
+    // object destruction hooks, so a recycled name is never mistaken for a cached binding
+    // ------------------------------------------------------------------------
+    static void ProgramDeleted(GLuint program)
+    {
+        if (currentProgram == program) currentProgram = INVALID;
+    }
+    static void VertexArrayDeleted(GLuint vao)
+    {
+        if (currentVertexArray == vao) currentVertexArray = INVALID;
+    }
+    static void FramebufferDeleted(GLuint framebuffer)
+    {
+        if (currentFramebuffer == framebuffer) currentFramebuffer = INVALID;
+    }
+    static void BufferDeleted(GLuint buffer)
+    {
+        for (int i = 0; i < BUFFER_SLOTS; i++)
+            if (buffers[i] == buffer) buffers[i] = INVALID;
+        for (int i = 0; i < GL_STATE_MAX_INDEXED_BINDINGS; i++)
+        {
+            if (uniformBindings[i].buffer == buffer) uniformBindings[i].buffer = INVALID;
+            if (storageBindings[i].buffer == buffer) storageBindings[i].buffer = INVALID;
+        }
+    }
+    static void TextureDeleted(GLuint texture)
+    {
+        for (int i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i++)
+            if (textures[i] == texture) textures[i] = INVALID;
+    }
+
+    // counters
+    [[nodiscard]] static uint64_t GetIssued() noexcept { return issued; }
+    [[nodiscard]] static uint64_t GetElided() noexcept { return elided; }
+    static void ResetCounters() noexcept { issued = 0; elided = 0; }
+
+private:
+    struct IndexedBinding
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    static constexpr GLuint INVALID = 0xFFFFFFFFu;
+    static constexpr int BUFFER_SLOTS = 9;
+
+    inline static uint64_t issued = 0;
+    inline static uint64_t elided = 0;
+
+    inline static GLuint currentProgram = INVALID;
+    inline static GLuint currentVertexArray = INVALID;
+    inline static GLuint currentFramebuffer = INVALID;
+    inline static GLuint buffers[BUFFER_SLOTS] = { INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID };
+    // zero matches the defaults of a fresh context (nothing bound)
+    inline static IndexedBinding uniformBindings[GL_STATE_MAX_INDEXED_BINDINGS] = {};
+    inline static IndexedBinding storageBindings[GL_STATE_MAX_INDEXED_BINDINGS] = {};
+    inline static GLuint textures[GL_STATE_MAX_TEXTURE_UNITS] = {};
+    inline static GLenum caps[GL_STATE_MAX_CAPS] = {};
+    inline static bool capValues[GL_STATE_MAX_CAPS] = {};
+    inline static int capCount = 0;
+    inline static GLenum depthFunc = INVALID;
+    inline static GLboolean depthMask = 0xFF;
+    inline static GLboolean colorMask = 0xFF;
+    inline static GLint viewport[4] = { -1, -1, -1, -1 };
+
+    static int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_DRAW_INDIRECT_BUFFER: return 1;
+        case GL_DISPATCH_INDIRECT_BUFFER: return 2;
+        case GL_COPY_READ_BUFFER: return 3;
+        case GL_COPY_WRITE_BUFFER: return 4;
+        case GL_PIXEL_PACK_BUFFER: return 5;
+        case GL_PIXEL_UNPACK_BUFFER: return 6;
+        case GL_UNIFORM_BUFFER: return 7;
+        case GL_SHADER_STORAGE_BUFFER: return 8;
+        default: return -1;
+        }
+    }
+
+    static IndexedBinding* indexedSlot(GLenum target, GLuint index)
+    {
+        if (index >= GL_STATE_MAX_INDEXED_BINDINGS)
+            return NULL;
+        if (target == GL_UNIFORM_BUFFER)
+            return &uniformBindings[index];
+        if (target == GL_SHADER_STORAGE_BUFFER)
+            return &storageBindings[index];
+        return NULL;
+    }
+
+    static void setCap(GLenum cap, bool enabled)
+    {
+        for (int i = 0; i < capCount; i++)
+        {
+            if (caps[i] == cap)
+            {
+                if (capValues[i] == enabled) { elided++; return; }
+                capValues[i] = enabled;
+                issued++;
+                if (enabled) glEnable(cap); else glDisable(cap);
+                return;
+            }
+        }
+        if (capCount < GL_STATE_MAX_CAPS)
+        {
+            caps[capCount] = cap;
+            capValues[capCount] = enabled;
+            capCount++;
+        }
+        issued++;
+        if (enabled) glEnable(cap); else glDisable(cap);
+    }
+};
+
+
+#endif
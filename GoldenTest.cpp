@@ -0,0 +1,236 @@
+#include "GoldenTest.h"
+
+#include <objbase.h>
+#include <stdlib.h>
+
+#include <glm/glm.hpp>
+
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include "Logger.h"
+
+GoldenTest::GoldenTest(const std::string& directory, bool update)
+    : directory(directory), update(update), comInitialized(false), width(0), height(0),
+      cpuMs(0.0), gpuMs(0.0), samples(0)
+{
+}
+
+void GoldenTest::begin(int targetWidth, int targetHeight)
+{
+    if (!comInitialized)
+    {
+        // golden images are read and written through WIC on this thread
+        CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        comInitialized = true;
+        const char* name = (const char*)glGetString(GL_RENDERER);
+        renderer = name ? name : "unknown";
+        CreateDirectoryA(directory.c_str(), NULL);
+    }
+
+    if (!framebuffer || targetWidth != width || targetHeight != height)
+    {
+        GPU_MEMORY_OWNER("golden test");
+        width = targetWidth;
+        height = targetHeight;
+        color.reset(new GLTexture(GL_TEXTURE_2D));
+        color->storage2D(1, GL_RGBA8, width, height);
+        framebuffer.reset(new GLFramebuffer());
+        framebuffer->texture(GL_COLOR_ATTACHMENT0, *color);
+        framebuffer->isComplete();
+    }
+}
+
+void GoldenTest::end(const char* name, bool timed, bool compareFrame)
+{
+    GLState::BindFramebuffer(0);
+
+    if (timed)
+    {
+        // the scenario has run for more than PROFILER_FRAME_LATENCY frames,
+        // so the latest published frame is one of its own
+        const Profiler::Frame& frame = Profiler::GetLatest();
+        cpuMs += frame.cpuMs;
+        gpuMs += frame.gpuMs;
+        samples++;
+    }
+    if (!compareFrame)
+        return;
+
+    Image actual;
+    actual.width = width;
+    actual.height = height;
+    actual.pixels.resize((size_t)width * height * 4);
+    glGetTextureImage(color->ID, 0, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)actual.pixels.size(), actual.pixels.data());
+    for (size_t i = 3; i < actual.pixels.size(); i += 4)
+        actual.pixels[i] = 255;
+
+    Result result;
+    result.name = name;
+    result.cpuMs = samples > 0 ? cpuMs / samples : 0.0;
+    result.gpuMs = samples > 0 ? gpuMs / samples : 0.0;
+    result.badFraction = 0.0;
+    result.ssim = 1.0;
+    result.updated = false;
+    cpuMs = gpuMs = 0.0;
+    samples = 0;
+
+    std::string goldenPath = directory + "/" + name + ".png";
+    if (update)
+    {
+        result.updated = actual.save(goldenPath);
+        result.passed = result.updated;
+        if (!result.updated)
+            LOG_ERROR("Golden image %s could not be written", goldenPath.c_str());
+    }
+    else
+    {
+        result.passed = compare(actual, result);
+        if (!result.passed)
+        {
+            std::string failed = directory + "/failed";
+            CreateDirectoryA(failed.c_str(), NULL);
+            actual.save(failed + "/" + name + "_actual.png");
+        }
+    }
+    results.push_back(result);
+}
+
+GLuint GoldenTest::getFramebuffer() const
+{
+    return framebuffer ? framebuffer->ID : 0;
+}
+
+void GoldenTest::releaseTargets()
+{
+    framebuffer.reset();
+    color.reset();
+    if (comInitialized)
+    {
+        CoUninitialize();
+        comInitialized = false;
+    }
+}
+
+void GoldenTest::report() const
+{
+    LOG_INFO("Golden images on %s (%s)", renderer.c_str(), update ? "updating" : "comparing");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        if (result.updated)
+            LOG_INFO("  %-28s updated   cpu %6.3f ms  gpu %6.3f ms", result.name.c_str(), result.cpuMs, result.gpuMs);
+        else if (result.passed)
+            LOG_INFO("  %-28s passed    cpu %6.3f ms  gpu %6.3f ms  differing %.4f%%  ssim %.4f", result.name.c_str(), result.cpuMs, result.gpuMs, result.badFraction * 100.0, result.ssim);
+        else
+            LOG_ERROR("  %-28s FAILED    cpu %6.3f ms  gpu %6.3f ms  differing %.4f%%  ssim %.4f", result.name.c_str(), result.cpuMs, result.gpuMs, result.badFraction * 100.0, result.ssim);
+    }
+    LOG_INFO("Golden images: %d of %d scenarios passed", (int)results.size() - getFailures(), (int)results.size());
+}
+
+int GoldenTest::getFailures() const
+{
+    int failures = 0;
+    for (size_t i = 0; i < results.size(); i++)
+        if (!results[i].passed)
+            failures++;
+    return failures;
+}
+
+bool GoldenTest::compare(const Image& actual, Result& result) const
+{
+    std::string goldenPath = directory + "/" + result.name + ".png";
+    Image golden;
+    if (!golden.load(goldenPath))
+    {
+        LOG_ERROR("No golden image %s, run with -golden=update to create it", goldenPath.c_str());
+        return false;
+    }
+    if (golden.width != actual.width || golden.height != actual.height)
+    {
+        LOG_ERROR("Golden image %s is %dx%d, the scenario renders %dx%d", goldenPath.c_str(), golden.width, golden.height, actual.width, actual.height);
+        return false;
+    }
+
+    size_t pixelCount = (size_t)actual.width * actual.height;
+    size_t differing = 0;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const uint8_t* a = &actual.pixels[i * 4];
+        const uint8_t* g = &golden.pixels[i * 4];
+        if (abs(a[0] - g[0]) > GOLDEN_CHANNEL_THRESHOLD || abs(a[1] - g[1]) > GOLDEN_CHANNEL_THRESHOLD || abs(a[2] - g[2]) > GOLDEN_CHANNEL_THRESHOLD)
+            differing++;
+    }
+    result.badFraction = (double)differing / (double)pixelCount;
+    result.ssim = Ssim(actual, golden);
+
+    bool passed = result.badFraction <= GOLDEN_MAX_BAD_FRACTION && result.ssim >= GOLDEN_MIN_SSIM;
+    if (!passed)
+    {
+        std::string failed = directory + "/failed";
+        CreateDirectoryA(failed.c_str(), NULL);
+        DiffImage(actual, golden).save(failed + "/" + result.name + "_diff.png");
+    }
+    return passed;
+}
+
+// mean SSIM of the Rec.601 luma over non-overlapping windows
+double GoldenTest::Ssim(const Image& a, const Image& b)
+{
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    const int n = GOLDEN_SSIM_WINDOW * GOLDEN_SSIM_WINDOW;
+
+    double total = 0.0;
+    int windows = 0;
+    for (int wy = 0; wy + GOLDEN_SSIM_WINDOW <= a.height; wy += GOLDEN_SSIM_WINDOW)
+    {
+        for (int wx = 0; wx + GOLDEN_SSIM_WINDOW <= a.width; wx += GOLDEN_SSIM_WINDOW)
+        {
+            double sumA = 0.0, sumB = 0.0, sumAA = 0.0, sumBB = 0.0, sumAB = 0.0;
+            for (int y = wy; y < wy + GOLDEN_SSIM_WINDOW; y++)
+            {
+                for (int x = wx; x < wx + GOLDEN_SSIM_WINDOW; x++)
+                {
+                    size_t i = ((size_t)y * a.width + x) * 4;
+                    double la = 0.299 * a.pixels[i] + 0.587 * a.pixels[i + 1] + 0.114 * a.pixels[i + 2];
+                    double lb = 0.299 * b.pixels[i] + 0.587 * b.pixels[i + 1] + 0.114 * b.pixels[i + 2];
+                    sumA += la;
+                    sumB += lb;
+                    sumAA += la * la;
+                    sumBB += lb * lb;
+                    sumAB += la * lb;
+                }
+            }
+            double meanA = sumA / n;
+            double meanB = sumB / n;
+            double varianceA = sumAA / n - meanA * meanA;
+            double varianceB = sumBB / n - meanB * meanB;
+            double covariance = sumAB / n - meanA * meanB;
+            total += ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) /
+                     ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+            windows++;
+        }
+    }
+    return windows > 0 ? total / windows : 1.0;
+}
+
+// dimmed golden with the differing pixels in red, brighter for larger errors
+Image GoldenTest::DiffImage(const Image& a, const Image& b)
+{
+    Image diff;
+    diff.width = a.width;
+    diff.height = a.height;
+    diff.pixels.resize(a.pixels.size());
+    for (size_t i = 0; i < a.pixels.size(); i += 4)
+    {
+        int error = glm::max(abs(a.pixels[i] - b.pixels[i]), glm::max(abs(a.pixels[i + 1] - b.pixels[i + 1]), abs(a.pixels[i + 2] - b.pixels[i + 2])));
+        uint8_t grey = (uint8_t)((b.pixels[i] + b.pixels[i + 1] + b.pixels[i + 2]) / 12);
+        bool differs = error > GOLDEN_CHANNEL_THRESHOLD;
+        diff.pixels[i + 0] = differs ? (uint8_t)glm::min(128 + error * 4, 255) : grey;
+        diff.pixels[i + 1] = differs ? 0 : grey;
+        diff.pixels[i + 2] = differs ? 0 : grey;
+        diff.pixels[i + 3] = 255;
+    }
+    return diff;
+}
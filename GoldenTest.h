@@ -0,0 +1,89 @@
+#ifndef GOLDENTEST_H
+#define GOLDENTEST_H
+
+#include <windows.h>
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "GLObjects.h"
+#include "Image.h"
+
+// a channel further off than this (0-255) marks the pixel as different
+#define GOLDEN_CHANNEL_THRESHOLD 10
+// share of different pixels a scenario may have and still pass
+#define GOLDEN_MAX_BAD_FRACTION 0.002
+// mean structural similarity of the luma, 8x8 windows
+#define GOLDEN_MIN_SSIM 0.97
+#define GOLDEN_SSIM_WINDOW 8
+
+// Render output regression check. Each scenario is rendered offscreen at a
+// fixed size into the harness' framebuffer with a fixed camera and time,
+// read back and compared against <directory>/<name>.png: a per-channel
+// threshold catches localized breakage, SSIM over the luma catches broad
+// shifts while tolerating the rounding differences between drivers. Profiler
+// timings of the scenario are reported alongside. Failing scenarios leave
+// <name>_actual.png and <name>_diff.png under <directory>/failed. A
+// scenario without a golden image fails; -golden=update writes the
+// references from a known-good run, to be looked at and committed.
+// Everything except the report runs on the GL thread.
+class GoldenTest
+{
+public:
+    // update rewrites the golden images instead of comparing against them
+    GoldenTest(const std::string& directory, bool update);
+
+    GoldenTest(const GoldenTest&) = delete;
+    GoldenTest& operator=(const GoldenTest&) = delete;
+
+    // (re)creates the offscreen target, getFramebuffer() is where the frame resolves to
+    void begin(int width, int height);
+    // timed: add the profiler's latest frame to the scenario's timings;
+    // compare: read the target back and check it against the golden image
+    void end(const char* name, bool timed, bool compare);
+    GLuint getFramebuffer() const;
+    // GL thread, before the context goes away
+    void releaseTargets();
+
+    // main thread, after rendering stopped: one line per scenario plus a summary
+    void report() const;
+    int getFailures() const;
+
+private:
+    struct Result
+    {
+        std::string name;
+        double cpuMs;
+        double gpuMs;
+        double badFraction;
+        double ssim;
+        bool passed;
+        bool updated;
+    };
+
+    std::string directory;
+    bool update;
+    std::string renderer;
+    bool comInitialized;
+
+    std::unique_ptr<GLFramebuffer> framebuffer;
+    std::unique_ptr<GLTexture> color;
+    int width;
+    int height;
+
+    double cpuMs;
+    double gpuMs;
+    int samples;
+    std::vector<Result> results;
+
+    bool compare(const Image& actual, Result& result) const;
+    static double Ssim(const Image& a, const Image& b);
+    static Image DiffImage(const Image& a, const Image& b);
+};
+
+#endif // GOLDENTEST_H
@@ -0,0 +1,352 @@
+#pragma once
+#ifndef GPU_DRIVEN_RENDERER_H
+#define GPU_DRIVEN_RENDERER_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+
+#include "Shader.h"
+#include "Frustum.h"
+#include "StreamBuffer.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "Logger.h"
+#include "JobSystem.h"
+#include "Memory.h"
+
+// SSBO binding points shared with shaders/cull.comp and shaders/gpu_driven.vs
+#define GPU_DRIVEN_OBJECTS_BINDING 0
+#define GPU_DRIVEN_COMMANDS_BINDING 1
+#define GPU_DRIVEN_VISIBLE_BINDING 2
+
+// objects per job for bulk adds and CPU culling, a multiple of the culler's 4-wide batches
+#define GPU_DRIVEN_JOB_BATCH 4096
+// objects per cull.comp workgroup, its specialization constant 0
+#define GPU_DRIVEN_CULL_GROUP 64
+
+// Scene submission path where the GPU decides what gets drawn. Meshes are
+// packed into one vertex/index buffer pair, every object gets its transform
+// and world bounds in an SSBO, cull.comp compacts the visible ids per mesh and
+// fills the indirect command buffer, and the whole scene goes out in a single
+// glMultiDrawElementsIndirect. cullCpu() produces the same data on the CPU
+// for drivers/debugging where the compute path is not wanted, writing it
+// straight into the frame's StreamBuffer region.
+class GpuDrivenRenderer
+{
+public:
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // std430 layout, must match ObjectData in the shaders
+    struct ObjectData
+    {
+        glm::mat4 model;
+        glm::vec4 boundsCenter;
+        glm::vec4 boundsExtent;
+        GLuint meshId[4];
+    };
+
+    GpuDrivenRenderer()
+        : cullShader("shaders/cull.comp", { { "GROUP_SIZE", 0, GPU_DRIVEN_CULL_GROUP } }), uploadedMeshes(0), visibleCount(0),
+          indirectBuffer(0), indirectOffset(0), visibleBuffer(0), visibleOffset(0), visibleSize(0), ssboAlignment(16)
+    {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+    }
+
+    GpuDrivenRenderer(const GpuDrivenRenderer&) = delete;
+    GpuDrivenRenderer& operator=(const GpuDrivenRenderer&) = delete;
+
+    // append a mesh (xyz positions, rgb colors) to the shared pool, returns mesh id
+    // ------------------------------------------------------------------------
+    uint32_t addMesh(const GLfloat* positions, const GLfloat* colors, GLsizei vertexCount, const GLuint* indices, GLsizei indexCount,
+                     const glm::vec3& localMin, const glm::vec3& localMax)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = (GLuint)indexCount;
+        command.instanceCount = 0;
+        command.firstIndex = (GLuint)meshIndices.size();
+        command.baseVertex = (GLint)(meshPositions.size() / 3);
+        command.baseInstance = 0;
+        commands.push_back(command);
+
+        meshPositions.insert(meshPositions.end(), positions, positions + vertexCount * 3);
+        meshColors.insert(meshColors.end(), colors, colors + vertexCount * 3);
+        meshIndices.insert(meshIndices.end(), indices, indices + indexCount);
+        meshBounds.push_back(localMin);
+        meshBounds.push_back(localMax);
+        return (uint32_t)(commands.size() - 1);
+    }
+    // add a static object; world bounds are derived from the mesh's local AABB
+    // ------------------------------------------------------------------------
+    uint32_t addObject(uint32_t meshId, const glm::mat4& model)
+    {
+        ObjectData object;
+        makeObject(meshId, model, object);
+        objects.push_back(object);
+        objectMesh.push_back(meshId);
+        cpuCuller.add(glm::vec3(object.boundsCenter), glm::vec3(object.boundsExtent));
+        return (uint32_t)(objects.size() - 1);
+    }
+    // addObject for a whole set of instances of one mesh, bounds are computed
+    // on the job system; returns the id of the first
+    // ------------------------------------------------------------------------
+    uint32_t addObjects(uint32_t meshId, const glm::mat4* models, size_t modelCount)
+    {
+        size_t first = objects.size();
+        size_t count = first + modelCount;
+        objects.resize(count);
+        objectMesh.resize(count, meshId);
+        cpuCuller.resize(count);
+
+        JobSystem::ParallelFor((int)modelCount, GPU_DRIVEN_JOB_BATCH, [&](int begin, int end)
+        {
+            for (int i = begin; i < end; i++)
+            {
+                ObjectData& object = objects[first + i];
+                makeObject(meshId, models[i], object);
+                cpuCuller.set(first + i, glm::vec3(object.boundsCenter), glm::vec3(object.boundsExtent));
+            }
+        });
+        return (uint32_t)first;
+    }
+    // drop all objects, keep the meshes; call build() again afterwards
+    // ------------------------------------------------------------------------
+    void clearObjects()
+    {
+        objects.clear();
+        objectMesh.clear();
+        cpuCuller.clear();
+    }
+    // upload meshes and objects, assign each mesh its slice of the visible id list
+    // ------------------------------------------------------------------------
+    void build()
+    {
+        // the pool lives in immutable storage: meshes added since the last
+        // upload get the whole pool in new buffers
+        if (uploadedMeshes != commands.size())
+        {
+            if (uploadedMeshes != 0)
+            {
+                vboPosition = GLBuffer();
+                vboColor = GLBuffer();
+                ebo = GLBuffer();
+            }
+            vboPosition.storage(meshPositions.size() * sizeof(GLfloat), meshPositions.data(), 0);
+            vboColor.storage(meshColors.size() * sizeof(GLfloat), meshColors.data(), 0);
+            ebo.storage(meshIndices.size() * sizeof(GLuint), meshIndices.data(), 0);
+
+            vao.vertexBuffer(0, vboPosition, 0, 3 * sizeof(GLfloat));
+            vao.attrib(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            vao.vertexBuffer(1, vboColor, 0, 3 * sizeof(GLfloat));
+            vao.attrib(1, 3, GL_FLOAT, GL_FALSE, 0, 1);
+            vao.elementBuffer(ebo);
+
+            indirectBuffer = commandBuffer.ID;
+            visibleBuffer = ssboVisible.ID;
+            uploadedMeshes = commands.size();
+        }
+
+        // prefix sum of per-mesh object counts gives each draw its baseInstance;
+        // build() runs on the render thread, its scratch lives until the frame ends
+        GLuint* perMesh = Memory::GetFrameArena(MEMORY_LOOP_RENDER).allocate<GLuint>(commands.size());
+        memset(perMesh, 0, commands.size() * sizeof(GLuint));
+        for (size_t i = 0; i < objectMesh.size(); i++)
+            perMesh[objectMesh[i]]++;
+        GLuint base = 0;
+        for (size_t m = 0; m < commands.size(); m++)
+        {
+            commands[m].baseInstance = base;
+            commands[m].instanceCount = 0;
+            base += perMesh[m];
+        }
+
+        ssboObjects.data(objects.size() * sizeof(ObjectData), objects.data(), GL_STATIC_DRAW);
+        ssboVisible.data((objects.size() + 1) * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+        commandTemplate.data(commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+        commandBuffer.data(commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+
+        LOG_INFO("GPU driven scene built: %d meshes, %d objects", (int)commands.size(), (int)objects.size());
+    }
+    // frustum culling on the GPU, no CPU readback
+    // ------------------------------------------------------------------------
+    void cullGpu(const glm::mat4& viewProjection)
+    {
+        // reset instanceCount of every command from the template
+        commandTemplate.copyTo(commandBuffer, 0, 0, commands.size() * sizeof(DrawElementsIndirectCommand));
+
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+        cullShader.use();
+        glProgramUniform4fv(cullShader.ID, glGetUniformLocation(cullShader.ID, "u_frustumPlanes"), 6, &frustum.planes[0][0]);
+        glProgramUniform1ui(cullShader.ID, glGetUniformLocation(cullShader.ID, "u_objectCount"), (GLuint)objects.size());
+
+        indirectBuffer = commandBuffer.ID;
+        indirectOffset = 0;
+        visibleBuffer = ssboVisible.ID;
+        visibleOffset = 0;
+        visibleSize = 0;
+
+        bindStorage();
+        glDispatchCompute(((GLuint)objects.size() + GPU_DRIVEN_CULL_GROUP - 1) / GPU_DRIVEN_CULL_GROUP, 1, 1);
+        Profiler::CountDispatch();
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+        visibleCount = -1; // unknown without a readback
+    }
+    // same result as cullGpu's frustum test, computed with the SIMD CPU culler
+    // in GPU_DRIVEN_JOB_BATCH ranges spread over the job system
+    // ------------------------------------------------------------------------
+    void cullCpu(const glm::mat4& viewProjection, StreamBuffer& stream)
+    {
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        size_t objectCount = cpuCuller.size();
+        int batchCount = (int)((objectCount + GPU_DRIVEN_JOB_BATCH - 1) / GPU_DRIVEN_JOB_BATCH);
+        cpuVisible.resize(objectCount);
+        batchVisible.resize(batchCount);
+        JobSystem::ParallelFor(batchCount, 1, [&](int begin, int end)
+        {
+            for (int batch = begin; batch < end; batch++)
+            {
+                size_t first = (size_t)batch * GPU_DRIVEN_JOB_BATCH;
+                size_t last = (first + GPU_DRIVEN_JOB_BATCH < objectCount) ? first + GPU_DRIVEN_JOB_BATCH : objectCount;
+                batchVisible[batch] = cpuCuller.cull(frustum, first, last, &cpuVisible[first]);
+            }
+        });
+
+        StreamBuffer::Allocation commandAlloc = stream.write(commands.data(), commands.size() * sizeof(DrawElementsIndirectCommand));
+        StreamBuffer::Allocation idAlloc = stream.allocate((objects.size() + 1) * sizeof(GLuint), ssboAlignment);
+        if (commandAlloc.ptr == NULL || idAlloc.ptr == NULL)
+        {
+            // the last cull's region may be reused already, draw() skips this frame
+            visibleCount = 0;
+            return;
+        }
+
+        // bucket into each mesh's slice; slices are sized for all its objects
+        DrawElementsIndirectCommand* frameCommands = (DrawElementsIndirectCommand*)commandAlloc.ptr;
+        GLuint* ids = (GLuint*)idAlloc.ptr;
+        size_t visible = 0;
+        for (int batch = 0; batch < batchCount; batch++)
+        {
+            const uint32_t* batchIds = &cpuVisible[(size_t)batch * GPU_DRIVEN_JOB_BATCH];
+            for (size_t i = 0; i < batchVisible[batch]; i++)
+            {
+                uint32_t id = batchIds[i];
+                DrawElementsIndirectCommand& command = frameCommands[objectMesh[id]];
+                ids[command.baseInstance + command.instanceCount++] = id;
+            }
+            visible += batchVisible[batch];
+        }
+
+        indirectBuffer = stream.buffer.ID;
+        indirectOffset = commandAlloc.offset;
+        visibleBuffer = stream.buffer.ID;
+        visibleOffset = idAlloc.offset;
+        visibleSize = idAlloc.size;
+
+        visibleCount = (int)visible;
+    }
+    // one multi-draw for every mesh, nothing when the last cull kept nothing;
+    // the bound program must be gpu_driven.vs based
+    // ------------------------------------------------------------------------
+    void draw()
+    {
+        if (visibleCount == 0)
+            return;
+        bindStorage();
+        GLState::BindVertexArray(vao.ID);
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)indirectOffset, (GLsizei)commands.size(), 0);
+        Profiler::CountDraw();
+    }
+    // visible objects after the last cullCpu(), -1 after a GPU cull
+    // ------------------------------------------------------------------------
+    int getVisibleCount() const
+    {
+        return visibleCount;
+    }
+    // ------------------------------------------------------------------------
+    size_t getObjectCount() const
+    {
+        return objects.size();
+    }
+
+private:
+    GLVertexArray vao;
+    GLBuffer vboPosition;
+    GLBuffer vboColor;
+    GLBuffer ebo;
+    GLBuffer ssboObjects;
+    GLBuffer commandBuffer;
+    GLBuffer commandTemplate;
+    GLBuffer ssboVisible;
+    Shader cullShader;
+    size_t uploadedMeshes;     // meshes in the pool buffers, 0 before the first build()
+    int visibleCount;
+
+    std::vector<GLfloat> meshPositions;
+    std::vector<GLfloat> meshColors;
+    std::vector<GLuint> meshIndices;
+    std::vector<glm::vec3> meshBounds;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    std::vector<ObjectData> objects;
+    std::vector<uint32_t> objectMesh;
+    FrustumCuller cpuCuller;
+    std::vector<uint32_t> cpuVisible;   // per batch, compacted at the start of its range
+    std::vector<size_t> batchVisible;
+
+    // where the last cull left the commands and visible ids
+    GLuint indirectBuffer;
+    GLintptr indirectOffset;
+    GLuint visibleBuffer;
+    GLintptr visibleOffset;
+    GLsizeiptr visibleSize;
+    // queried once, cullCpu binds its visible ids as an SSBO range
+    GLint ssboAlignment;
+
+    // world bounds derived from the mesh's local AABB
+    void makeObject(uint32_t meshId, const glm::mat4& model, ObjectData& object) const
+    {
+        glm::vec3 localMin = meshBounds[meshId * 2];
+        glm::vec3 localMax = meshBounds[meshId * 2 + 1];
+        glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+        glm::vec3 localExtent = (localMax - localMin) * 0.5f;
+
+        // transformed box extent: |M| * extent (Arvo)
+        glm::vec3 center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+        glm::vec3 extent;
+        for (int row = 0; row < 3; row++)
+        {
+            extent[row] = fabsf(model[0][row]) * localExtent.x + fabsf(model[1][row]) * localExtent.y + fabsf(model[2][row]) * localExtent.z;
+        }
+
+        object.model = model;
+        object.boundsCenter = glm::vec4(center, 0.0f);
+        object.boundsExtent = glm::vec4(extent, 0.0f);
+        object.meshId[0] = meshId;
+        object.meshId[1] = object.meshId[2] = object.meshId[3] = 0;
+    }
+
+    void bindStorage()
+    {
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_DRIVEN_OBJECTS_BINDING, ssboObjects.ID);
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_DRIVEN_COMMANDS_BINDING, commandBuffer.ID);
+        GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, GPU_DRIVEN_VISIBLE_BINDING, visibleBuffer, visibleOffset, visibleSize);
+    }
+};
+
+
+#endif
@@ -0,0 +1,327 @@
+#pragma once
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <windows.h>
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <algorithm>
+#include <functional>
+#include <string.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "Logger.h"
+
+enum GpuResourceType
+{
+    GPU_RESOURCE_BUFFER,
+    GPU_RESOURCE_TEXTURE,
+    GPU_RESOURCE_RENDERBUFFER,
+    GPU_RESOURCE_TYPE_COUNT
+};
+
+#define GPU_MEMORY_REPORT_LARGEST 10
+
+// Registry of every GL allocation: the GLObjects wrappers report each
+// storage call here with its size and format, tagged with the subsystem that
+// is current (GPU_MEMORY_OWNER) when it is made. A budget can be set;
+// Update() then asks the registered evict callbacks, lowest priority first,
+// to free or downgrade memory until the total is back under it. GL thread only.
+class GpuMemory
+{
+public:
+    // asked to free at least bytesOver, returns what it actually released
+    typedef std::function<uint64_t(uint64_t bytesOver)> EvictCallback;
+
+    // ------------------------------------------------------------------------
+    static void Track(GpuResourceType type, GLuint id, uint64_t bytes, GLenum format)
+    {
+        Untrack(type, id);
+        Record record = { type, id, bytes, format, currentOwner };
+        records[key(type, id)] = record;
+        totals[type] += bytes;
+        counts[type]++;
+
+        uint64_t total = GetTotal();
+        peak = (total > peak) ? total : peak;
+    }
+    // ------------------------------------------------------------------------
+    static void Untrack(GpuResourceType type, GLuint id)
+    {
+        auto it = records.find(key(type, id));
+        if (it == records.end())
+            return;
+        totals[type] -= it->second.bytes;
+        counts[type]--;
+        records.erase(it);
+    }
+    // owner tag for allocations made from now on, returns the previous one
+    // ------------------------------------------------------------------------
+    static const char* SetOwner(const char* owner)
+    {
+        const char* previous = currentOwner;
+        currentOwner = owner;
+        return previous;
+    }
+    // 0 disables the budget
+    // ------------------------------------------------------------------------
+    static void SetBudget(uint64_t bytes)
+    {
+        budget = bytes;
+        if (bytes)
+            LOG_INFO("GPU memory budget %.1f MB", bytes / (1024.0 * 1024.0));
+        else
+            LOG_INFO("GPU memory budget disabled");
+    }
+    // lower priorities are asked first; returns an id for RemoveEvictCallback
+    // ------------------------------------------------------------------------
+    static int AddEvictCallback(const char* owner, int priority, EvictCallback callback)
+    {
+        Evictor evictor = { nextEvictorId++, owner, priority, callback };
+        evictors.push_back(evictor);
+        std::stable_sort(evictors.begin(), evictors.end(), [](const Evictor& a, const Evictor& b) { return a.priority < b.priority; });
+        return evictor.id;
+    }
+    // ------------------------------------------------------------------------
+    static void RemoveEvictCallback(int id)
+    {
+        for (size_t i = 0; i < evictors.size(); i++)
+        {
+            if (evictors[i].id == id)
+            {
+                evictors.erase(evictors.begin() + i);
+                return;
+            }
+        }
+    }
+    // once per frame: enforce the budget
+    // ------------------------------------------------------------------------
+    static void Update()
+    {
+        uint64_t total = GetTotal();
+        if (budget == 0 || total <= budget)
+        {
+            overBudget = false;
+            return;
+        }
+
+        for (size_t i = 0; i < evictors.size() && GetTotal() > budget; i++)
+        {
+            uint64_t over = GetTotal() - budget;
+            uint64_t freed = evictors[i].callback(over);
+            if (freed > 0)
+                LOG_INFO("GPU memory: %s released %.1f MB of %.1f MB over budget", evictors[i].owner, freed / (1024.0 * 1024.0), over / (1024.0 * 1024.0));
+        }
+
+        // report once per excursion, not every frame
+        bool stillOver = GetTotal() > budget;
+        if (stillOver && !overBudget)
+            LOG_ERROR("GPU memory %.1f MB stays over the %.1f MB budget, nothing left to evict", GetTotal() / (1024.0 * 1024.0), budget / (1024.0 * 1024.0));
+        overBudget = stillOver;
+    }
+    // ------------------------------------------------------------------------
+    static void DumpReport()
+    {
+        LOG_INFO("GPU memory: %.2f MB in %d allocations, peak %.2f MB",
+            GetTotal() / (1024.0 * 1024.0), (int)records.size(), peak / (1024.0 * 1024.0));
+        if (budget)
+            LOG_INFO("  budget %.2f MB, %.2f MB headroom", budget / (1024.0 * 1024.0), ((double)budget - (double)GetTotal()) / (1024.0 * 1024.0));
+        for (int type = 0; type < GPU_RESOURCE_TYPE_COUNT; type++)
+            LOG_INFO("  %-14s %9.2f MB  (%d)", TypeName((GpuResourceType)type), totals[type] / (1024.0 * 1024.0), counts[type]);
+
+        // per owner, largest first
+        std::vector<std::pair<const char*, uint64_t>> owners;
+        std::vector<const Record*> sorted;
+        for (const auto& it : records)
+        {
+            sorted.push_back(&it.second);
+            size_t i = 0;
+            while (i < owners.size() && strcmp(owners[i].first, it.second.owner) != 0)
+                i++;
+            if (i == owners.size())
+                owners.push_back(std::make_pair(it.second.owner, (uint64_t)0));
+            owners[i].second += it.second.bytes;
+        }
+        std::sort(owners.begin(), owners.end(), [](const std::pair<const char*, uint64_t>& a, const std::pair<const char*, uint64_t>& b) { return a.second > b.second; });
+        LOG_INFO("  by owner:");
+        for (size_t i = 0; i < owners.size(); i++)
+            LOG_INFO("    %-20s %9.2f MB", owners[i].first, owners[i].second / (1024.0 * 1024.0));
+
+        std::sort(sorted.begin(), sorted.end(), [](const Record* a, const Record* b) { return a->bytes > b->bytes; });
+        LOG_INFO("  largest:");
+        for (size_t i = 0; i < sorted.size() && i < GPU_MEMORY_REPORT_LARGEST; i++)
+            LOG_INFO("    %-12s %5u  %-20s %9.2f MB  %s", TypeName(sorted[i]->type), sorted[i]->id, FormatName(sorted[i]->format),
+                sorted[i]->bytes / (1024.0 * 1024.0), sorted[i]->owner);
+    }
+    // storage size of a texture with the given full mip chain (depth halves only for 3D textures)
+    // ------------------------------------------------------------------------
+    static uint64_t TextureBytes(GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLsizei levels, bool volume)
+    {
+        uint64_t bytes = 0;
+        int blockBytes = CompressedBlockBytes(internalFormat);
+        for (GLsizei level = 0; level < levels; level++)
+        {
+            uint64_t w = std::max(width >> level, 1);
+            uint64_t h = std::max(height >> level, 1);
+            uint64_t d = volume ? std::max(depth >> level, 1) : depth;
+            if (blockBytes)
+                bytes += ((w + 3) / 4) * ((h + 3) / 4) * blockBytes * d;
+            else
+                bytes += w * h * d * BytesPerTexel(internalFormat);
+        }
+        return bytes;
+    }
+
+    [[nodiscard]] static uint64_t GetTotal() noexcept { return totals[GPU_RESOURCE_BUFFER] + totals[GPU_RESOURCE_TEXTURE] + totals[GPU_RESOURCE_RENDERBUFFER]; }
+    [[nodiscard]] static uint64_t GetTotal(GpuResourceType type) noexcept { return totals[type]; }
+    [[nodiscard]] static int GetCount(GpuResourceType type) noexcept { return counts[type]; }
+    [[nodiscard]] static uint64_t GetPeak() noexcept { return peak; }
+    [[nodiscard]] static uint64_t GetBudget() noexcept { return budget; }
+
+    // ------------------------------------------------------------------------
+    static const char* TypeName(GpuResourceType type)
+    {
+        switch (type)
+        {
+        case GPU_RESOURCE_BUFFER:       return "buffer";
+        case GPU_RESOURCE_TEXTURE:      return "texture";
+        case GPU_RESOURCE_RENDERBUFFER: return "renderbuffer";
+        default:                        return "?";
+        }
+    }
+
+private:
+    struct Record
+    {
+        GpuResourceType type;
+        GLuint id;
+        uint64_t bytes;
+        GLenum format;
+        const char* owner;
+    };
+
+    struct Evictor
+    {
+        int id;
+        const char* owner;
+        int priority;
+        EvictCallback callback;
+    };
+
+    inline static std::unordered_map<uint64_t, Record> records;
+    inline static std::vector<Evictor> evictors;
+    inline static uint64_t totals[GPU_RESOURCE_TYPE_COUNT] = {};
+    inline static int counts[GPU_RESOURCE_TYPE_COUNT] = {};
+    inline static uint64_t peak = 0;
+    inline static uint64_t budget = 0;
+    inline static bool overBudget = false;
+    inline static int nextEvictorId = 1;
+    inline static const char* currentOwner = "unowned";
+
+    static uint64_t key(GpuResourceType type, GLuint id)
+    {
+        return ((uint64_t)type << 32) | id;
+    }
+
+    static int CompressedBlockBytes(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT:
+        case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    static int BytesPerTexel(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_R8: case GL_R8UI: case GL_STENCIL_INDEX8:
+            return 1;
+        case GL_RG8: case GL_R16F: case GL_R16: case GL_R16UI: case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB8: case GL_SRGB8: case GL_DEPTH_COMPONENT24:
+            return 3;
+        case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RG16F: case GL_R32F: case GL_R32UI: case GL_R32I:
+        case GL_R11F_G11F_B10F: case GL_RGB10_A2: case GL_DEPTH_COMPONENT32F: case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+            return 6;
+        case GL_RGBA16F: case GL_RG32F: case GL_RGBA16: case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA32F: case GL_RGBA32UI:
+            return 16;
+        default:
+            return 4;
+        }
+    }
+
+    static const char* FormatName(GLenum format)
+    {
+        switch (format)
+        {
+        case 0:                                     return "-";
+        case GL_R8:                                 return "R8";
+        case GL_RG8:                                return "RG8";
+        case GL_RGBA8:                              return "RGBA8";
+        case GL_SRGB8_ALPHA8:                       return "SRGB8_ALPHA8";
+        case GL_R16F:                               return "R16F";
+        case GL_RG16F:                              return "RG16F";
+        case GL_RGBA16F:                            return "RGBA16F";
+        case GL_R32F:                               return "R32F";
+        case GL_RG32F:                              return "RG32F";
+        case GL_RGBA32F:                            return "RGBA32F";
+        case GL_R11F_G11F_B10F:                     return "R11F_G11F_B10F";
+        case GL_DEPTH_COMPONENT24:                  return "DEPTH24";
+        case GL_DEPTH_COMPONENT32F:                 return "DEPTH32F";
+        case GL_DEPTH24_STENCIL8:                   return "DEPTH24_STENCIL8";
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:      return "BC1";
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT: return "BC1_SRGB";
+        case GL_COMPRESSED_RG_RGTC2:                return "BC5";
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:         return "BC7";
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:   return "BC7_SRGB";
+        default:                                    return "other";
+        }
+    }
+};
+
+
+// tags allocations made in this block with a subsystem name (string literal)
+struct GpuMemoryOwnerScope
+{
+    explicit GpuMemoryOwnerScope(const char* owner) : previous(GpuMemory::SetOwner(owner)) {}
+    ~GpuMemoryOwnerScope() { GpuMemory::SetOwner(previous); }
+    GpuMemoryOwnerScope(const GpuMemoryOwnerScope&) = delete;
+    GpuMemoryOwnerScope& operator=(const GpuMemoryOwnerScope&) = delete;
+
+    const char* previous;
+};
+
+#define GPU_MEMORY_CONCAT_INNER(a, b) a##b
+#define GPU_MEMORY_CONCAT(a, b) GPU_MEMORY_CONCAT_INNER(a, b)
+#define GPU_MEMORY_OWNER(name) GpuMemoryOwnerScope GPU_MEMORY_CONCAT(gpuMemoryOwner, __LINE__)(name)
+
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef HIZ_PYRAMID_H
+#define HIZ_PYRAMID_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <memory>
+
+#include "Shader.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+#define HIZ_PYRAMID_TILE 8
+
+// Hierarchical-Z min/max pyramid of the scene depth, built by
+// hiz_downsample.comp after the opaque geometry: RG32F with r = max and
+// g = min depth, level 0 at full resolution and a full mip chain below it.
+// Allocated at the depth target's size; with dynamic resolution only the
+// render region at the origin is built (level n covers getWidth() >> n by
+// getHeight() >> n texels, the rest is stale), so scale changes never
+// reallocate.
+// The max bound is what occlusion tests need, the min bound lets ray marchers (clouds, water, SSR) skip empty space and stop
+// early. Sampled with nearest filtering only, bilinear would mix the bounds.
+class HiZPyramid
+{
+public:
+    HiZPyramid()
+        : shader("shaders/hiz_downsample.comp", { { "TILE_SIZE", 0, HIZ_PYRAMID_TILE }, { "TILE_SIZE", 1, HIZ_PYRAMID_TILE } }),
+          textureWidth(0), textureHeight(0), width(0), height(0), levels(0), built(false)
+    {
+    }
+
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+
+    // rebuild from the renderWidth x renderHeight region of a depthWidth x
+    // depthHeight depth texture, (re)allocated when the depth texture's size changed
+    // ------------------------------------------------------------------------
+    void build(GLuint depthTexture, int depthWidth, int depthHeight, int renderWidth, int renderHeight)
+    {
+        if (!texture || depthWidth != textureWidth || depthHeight != textureHeight)
+        {
+            GPU_MEMORY_OWNER("hi-z pyramid");
+            textureWidth = depthWidth;
+            textureHeight = depthHeight;
+            levels = 1;
+            for (int size = textureWidth > textureHeight ? textureWidth : textureHeight; size > 1; size /= 2)
+                levels++;
+            texture.reset(new GLTexture(GL_TEXTURE_2D));
+            texture->storage2D(levels, GL_RG32F, textureWidth, textureHeight);
+            texture->parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            texture->parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            texture->parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            texture->parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+
+        width = renderWidth < textureWidth ? renderWidth : textureWidth;
+        height = renderHeight < textureHeight ? renderHeight : textureHeight;
+
+        shader.use();
+        GLState::BindTextureUnit(0, depthTexture);
+        int sourceWidth = width;
+        int sourceHeight = height;
+        for (int level = 0; level < levels; level++)
+        {
+            int levelWidth = level == 0 ? width : (sourceWidth / 2 > 1 ? sourceWidth / 2 : 1);
+            int levelHeight = level == 0 ? height : (sourceHeight / 2 > 1 ? sourceHeight / 2 : 1);
+            shader.setBool("u_fromDepth", level == 0);
+            glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_sourceSize"), sourceWidth, sourceHeight);
+            glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_destinationSize"), levelWidth, levelHeight);
+            if (level > 0)
+                glBindImageTexture(0, texture->ID, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+            glBindImageTexture(1, texture->ID, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+
+            glDispatchCompute((levelWidth + HIZ_PYRAMID_TILE - 1) / HIZ_PYRAMID_TILE, (levelHeight + HIZ_PYRAMID_TILE - 1) / HIZ_PYRAMID_TILE, 1);
+            Profiler::CountDispatch();
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+            sourceWidth = levelWidth;
+            sourceHeight = levelHeight;
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        built = true;
+    }
+    // 0 until the first build()
+    // ------------------------------------------------------------------------
+    GLuint getTexture() const
+    {
+        return built ? texture->ID : 0;
+    }
+    // allocated size of level 0
+    // ------------------------------------------------------------------------
+    int getTextureWidth() const
+    {
+        return textureWidth;
+    }
+    // ------------------------------------------------------------------------
+    int getTextureHeight() const
+    {
+        return textureHeight;
+    }
+    // region of level 0 the last build() covered
+    // ------------------------------------------------------------------------
+    int getWidth() const
+    {
+        return width;
+    }
+    // ------------------------------------------------------------------------
+    int getHeight() const
+    {
+        return height;
+    }
+    // ------------------------------------------------------------------------
+    int getLevels() const
+    {
+        return levels;
+    }
+
+private:
+    Shader shader;
+    std::unique_ptr<GLTexture> texture;
+    int textureWidth;
+    int textureHeight;
+    int width;
+    int height;
+    int levels;
+    bool built;
+};
+
+
+#endif
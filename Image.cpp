@@ -0,0 +1,238 @@
+#include "Image.h"
+
+#include <windows.h>
+#include <wincodec.h>
+#include <math.h>
+#include <string.h>
+#include <mutex>
+
+#pragma comment(lib, "windowscodecs.lib")
+#pragma comment(lib, "ole32.lib")
+
+// sRGB <-> linear tables for gamma-correct mip filtering
+static float s_srgbToLinear[256];
+static uint8_t s_linearToSrgb[4096];
+static std::once_flag s_tablesOnce;
+
+static void initSrgbTables()
+{
+    for (int i = 0; i < 256; i++)
+    {
+        float c = i / 255.0f;
+        s_srgbToLinear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < 4096; i++)
+    {
+        float l = i / 4095.0f;
+        float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        s_linearToSrgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+    }
+}
+
+bool Image::load(const std::string& path)
+{
+    IWICImagingFactory* factory = NULL;
+    IWICBitmapDecoder* decoder = NULL;
+    IWICBitmapFrameDecode* frame = NULL;
+    IWICFormatConverter* converter = NULL;
+    bool ok = false;
+
+    wchar_t widePath[MAX_PATH];
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath, MAX_PATH);
+
+    if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) &&
+        SUCCEEDED(factory->CreateDecoderFromFilename(widePath, NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) &&
+        SUCCEEDED(decoder->GetFrame(0, &frame)) &&
+        SUCCEEDED(factory->CreateFormatConverter(&converter)) &&
+        SUCCEEDED(converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom)))
+    {
+        UINT decodedWidth = 0, decodedHeight = 0;
+        converter->GetSize(&decodedWidth, &decodedHeight);
+        width = (int)decodedWidth;
+        height = (int)decodedHeight;
+
+        // reserve room for the whole chain up front (< 4/3 of level 0)
+        size_t rowBytes = (size_t)width * 4;
+        size_t levelBytes = rowBytes * height;
+        pixels.clear();
+        pixels.reserve(levelBytes + levelBytes / 3 + 64);
+        pixels.resize(levelBytes);
+        levelOffsets.assign(1, 0);
+
+        ok = SUCCEEDED(converter->CopyPixels(NULL, (UINT)rowBytes, (UINT)levelBytes, pixels.data()));
+
+        // GL wants the first row at the bottom
+        std::vector<uint8_t> row(rowBytes);
+        for (int y = 0; ok && y < height / 2; y++)
+        {
+            uint8_t* top = &pixels[y * rowBytes];
+            uint8_t* bottom = &pixels[(height - 1 - y) * rowBytes];
+            memcpy(row.data(), top, rowBytes);
+            memcpy(top, bottom, rowBytes);
+            memcpy(bottom, row.data(), rowBytes);
+        }
+    }
+
+    if (converter) converter->Release();
+    if (frame) frame->Release();
+    if (decoder) decoder->Release();
+    if (factory) factory->Release();
+    return ok;
+}
+
+bool Image::save(const std::string& path) const
+{
+    IWICImagingFactory* factory = NULL;
+    IWICStream* stream = NULL;
+    IWICBitmapEncoder* encoder = NULL;
+    IWICBitmapFrameEncode* frame = NULL;
+    bool ok = false;
+
+    wchar_t widePath[MAX_PATH];
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, widePath, MAX_PATH);
+
+    WICPixelFormatGUID format = GUID_WICPixelFormat32bppRGBA;
+    if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) &&
+        SUCCEEDED(factory->CreateStream(&stream)) &&
+        SUCCEEDED(stream->InitializeFromFilename(widePath, GENERIC_WRITE)) &&
+        SUCCEEDED(factory->CreateEncoder(GUID_ContainerFormatPng, NULL, &encoder)) &&
+        SUCCEEDED(encoder->Initialize(stream, WICBitmapEncoderNoCache)) &&
+        SUCCEEDED(encoder->CreateNewFrame(&frame, NULL)) &&
+        SUCCEEDED(frame->Initialize(NULL)) &&
+        SUCCEEDED(frame->SetSize((UINT)width, (UINT)height)) &&
+        SUCCEEDED(frame->SetPixelFormat(&format)))
+    {
+        // the encoder may only offer BGRA, swizzle per row in that case
+        bool swizzle = !IsEqualGUID(format, GUID_WICPixelFormat32bppRGBA);
+        UINT rowBytes = (UINT)width * 4;
+        std::vector<uint8_t> row(rowBytes);
+
+        // rows are stored bottom-up, files go top-down
+        ok = true;
+        for (int y = height - 1; ok && y >= 0; y--)
+        {
+            const uint8_t* source = &pixels[(size_t)y * rowBytes];
+            if (swizzle)
+            {
+                for (UINT x = 0; x < rowBytes; x += 4)
+                {
+                    row[x + 0] = source[x + 2];
+                    row[x + 1] = source[x + 1];
+                    row[x + 2] = source[x + 0];
+                    row[x + 3] = source[x + 3];
+                }
+                source = row.data();
+            }
+            ok = SUCCEEDED(frame->WritePixels(1, rowBytes, rowBytes, (BYTE*)source));
+        }
+        ok = ok && SUCCEEDED(frame->Commit()) && SUCCEEDED(encoder->Commit());
+    }
+
+    if (frame) frame->Release();
+    if (encoder) encoder->Release();
+    if (stream) stream->Release();
+    if (factory) factory->Release();
+    return ok;
+}
+
+void Image::buildMipChain(bool srgb)
+{
+    std::call_once(s_tablesOnce, initSrgbTables);
+
+    // drop any previous chain, keep level 0
+    pixels.resize((size_t)width * height * 4);
+    levelOffsets.assign(1, 0);
+
+    int sourceWidth = width;
+    int sourceHeight = height;
+
+    while (sourceWidth > 1 || sourceHeight > 1)
+    {
+        int nextWidth = (sourceWidth > 1) ? sourceWidth / 2 : 1;
+        int nextHeight = (sourceHeight > 1) ? sourceHeight / 2 : 1;
+
+        size_t sourceOffset = levelOffsets.back();
+        size_t destOffset = pixels.size();
+        pixels.resize(destOffset + (size_t)nextWidth * nextHeight * 4);
+        levelOffsets.push_back(destOffset);
+
+        const uint8_t* source = &pixels[sourceOffset];
+        uint8_t* dest = &pixels[destOffset];
+
+        for (int y = 0; y < nextHeight; y++)
+        {
+            int y0 = y * 2;
+            int y1 = (y0 + 1 < sourceHeight) ? y0 + 1 : y0;
+            for (int x = 0; x < nextWidth; x++)
+            {
+                int x0 = x * 2;
+                int x1 = (x0 + 1 < sourceWidth) ? x0 + 1 : x0;
+                const uint8_t* p00 = &source[((size_t)y0 * sourceWidth + x0) * 4];
+                const uint8_t* p01 = &source[((size_t)y0 * sourceWidth + x1) * 4];
+                const uint8_t* p10 = &source[((size_t)y1 * sourceWidth + x0) * 4];
+                const uint8_t* p11 = &source[((size_t)y1 * sourceWidth + x1) * 4];
+                uint8_t* out = &dest[((size_t)y * nextWidth + x) * 4];
+
+                for (int c = 0; c < 4; c++)
+                {
+                    if (srgb && c < 3)
+                    {
+                        float l = (s_srgbToLinear[p00[c]] + s_srgbToLinear[p01[c]] + s_srgbToLinear[p10[c]] + s_srgbToLinear[p11[c]]) * 0.25f;
+                        out[c] = s_linearToSrgb[(int)(l * 4095.0f + 0.5f)];
+                    }
+                    else
+                    {
+                        out[c] = (uint8_t)((p00[c] + p01[c] + p10[c] + p11[c] + 2) / 4);
+                    }
+                }
+            }
+        }
+
+        sourceWidth = nextWidth;
+        sourceHeight = nextHeight;
+    }
+}
+
+Image Image::resized(int newWidth, int newHeight) const
+{
+    Image result;
+    result.width = newWidth;
+    result.height = newHeight;
+    result.pixels.resize((size_t)newWidth * newHeight * 4);
+    result.levelOffsets.assign(1, 0);
+
+    float scaleX = (float)width / newWidth;
+    float scaleY = (float)height / newHeight;
+
+    for (int y = 0; y < newHeight; y++)
+    {
+        float sy = (y + 0.5f) * scaleY - 0.5f;
+        sy = (sy > 0.0f) ? sy : 0.0f;
+        int y0 = (int)sy;
+        int y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+        float fy = sy - y0;
+
+        for (int x = 0; x < newWidth; x++)
+        {
+            float sx = (x + 0.5f) * scaleX - 0.5f;
+            sx = (sx > 0.0f) ? sx : 0.0f;
+            int x0 = (int)sx;
+            int x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+            float fx = sx - x0;
+
+            const uint8_t* p00 = &pixels[((size_t)y0 * width + x0) * 4];
+            const uint8_t* p01 = &pixels[((size_t)y0 * width + x1) * 4];
+            const uint8_t* p10 = &pixels[((size_t)y1 * width + x0) * 4];
+            const uint8_t* p11 = &pixels[((size_t)y1 * width + x1) * 4];
+            uint8_t* out = &result.pixels[((size_t)y * newWidth + x) * 4];
+
+            for (int c = 0; c < 4; c++)
+            {
+                float top = p00[c] + (p01[c] - p00[c]) * fx;
+                float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+                out[c] = (uint8_t)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,35 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+// CPU side RGBA8 image with an optional mip chain stored back to back.
+// Rows are bottom-up, the way GL expects them.
+struct Image
+{
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+    std::vector<size_t> levelOffsets;   // one entry per level, level 0 at 0
+
+    Image() : width(0), height(0) {}
+
+    // decode any WIC supported file (jpg, png, bmp, tiff...), level 0 only.
+    // COM must be initialized on the calling thread.
+    bool load(const std::string& path);
+    // level 0 as a PNG through WIC, same COM requirement as load()
+    bool save(const std::string& path) const;
+    // 2x2 box filter down to 1x1; sRGB data is averaged in linear space
+    void buildMipChain(bool srgb);
+    // bilinear resample of level 0
+    Image resized(int newWidth, int newHeight) const;
+
+    int levelCount() const { return (int)levelOffsets.size(); }
+    int levelWidth(int level) const { return (width >> level) > 0 ? (width >> level) : 1; }
+    int levelHeight(int level) const { return (height >> level) > 0 ? (height >> level) : 1; }
+    const uint8_t* level(int level) const { return &pixels[levelOffsets[level]]; }
+};
+
+#endif // IMAGE_H
@@ -0,0 +1,160 @@
+#pragma once
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <windows.h>
+
+#include <glm/glm.hpp>
+
+#include <string.h>
+
+#include "Logger.h"
+
+#define INPUT_KEY_COUNT 256
+
+enum MouseButton
+{
+    MOUSE_LEFT,
+    MOUSE_RIGHT,
+    MOUSE_MIDDLE,
+    MOUSE_BUTTON_COUNT
+};
+
+// Keyboard and mouse state from WM_INPUT. Keys are held state rather than
+// WM_CHAR autorepeat, so movement no longer depends on the OS repeat rate,
+// and mouse deltas are the device's raw counts (no acceleration, no
+// clamping at the window edge). Edges and deltas accumulate until
+// EndFrame(). Legacy WM_KEYDOWN/WM_CHAR keep arriving for one-shot toggles.
+// Main (window) thread only.
+class Input
+{
+public:
+    // ------------------------------------------------------------------------
+    static bool Register(HWND window)
+    {
+        RAWINPUTDEVICE devices[2];
+        devices[0].usUsagePage = 0x01;     // generic desktop
+        devices[0].usUsage = 0x02;         // mouse
+        devices[0].dwFlags = 0;
+        devices[0].hwndTarget = window;
+        devices[1].usUsagePage = 0x01;
+        devices[1].usUsage = 0x06;         // keyboard
+        devices[1].dwFlags = 0;
+        devices[1].hwndTarget = window;
+        if (!RegisterRawInputDevices(devices, 2, sizeof(RAWINPUTDEVICE)))
+        {
+            LOG_ERROR("RegisterRawInputDevices failed (%lu)", GetLastError());
+            return false;
+        }
+        return true;
+    }
+    // feed every window message through here, returns true for input messages
+    // (WM_INPUT still has to reach DefWindowProc)
+    // ------------------------------------------------------------------------
+    static bool HandleMessage(UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        switch (message)
+        {
+        case WM_INPUT:
+        {
+            RAWINPUT raw;
+            UINT size = sizeof(raw);
+            if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1)
+                return true;
+
+            if (raw.header.dwType == RIM_TYPEMOUSE)
+                handleMouse(raw.data.mouse);
+            else if (raw.header.dwType == RIM_TYPEKEYBOARD)
+                handleKeyboard(raw.data.keyboard);
+            return true;
+        }
+
+        case WM_KILLFOCUS:
+            // releases happening while unfocused never arrive
+            memset(keys, 0, sizeof(keys));
+            memset(buttons, 0, sizeof(buttons));
+            return false;
+        }
+        return false;
+    }
+    // ------------------------------------------------------------------------
+    static bool IsKeyDown(int key)
+    {
+        return key >= 0 && key < INPUT_KEY_COUNT && keys[key];
+    }
+    // went down since the last EndFrame()
+    // ------------------------------------------------------------------------
+    static bool WasKeyPressed(int key)
+    {
+        return key >= 0 && key < INPUT_KEY_COUNT && pressed[key];
+    }
+    // ------------------------------------------------------------------------
+    static bool IsButtonDown(MouseButton button)
+    {
+        return buttons[button];
+    }
+    // raw counts since the last EndFrame(), +y is down like window coordinates
+    // ------------------------------------------------------------------------
+    static glm::vec2 GetMouseDelta()
+    {
+        return glm::vec2((float)mouseDeltaX, (float)mouseDeltaY);
+    }
+    // notches since the last EndFrame(), positive away from the user
+    // ------------------------------------------------------------------------
+    static float GetWheelDelta()
+    {
+        return wheelDelta;
+    }
+    // ------------------------------------------------------------------------
+    static void EndFrame()
+    {
+        memset(pressed, 0, sizeof(pressed));
+        mouseDeltaX = 0;
+        mouseDeltaY = 0;
+        wheelDelta = 0.0f;
+    }
+
+private:
+    inline static bool keys[INPUT_KEY_COUNT] = {};
+    inline static bool pressed[INPUT_KEY_COUNT] = {};
+    inline static bool buttons[MOUSE_BUTTON_COUNT] = {};
+    inline static long mouseDeltaX = 0;
+    inline static long mouseDeltaY = 0;
+    inline static float wheelDelta = 0.0f;
+
+    static void handleMouse(const RAWMOUSE& mouse)
+    {
+        // tablets and remote desktop report absolute positions, only relative motion is used
+        if (!(mouse.usFlags & MOUSE_MOVE_ABSOLUTE))
+        {
+            mouseDeltaX += mouse.lLastX;
+            mouseDeltaY += mouse.lLastY;
+        }
+
+        USHORT flags = mouse.usButtonFlags;
+        if (flags & RI_MOUSE_LEFT_BUTTON_DOWN) buttons[MOUSE_LEFT] = true;
+        if (flags & RI_MOUSE_LEFT_BUTTON_UP) buttons[MOUSE_LEFT] = false;
+        if (flags & RI_MOUSE_RIGHT_BUTTON_DOWN) buttons[MOUSE_RIGHT] = true;
+        if (flags & RI_MOUSE_RIGHT_BUTTON_UP) buttons[MOUSE_RIGHT] = false;
+        if (flags & RI_MOUSE_MIDDLE_BUTTON_DOWN) buttons[MOUSE_MIDDLE] = true;
+        if (flags & RI_MOUSE_MIDDLE_BUTTON_UP) buttons[MOUSE_MIDDLE] = false;
+        if (flags & RI_MOUSE_WHEEL)
+            wheelDelta += (float)(SHORT)mouse.usButtonData / WHEEL_DELTA;
+    }
+
+    static void handleKeyboard(const RAWKEYBOARD& keyboard)
+    {
+        // 0xFF marks the fake keys sent around escaped sequences
+        USHORT key = keyboard.VKey;
+        if (key == 0 || key >= 0xFF)
+            return;
+
+        bool down = !(keyboard.Flags & RI_KEY_BREAK);
+        if (down && !keys[key])
+            pressed[key] = true;
+        keys[key] = down;
+    }
+};
+
+
+#endif
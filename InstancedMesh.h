@@ -0,0 +1,128 @@
+#pragma once
+#ifndef INSTANCED_MESH_H
+#define INSTANCED_MESH_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GLObjects.h"
+#include "GLState.h"
+#include "Profiler.h"
+
+// attribute locations shared with shaders/camera_instanced.vs
+#define ATTRIB_POSITION 0
+#define ATTRIB_COLOR 1
+#define ATTRIB_INSTANCE_MODEL 2 // mat4 occupies locations 2..5
+
+// Indexed mesh drawn once for a whole set of instances. Model matrices live
+// in a per-instance vertex buffer and are only re-uploaded when marked dirty,
+// so a static set of objects costs a single glDrawElementsInstanced per frame.
+class InstancedMesh
+{
+public:
+    GLVertexArray vao;
+    GLBuffer vboPosition;
+    GLBuffer vboColor;
+    GLBuffer ebo;
+    GLBuffer vboInstance;
+    GLsizei indexCount;
+
+    InstancedMesh(const GLfloat* positions, const GLfloat* colors, GLsizei vertexCount, const GLushort* indices, GLsizei numIndices)
+        : indexCount(numIndices), instanceCapacity(0), dirtyBegin(0), dirtyEnd(0)
+    {
+        vboPosition.storage(vertexCount * 3 * sizeof(GLfloat), positions, 0);
+        vboColor.storage(vertexCount * 3 * sizeof(GLfloat), colors, 0);
+        ebo.storage(numIndices * sizeof(GLushort), indices, 0);
+
+        // binding 0 = position, 1 = color, 2 = per-instance model matrix
+        vao.vertexBuffer(0, vboPosition, 0, 3 * sizeof(GLfloat));
+        vao.attrib(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        vao.vertexBuffer(1, vboColor, 0, 3 * sizeof(GLfloat));
+        vao.attrib(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, 0, 1);
+        vao.elementBuffer(ebo);
+
+        //Instance buffer, one mat4 per instance split over four vec4 attributes
+        vao.vertexBuffer(2, vboInstance, 0, sizeof(glm::mat4));
+        vao.bindingDivisor(2, 1);
+        for (GLuint i = 0; i < 4; i++)
+        {
+            vao.attrib(ATTRIB_INSTANCE_MODEL + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i, 2);
+        }
+    }
+
+    InstancedMesh(const InstancedMesh&) = delete;
+    InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+    // replace the whole instance set, uploaded on the next draw
+    // ------------------------------------------------------------------------
+    void setInstances(const glm::mat4* models, size_t count)
+    {
+        // assign keeps the capacity, a rebuild of the same size does not allocate
+        instances.assign(models, models + count);
+        dirtyBegin = 0;
+        dirtyEnd = instances.size();
+    }
+    // update one instance, only the touched range is re-uploaded
+    // ------------------------------------------------------------------------
+    void setInstance(size_t index, const glm::mat4& model)
+    {
+        instances[index] = model;
+        if (dirtyBegin == dirtyEnd)
+        {
+            dirtyBegin = index;
+            dirtyEnd = index + 1;
+        }
+        else
+        {
+            dirtyBegin = (index < dirtyBegin) ? index : dirtyBegin;
+            dirtyEnd = (index + 1 > dirtyEnd) ? index + 1 : dirtyEnd;
+        }
+    }
+    // ------------------------------------------------------------------------
+    GLsizei getInstanceCount() const
+    {
+        return (GLsizei)instances.size();
+    }
+    // ------------------------------------------------------------------------
+    void draw()
+    {
+        upload();
+        if (instances.empty())
+            return;
+
+        GLState::BindVertexArray(vao.ID);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, NULL, (GLsizei)instances.size());
+        Profiler::CountDraw();
+    }
+
+private:
+    std::vector<glm::mat4> instances;
+    size_t instanceCapacity;
+    size_t dirtyBegin;
+    size_t dirtyEnd;
+
+    void upload()
+    {
+        if (dirtyBegin == dirtyEnd)
+            return;
+
+        if (instances.size() > instanceCapacity)
+        {
+            // grow: reallocate storage and send everything
+            vboInstance.data(instances.size() * sizeof(glm::mat4), instances.data(), GL_STATIC_DRAW);
+            instanceCapacity = instances.size();
+        }
+        else
+        {
+            vboInstance.subData(dirtyBegin * sizeof(glm::mat4), (dirtyEnd - dirtyBegin) * sizeof(glm::mat4), &instances[dirtyBegin]);
+        }
+
+        dirtyBegin = dirtyEnd = 0;
+    }
+};
+
+
+#endif
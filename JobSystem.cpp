@@ -0,0 +1,310 @@
+#include "JobSystem.h"
+
+#include <windows.h>
+#include <objbase.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+namespace
+{
+    struct JobSlot
+    {
+        std::function<void()> function;
+        std::atomic<int> unfinished;        // own function + children still running
+        std::atomic<uint32_t> generation;
+        uint32_t parent;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<uint32_t> jobs;
+    };
+
+    JobSlot slots[JOB_SYSTEM_MAX_JOBS];
+    std::vector<uint32_t> freeSlots;
+    std::mutex freeMutex;
+
+    // [0] belongs to the main thread, [i] to worker i, then one per other thread
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    int workerTotal = 0;
+    std::atomic<int> externalCount(0);
+    WorkQueue background;
+
+    std::vector<std::thread> workers;
+    std::atomic<int> queuedCount(0);
+    std::atomic<bool> quit(false);
+    std::mutex sleepMutex;
+    std::condition_variable wakeSignal;
+
+    // -1 until a thread outside the pool first queues or waits
+    thread_local int threadIndex = -1;
+
+    int ownQueue()
+    {
+        if (threadIndex < 0)
+        {
+            int external = externalCount++;
+            if (external >= JOB_SYSTEM_MAX_EXTERNAL_THREADS)
+            {
+                LOG_ERROR("JobSystem: more than %d threads outside the pool, the last ones share a queue", JOB_SYSTEM_MAX_EXTERNAL_THREADS);
+                external = JOB_SYSTEM_MAX_EXTERNAL_THREADS - 1;
+            }
+            threadIndex = workerTotal + 1 + external;
+        }
+        return threadIndex;
+    }
+}
+
+void JobSystem::Init(int workerCount)
+{
+    if (workerCount <= 0)
+    {
+        int cores = (int)std::thread::hardware_concurrency();
+        workerCount = (cores > 1) ? cores - 1 : 1;
+    }
+    if (workerCount > JOB_SYSTEM_MAX_WORKERS)
+        workerCount = JOB_SYSTEM_MAX_WORKERS;
+
+    freeSlots.clear();
+    for (uint32_t i = JOB_SYSTEM_MAX_JOBS; i > 0; i--)
+        freeSlots.push_back(i - 1);
+
+    quit = false;
+    queues.clear();
+    for (int i = 0; i <= workerCount + JOB_SYSTEM_MAX_EXTERNAL_THREADS; i++)
+        queues.emplace_back(new WorkQueue());
+    workerTotal = workerCount;
+    externalCount = 0;
+    threadIndex = 0;
+    for (int i = 1; i <= workerCount; i++)
+        workers.emplace_back(&JobSystem::workerMain, i);
+
+    LOG_INFO("JobSystem started with %d workers", workerCount);
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit = true;
+    }
+    wakeSignal.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    workers.clear();
+    queues.clear();
+    background.jobs.clear();
+    queuedCount = 0;
+}
+
+JobHandle JobSystem::Create(std::function<void()> function, JobHandle parent)
+{
+    uint32_t index = 0;
+    for (;;)
+    {
+        {
+            std::lock_guard<std::mutex> lock(freeMutex);
+            if (!freeSlots.empty())
+            {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+                break;
+            }
+        }
+        // pool exhausted: finishing someone else's job is the only way forward
+        if (!runOne(false))
+            std::this_thread::yield();
+    }
+
+    JobSlot& slot = slots[index];
+    slot.function = std::move(function);
+    slot.parent = parent.index;
+    slot.unfinished = 1;
+    if (parent.index != JOB_SYSTEM_NO_PARENT)
+        slots[parent.index].unfinished++;
+
+    JobHandle handle = { index, slot.generation.load() };
+    return handle;
+}
+
+void JobSystem::Run(JobHandle job, JobPriority priority)
+{
+    push(job.index, priority);
+}
+
+JobHandle JobSystem::Run(std::function<void()> function, JobPriority priority)
+{
+    JobHandle job = Create(std::move(function));
+    push(job.index, priority);
+    return job;
+}
+
+void JobSystem::Wait(JobHandle job)
+{
+    while (!IsDone(job))
+    {
+        if (!runOne(false))
+            std::this_thread::yield();
+    }
+}
+
+bool JobSystem::IsDone(JobHandle job)
+{
+    const JobSlot& slot = slots[job.index];
+    return slot.generation.load() != job.generation || slot.unfinished.load() == 0;
+}
+
+void JobSystem::ParallelFor(int count, int batchSize, const std::function<void(int begin, int end)>& body)
+{
+    if (count <= 0)
+        return;
+    if (batchSize <= 0)
+    {
+        // a few batches per thread so stealing can even out uneven work
+        batchSize = count / (4 * (workerTotal + 1));
+        if (batchSize < 1)
+            batchSize = 1;
+    }
+    if (count <= batchSize || workerTotal == 0)
+    {
+        body(0, count);
+        return;
+    }
+
+    JobHandle root = Create(nullptr);
+    for (int begin = 0; begin < count; begin += batchSize)
+    {
+        int end = (begin + batchSize < count) ? begin + batchSize : count;
+        Run(Create([&body, begin, end] { body(begin, end); }, root));
+    }
+    Run(root);
+    Wait(root);
+}
+
+int JobSystem::GetWorkerCount()
+{
+    return (int)workers.size();
+}
+
+int JobSystem::GetThreadIndex()
+{
+    return ownQueue();
+}
+
+void JobSystem::workerMain(int index)
+{
+    // WIC decoding runs in background jobs
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    threadIndex = index;
+
+    while (!quit)
+    {
+        if (runOne(true))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeSignal.wait(lock, [] { return quit || queuedCount > 0; });
+    }
+
+    CoUninitialize();
+}
+
+// own deque from the back, then steal from the others' fronts, then background
+bool JobSystem::runOne(bool allowBackground)
+{
+    if (queues.empty())
+        return false;
+
+    int self = ownQueue();
+    int queueCount = (int)queues.size();
+    uint32_t index = 0;
+    bool found = false;
+    {
+        WorkQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            index = own.jobs.back();
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    for (int i = 1; i < queueCount && !found; i++)
+    {
+        WorkQueue& victim = *queues[(self + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            index = victim.jobs.front();
+            victim.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found && allowBackground)
+    {
+        std::lock_guard<std::mutex> lock(background.mutex);
+        if (!background.jobs.empty())
+        {
+            index = background.jobs.front();
+            background.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found)
+        return false;
+
+    queuedCount--;
+    execute(index);
+    return true;
+}
+
+void JobSystem::execute(uint32_t index)
+{
+    JobSlot& slot = slots[index];
+    if (slot.function)
+        slot.function();
+    slot.function = nullptr;
+    finish(index);
+}
+
+void JobSystem::finish(uint32_t index)
+{
+    JobSlot& slot = slots[index];
+    if (--slot.unfinished != 0)
+        return;
+
+    uint32_t parent = slot.parent;
+    // outstanding handles read as done from here on, the slot can be reused
+    slot.generation++;
+    {
+        std::lock_guard<std::mutex> lock(freeMutex);
+        freeSlots.push_back(index);
+    }
+    if (parent != JOB_SYSTEM_NO_PARENT)
+        finish(parent);
+}
+
+void JobSystem::push(uint32_t index, JobPriority priority)
+{
+    WorkQueue& queue = (priority == JOB_PRIORITY_BACKGROUND) ? background : *queues[ownQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(index);
+    }
+    queuedCount++;
+
+    // taking the lock orders this against a worker between its check and its wait
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeSignal.notify_one();
+}
@@ -0,0 +1,75 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <functional>
+#include <stdint.h>
+
+#define JOB_SYSTEM_MAX_JOBS 4096        // live jobs at once; Create() helps out when the pool is exhausted
+#define JOB_SYSTEM_MAX_WORKERS 63
+// threads outside the pool besides the main one that run or wait on jobs (render thread, startup loader)
+#define JOB_SYSTEM_MAX_EXTERNAL_THREADS 8
+#define JOB_SYSTEM_NO_PARENT 0xFFFFFFFFu
+
+// Refers to a pooled job. The generation changes when the slot is recycled,
+// so a handle can be waited on (and reads as done) after its job finished.
+struct JobHandle
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+enum JobPriority
+{
+    JOB_PRIORITY_FRAME,         // per-frame work, waited on within the frame
+    JOB_PRIORITY_BACKGROUND     // long running (asset decoding), never picked up by a waiting thread
+};
+
+// Work-stealing scheduler. Every thread owns a deque: the main thread (the
+// one calling Init) index 0, the workers 1..n, and any other thread claims
+// one of its own the first time it queues or waits. A thread pushes and
+// pops its own jobs LIFO, idle workers steal the oldest job from someone
+// else's front. A job finishes once its function has run
+// and all children created with it as parent have finished, so dependencies
+// are expressed by waiting on the parent; waiting threads keep executing
+// frame jobs instead of blocking, no fibers involved. Background jobs sit in
+// a separate queue that only idle workers drain, so a long decode never
+// lands inside a frame's Wait().
+class JobSystem
+{
+public:
+    // workerCount 0 = one per core besides the main thread
+    static void Init(int workerCount = 0);
+    // unfinished jobs are dropped, nothing may still wait on them
+    static void Shutdown();
+
+    // allocate a job without queuing it; children must be created before the parent is run
+    static JobHandle Create(std::function<void()> function, JobHandle parent = NoParent());
+    static void Run(JobHandle job, JobPriority priority = JOB_PRIORITY_FRAME);
+    // Create + Run without a parent
+    static JobHandle Run(std::function<void()> function, JobPriority priority = JOB_PRIORITY_FRAME);
+    // helps with other frame jobs until this one (and its children) finished
+    static void Wait(JobHandle job);
+    static bool IsDone(JobHandle job);
+
+    // body(begin, end) over [0, count) in batches spread across every thread,
+    // returns when all are done; batchSize 0 picks one from the thread count
+    static void ParallelFor(int count, int batchSize, const std::function<void(int begin, int end)>& body);
+
+    static int GetWorkerCount();
+    // 0 on the main thread, 1..n on workers, above that other threads
+    static int GetThreadIndex();
+    static JobHandle NoParent()
+    {
+        JobHandle handle = { JOB_SYSTEM_NO_PARENT, 0 };
+        return handle;
+    }
+
+private:
+    static void workerMain(int index);
+    static bool runOne(bool allowBackground);
+    static void execute(uint32_t index);
+    static void finish(uint32_t index);
+    static void push(uint32_t index, JobPriority priority);
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <windows.h>
+
+#include <stdint.h>
+
+// smallest page size on Windows, a prefetch touches one byte per page
+#define MAPPED_FILE_PAGE 4096
+
+// Read-only memory map of a whole file. The OS pages data in on first touch,
+// so opening is cheap and nothing is copied into the process heap.
+class MappedFile
+{
+public:
+    MappedFile() : file(INVALID_HANDLE_VALUE), mapping(NULL), view(NULL), fileSize(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool open(const char* path)
+    {
+        close();
+
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        fileSize = (uint64_t)size.QuadPart;
+
+        // empty files cannot be mapped, treat them as open with no data
+        if (fileSize == 0)
+            return true;
+
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+            view = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (view == NULL)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void close()
+    {
+        if (view)
+            UnmapViewOfFile(view);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        view = NULL;
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+        fileSize = 0;
+    }
+    // ------------------------------------------------------------------------
+    const uint8_t* data() const
+    {
+        return view;
+    }
+    // ------------------------------------------------------------------------
+    uint64_t size() const
+    {
+        return fileSize;
+    }
+    // touches every page so the OS reads the file in now, on the calling
+    // thread, instead of faulting it in wherever the data is first used
+    // ------------------------------------------------------------------------
+    void prefetch() const
+    {
+        volatile uint8_t sink = 0;
+        for (uint64_t offset = 0; offset < fileSize; offset += MAPPED_FILE_PAGE)
+            sink ^= view[offset];
+        (void)sink;
+    }
+    // ------------------------------------------------------------------------
+    bool isOpen() const
+    {
+        return file != INVALID_HANDLE_VALUE;
+    }
+    // last modification time (FILETIME ticks), false if the file does not exist
+    // ------------------------------------------------------------------------
+    static bool LastWriteTime(const char* path, uint64_t& time)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+            return false;
+        time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+private:
+    HANDLE file;
+    HANDLE mapping;
+    const uint8_t* view;
+    uint64_t fileSize;
+};
+
+
+#endif
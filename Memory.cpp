@@ -0,0 +1,399 @@
+#include <windows.h>
+
+#include "Memory.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "Logger.h"
+
+struct SubsystemCounters
+{
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> frameAllocations;    // the share made inside frames
+};
+
+struct LoopState
+{
+    std::atomic<uint64_t> allocations;     // current frame so far
+    std::atomic<uint64_t> lastFrame;
+    uint64_t frames;                        // only touched by the thread running the loop
+    int reports;
+};
+
+// all zero before any constructor runs, operator new may be called that early
+static std::atomic<uint64_t> totalAllocations;
+static std::atomic<uint64_t> liveAllocations;
+static std::atomic<bool> guard;
+static std::atomic<bool> debuggerBreak;
+// slot 0 is "untagged", the others are claimed by the first SetSubsystem of a name
+static std::atomic<const char*> subsystemNames[MEMORY_MAX_SUBSYSTEMS];
+static SubsystemCounters subsystems[MEMORY_MAX_SUBSYSTEMS];
+static LoopState loops[MEMORY_LOOP_COUNT];
+static const char* const loopNames[MEMORY_LOOP_COUNT] = { "simulation", "render" };
+
+static thread_local int currentLoop = -1;
+static thread_local int currentSubsystem = 0;
+static thread_local const char* currentSubsystemName = NULL;
+static thread_local bool reporting = false;
+
+static FrameArena simulationArena(MEMORY_FRAME_ARENA_SIZE);
+static FrameArena renderArena(MEMORY_FRAME_ARENA_SIZE);
+
+static int findSubsystem(const char* name)
+{
+    if (name == NULL)
+        return 0;
+    for (int i = 1; i < MEMORY_MAX_SUBSYSTEMS; i++)
+    {
+        const char* slot = subsystemNames[i].load(std::memory_order_acquire);
+        if (slot == NULL)
+        {
+            if (subsystemNames[i].compare_exchange_strong(slot, name))
+                return i;
+            // another thread claimed it first, slot holds its name
+        }
+        if (slot == name || strcmp(slot, name) == 0)
+            return i;
+    }
+    // table full, charged as untagged
+    return 0;
+}
+
+static const char* subsystemName(int index)
+{
+    const char* name = index > 0 ? subsystemNames[index].load(std::memory_order_acquire) : NULL;
+    return name ? name : "untagged";
+}
+
+// guard mode: log the allocation, and stop in the debugger the first time
+static void reportAllocation(size_t size, int loop)
+{
+    LoopState& state = loops[loop];
+    if (state.reports >= MEMORY_GUARD_REPORTS)
+        return;
+    state.reports++;
+
+    // the log itself may allocate
+    reporting = true;
+    LOG_ERROR("Heap allocation of %llu bytes inside the %s frame (%s)", (unsigned long long)size, loopNames[loop], subsystemName(currentSubsystem));
+    reporting = false;
+
+    if (IsDebuggerPresent() && !debuggerBreak.exchange(true))
+        __debugbreak();
+}
+
+static void* allocateTracked(size_t size)
+{
+    void* memory = malloc(size ? size : 1);
+    if (memory)
+        Memory::OnAllocate(size);
+    return memory;
+}
+
+static void* allocateTrackedAligned(size_t size, std::align_val_t alignment)
+{
+    void* memory = _aligned_malloc(size ? size : 1, (size_t)alignment);
+    if (memory)
+        Memory::OnAllocate(size);
+    return memory;
+}
+
+static void freeTracked(void* memory)
+{
+    if (memory == NULL)
+        return;
+    Memory::OnFree();
+    free(memory);
+}
+
+static void freeTrackedAligned(void* memory)
+{
+    if (memory == NULL)
+        return;
+    Memory::OnFree();
+    _aligned_free(memory);
+}
+
+FrameArena::FrameArena(size_t capacity)
+    : base((uint8_t*)malloc(capacity)), capacity(0), used(0), overflowBytes(0), peak(0), overflow(NULL), overflowReported(false)
+{
+    if (base)
+        this->capacity = capacity;
+}
+
+FrameArena::~FrameArena()
+{
+    reset();
+    free(base);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    if (base)
+    {
+        uintptr_t start = ((uintptr_t)base + used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        size_t end = (size_t)(start - (uintptr_t)base) + size;
+        if (end <= capacity)
+        {
+            used = end;
+            return (void*)start;
+        }
+    }
+
+    // past the block: from the heap until reset(), counted like any allocation
+    Overflow* block = (Overflow*)malloc(sizeof(Overflow) + size + alignment);
+    if (block == NULL)
+        return NULL;
+    Memory::OnAllocate(size);
+    block->next = overflow;
+    overflow = block;
+    overflowBytes += size;
+    return (void*)(((uintptr_t)(block + 1) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::reset()
+{
+    if (used + overflowBytes > peak)
+        peak = used + overflowBytes;
+    if (overflow && !overflowReported)
+    {
+        LOG_INFO("Frame arena overflowed by %llu bytes into the heap, it holds %llu (MEMORY_FRAME_ARENA_SIZE)",
+            (unsigned long long)overflowBytes, (unsigned long long)capacity);
+        overflowReported = true;
+    }
+    while (overflow)
+    {
+        Overflow* next = overflow->next;
+        free(overflow);
+        Memory::OnFree();
+        overflow = next;
+    }
+    used = 0;
+    overflowBytes = 0;
+}
+
+size_t FrameArena::getUsed() const
+{
+    return used + overflowBytes;
+}
+
+size_t FrameArena::getPeak() const
+{
+    return peak > used + overflowBytes ? peak : used + overflowBytes;
+}
+
+size_t FrameArena::getCapacity() const
+{
+    return capacity;
+}
+
+void Memory::BeginFrame(MemoryLoop loop)
+{
+    LoopState& state = loops[loop];
+    state.allocations.store(0, std::memory_order_relaxed);
+    state.reports = 0;
+    currentLoop = loop;
+}
+
+void Memory::EndFrame(MemoryLoop loop)
+{
+    LoopState& state = loops[loop];
+    state.lastFrame.store(state.allocations.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    state.frames++;
+    GetFrameArena(loop).reset();
+    currentLoop = -1;
+}
+
+FrameArena& Memory::GetFrameArena(MemoryLoop loop)
+{
+    return loop == MEMORY_LOOP_RENDER ? renderArena : simulationArena;
+}
+
+uint64_t Memory::GetFrameAllocations(MemoryLoop loop)
+{
+    return loops[loop].lastFrame.load(std::memory_order_relaxed);
+}
+
+uint64_t Memory::GetTotalAllocations()
+{
+    return totalAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t Memory::GetLiveAllocations()
+{
+    return liveAllocations.load(std::memory_order_relaxed);
+}
+
+void Memory::SetGuard(bool enabled)
+{
+    guard.store(enabled);
+    if (enabled)
+        LOG_INFO("Allocation guard on: heap allocations inside a frame are logged after %d warm-up frames", MEMORY_GUARD_WARMUP_FRAMES);
+}
+
+bool Memory::GetGuard()
+{
+    return guard.load();
+}
+
+const char* Memory::SetSubsystem(const char* name)
+{
+    const char* previous = currentSubsystemName;
+    currentSubsystemName = name;
+    currentSubsystem = findSubsystem(name);
+    return previous;
+}
+
+void Memory::DumpReport()
+{
+    LOG_INFO("Heap: %llu allocations, %llu live; last frame %llu simulation, %llu render",
+        (unsigned long long)GetTotalAllocations(), (unsigned long long)GetLiveAllocations(),
+        (unsigned long long)GetFrameAllocations(MEMORY_LOOP_SIMULATION), (unsigned long long)GetFrameAllocations(MEMORY_LOOP_RENDER));
+    LOG_INFO("  by subsystem:          allocations    in frames         MB");
+    for (int i = 0; i < MEMORY_MAX_SUBSYSTEMS; i++)
+    {
+        uint64_t allocations = subsystems[i].allocations.load(std::memory_order_relaxed);
+        if (allocations == 0)
+            continue;
+        LOG_INFO("    %-20s %12llu %12llu %10.2f", subsystemName(i), (unsigned long long)allocations,
+            (unsigned long long)subsystems[i].frameAllocations.load(std::memory_order_relaxed),
+            subsystems[i].bytes.load(std::memory_order_relaxed) / (1024.0 * 1024.0));
+    }
+    LOG_INFO("  frame arenas: simulation peak %.1f KB, render peak %.1f KB, %.1f KB each",
+        simulationArena.getPeak() / 1024.0, renderArena.getPeak() / 1024.0, MEMORY_FRAME_ARENA_SIZE / 1024.0);
+}
+
+void Memory::OnAllocate(size_t size)
+{
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    liveAllocations.fetch_add(1, std::memory_order_relaxed);
+    SubsystemCounters& counters = subsystems[currentSubsystem];
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytes.fetch_add(size, std::memory_order_relaxed);
+
+    int loop = currentLoop;
+    if (loop < 0)
+        return;
+    counters.frameAllocations.fetch_add(1, std::memory_order_relaxed);
+    loops[loop].allocations.fetch_add(1, std::memory_order_relaxed);
+    if (guard.load(std::memory_order_relaxed) && !reporting && loops[loop].frames >= MEMORY_GUARD_WARMUP_FRAMES)
+        reportAllocation(size, loop);
+}
+
+void Memory::OnFree()
+{
+    liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+// replacements of the global allocation functions, every new and delete in the program ends up here
+void* operator new(size_t size)
+{
+    void* memory = allocateTracked(size);
+    if (memory == NULL)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return allocateTracked(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocateTracked(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* memory = allocateTrackedAligned(size, alignment);
+    if (memory == NULL)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateTrackedAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateTrackedAligned(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    freeTracked(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    freeTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    freeTrackedAligned(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+    freeTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+    freeTrackedAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeTrackedAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    freeTrackedAligned(memory);
+}
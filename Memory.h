@@ -0,0 +1,170 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// scratch per frame loop; what does not fit goes to the heap until the frame ends
+#define MEMORY_FRAME_ARENA_SIZE (1024 * 1024)
+#define MEMORY_MAX_SUBSYSTEMS 32
+// guard mode leaves each loop's first frames alone while caches and vectors reach their size
+#define MEMORY_GUARD_WARMUP_FRAMES 120
+// guard mode logs this many allocations per loop and frame, the rest are only counted
+#define MEMORY_GUARD_REPORTS 4
+
+enum MemoryLoop
+{
+    MEMORY_LOOP_SIMULATION,     // main thread, RecordFrame
+    MEMORY_LOOP_RENDER,         // render thread, RenderFrame
+    MEMORY_LOOP_COUNT
+};
+
+// Linear allocator for data that only lives until the end of the frame:
+// allocate() bumps an offset into one block reserved up front and reset()
+// takes everything back at once, nothing is freed individually and no
+// destructors run. Requests past the capacity still succeed from the heap
+// (counted as overflow, returned on reset) so a busy frame never fails; the
+// peak tells whether MEMORY_FRAME_ARENA_SIZE should grow. One thread at a time.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // alignment must be a power of two
+    void* allocate(size_t size, size_t alignment = 16);
+    // uninitialized room for count Ts; no destructor will run
+    template<typename T>
+    T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "frame arena memory is released without destructors");
+        return (T*)allocate(count * sizeof(T), alignof(T));
+    }
+    // everything allocated so far is gone
+    void reset();
+
+    size_t getUsed() const;
+    // most used in one frame, overflow included
+    size_t getPeak() const;
+    size_t getCapacity() const;
+
+private:
+    struct Overflow
+    {
+        Overflow* next;
+    };
+
+    uint8_t* base;
+    size_t capacity;
+    size_t used;
+    size_t overflowBytes;
+    size_t peak;
+    Overflow* overflow;
+    bool overflowReported;
+};
+
+// Fixed set of Count recurring objects (readback buffers, requests), made
+// once and handed out again and again; an object keeps whatever it grew to,
+// so a std::vector inside stops allocating once it reached its size.
+// acquire() returns NULL when every object is out. Not thread safe: objects
+// crossing threads are acquired and released under the owner's lock.
+template<typename T, int Count>
+class FixedPool
+{
+public:
+    FixedPool()
+        : freeCount(Count)
+    {
+        for (int i = 0; i < Count; i++)
+            freeList[i] = Count - 1 - i;
+    }
+
+    FixedPool(const FixedPool&) = delete;
+    FixedPool& operator=(const FixedPool&) = delete;
+
+    // ------------------------------------------------------------------------
+    T* acquire()
+    {
+        if (freeCount == 0)
+            return NULL;
+        return &items[freeList[--freeCount]];
+    }
+    // item must come from acquire() of this pool
+    // ------------------------------------------------------------------------
+    void release(T* item)
+    {
+        freeList[freeCount++] = (int)(item - items);
+    }
+    // ------------------------------------------------------------------------
+    int getFree() const
+    {
+        return freeCount;
+    }
+
+private:
+    T items[Count];
+    int freeList[Count];
+    int freeCount;
+};
+
+// Heap accounting for the whole process. Memory.cpp replaces the global
+// operator new and delete, so every allocation (std::string, std::vector
+// growth, std::function captures) is counted: in total, per subsystem (the
+// innermost MEMORY_SUBSYSTEM or PROFILE_SCOPE on the allocating thread) and
+// per frame for threads between BeginFrame() and EndFrame(). The target is
+// zero allocations per frame once the program runs steadily; with the guard
+// on (-allocguard) every allocation inside a frame after the warm-up is
+// logged with its subsystem, and the first one breaks into an attached
+// debugger so its call stack can be read. Job system workers are not inside
+// a frame and are only counted in the totals. Subsystem names are kept by
+// pointer and must be string literals.
+class Memory
+{
+public:
+    // the calling thread runs a frame of loop until EndFrame
+    static void BeginFrame(MemoryLoop loop);
+    // publishes the frame's allocation count and resets the loop's arena
+    static void EndFrame(MemoryLoop loop);
+    // scratch of the loop, only used from the thread running it
+    static FrameArena& GetFrameArena(MemoryLoop loop);
+
+    // heap allocations of the last finished frame of loop
+    static uint64_t GetFrameAllocations(MemoryLoop loop);
+    static uint64_t GetTotalAllocations();
+    // allocated and not freed yet
+    static uint64_t GetLiveAllocations();
+
+    static void SetGuard(bool enabled);
+    static bool GetGuard();
+
+    // subsystem charged for this thread's allocations from now on, returns the previous one
+    static const char* SetSubsystem(const char* name);
+    // per subsystem counts and the frame arenas' peaks to the log
+    static void DumpReport();
+
+    // from operator new and delete
+    static void OnAllocate(size_t size);
+    static void OnFree();
+};
+
+
+// scoped subsystem, the previous one is restored at the end of the block
+struct MemorySubsystemScope
+{
+    explicit MemorySubsystemScope(const char* name) : previous(Memory::SetSubsystem(name)) {}
+    ~MemorySubsystemScope() { Memory::SetSubsystem(previous); }
+    MemorySubsystemScope(const MemorySubsystemScope&) = delete;
+    MemorySubsystemScope& operator=(const MemorySubsystemScope&) = delete;
+
+    const char* previous;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+#define MEMORY_SUBSYSTEM(name) MemorySubsystemScope MEMORY_CONCAT(memorySubsystem, __LINE__)(name)
+
+#endif // MEMORY_H
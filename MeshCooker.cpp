@@ -0,0 +1,466 @@
+#include "MeshCooker.h"
+
+#include <windows.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "CookedMesh.h"
+
+// Forsyth's scoring model, tuned for a 32 entry LRU cache
+#define VERTEX_CACHE_SIZE 32
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRIANGLE_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+// a cluster is cut once its running miss ratio is this close to the whole run's
+#define OVERDRAW_SPLIT_THRESHOLD 1.05f
+#define COOKED_MESH_ALIGNMENT 16
+
+static float vertexScore(int cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the three vertices of the last triangle score the same on purpose,
+        // otherwise strips are favoured over fans
+        if (cachePosition < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+            score = powf(1.0f - (cachePosition - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), CACHE_DECAY_POWER);
+    }
+    return score + VALENCE_BOOST_SCALE * powf((float)liveTriangles, -VALENCE_BOOST_POWER);
+}
+
+void MeshCooker::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters)
+{
+    size_t triangleCount = indexCount / 3;
+    if (clusters)
+        clusters->clear();
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangle adjacency; the live part of each list shrinks as triangles are emitted
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
+        liveTriangles[indices[i]]++;
+
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t i = 0; i < indexCount; i++)
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vScore[v] = vertexScore(-1, liveTriangles[v]);
+
+    std::vector<float> tScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    int64_t best = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+        if (tScore[t] > tScore[(size_t)best])
+            best = (int64_t)t;
+    }
+    if (clusters)
+        clusters->push_back(0);
+
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+    uint32_t cache[VERTEX_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+    {
+        if (best < 0)
+        {
+            // nothing in the cache touches a live triangle: restart elsewhere
+            while (emitted[scanCursor])
+                scanCursor++;
+            best = (int64_t)scanCursor;
+            if (clusters)
+                clusters->push_back((uint32_t)emittedCount);
+        }
+
+        size_t triangle = (size_t)best;
+        const uint32_t* corners = &indices[triangle * 3];
+        emitted[triangle] = 1;
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t v = corners[c];
+            output.push_back(v);
+
+            // drop the triangle from the vertex's live list
+            uint32_t* list = &adjacency[adjacencyOffset[v]];
+            uint32_t count = liveTriangles[v];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (list[i] == triangle)
+                {
+                    list[i] = list[count - 1];
+                    break;
+                }
+            }
+            liveTriangles[v]--;
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        uint32_t newCache[VERTEX_CACHE_SIZE + 3];
+        int newCount = 0;
+        for (int c = 0; c < 3; c++)
+            newCache[newCount++] = corners[c];
+        for (int i = 0; i < cacheCount; i++)
+        {
+            uint32_t v = cache[i];
+            if (v != corners[0] && v != corners[1] && v != corners[2])
+                newCache[newCount++] = v;
+        }
+        for (int i = VERTEX_CACHE_SIZE; i < newCount; i++)
+            cachePosition[newCache[i]] = -1;
+        cacheCount = (newCount < VERTEX_CACHE_SIZE) ? newCount : VERTEX_CACHE_SIZE;
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        // rescore what the cache touches and pick the next triangle from there
+        for (int i = 0; i < newCount; i++)
+        {
+            uint32_t v = newCache[i];
+            cachePosition[v] = (i < VERTEX_CACHE_SIZE) ? i : -1;
+            vScore[v] = vertexScore(cachePosition[v], liveTriangles[v]);
+        }
+
+        best = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            uint32_t v = cache[i];
+            const uint32_t* list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++)
+            {
+                uint32_t t = list[j];
+                float score = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+                tScore[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+void MeshCooker::optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& clusters)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || clusters.empty())
+        return;
+
+    // split the hard (cache restart) clusters further wherever the running
+    // miss ratio is already as good as the cluster's, so sorting has pieces
+    // to work with without losing much of the cache order
+    std::vector<uint32_t> soft;
+    std::vector<uint32_t> stamp(positions.size(), 0);
+    uint32_t time = VERTEX_CACHE_SIZE + 1;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        size_t begin = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+
+        // advancing the clock past the cache size empties it
+        time += VERTEX_CACHE_SIZE + 1;
+        size_t misses = 0;
+        for (size_t t = begin; t < end; t++)
+            for (int k = 0; k < 3; k++)
+                if (time - stamp[indices[t * 3 + k]] > VERTEX_CACHE_SIZE)
+                {
+                    stamp[indices[t * 3 + k]] = time++;
+                    misses++;
+                }
+        float clusterRatio = (float)misses / (end - begin);
+
+        soft.push_back((uint32_t)begin);
+        time += VERTEX_CACHE_SIZE + 1;
+        size_t start = begin;
+        misses = 0;
+        for (size_t t = begin; t < end; t++)
+        {
+            for (int k = 0; k < 3; k++)
+                if (time - stamp[indices[t * 3 + k]] > VERTEX_CACHE_SIZE)
+                {
+                    stamp[indices[t * 3 + k]] = time++;
+                    misses++;
+                }
+            if (t + 1 < end && (float)misses / (t - start + 1) <= clusterRatio * OVERDRAW_SPLIT_THRESHOLD && t - start + 1 >= 16)
+            {
+                soft.push_back((uint32_t)(t + 1));
+                time += VERTEX_CACHE_SIZE + 1;  // flush
+                start = t + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    // area weighted centroid and normal per cluster
+    size_t clusterCount = soft.size();
+    std::vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normal(clusterCount, glm::vec3(0.0f));
+    std::vector<float> area(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        size_t end = (c + 1 < clusterCount) ? soft[c + 1] : triangleCount;
+        for (size_t t = soft[c]; t < end; t++)
+        {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float twiceArea = glm::length(n);
+            centroid[c] += (a + b + d) * (twiceArea / 3.0f);
+            normal[c] += n;
+            area[c] += twiceArea;
+        }
+        meshCentroid += centroid[c];
+        meshArea += area[c];
+    }
+    meshCentroid = (meshArea > 0.0f) ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // clusters facing away from the middle are most likely to occlude the rest, draw them first
+    std::vector<float> sortKey(clusterCount);
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 center = (area[c] > 0.0f) ? centroid[c] / area[c] : meshCentroid;
+        float length = glm::length(normal[c]);
+        sortKey[c] = (length > 0.0f) ? glm::dot(center - meshCentroid, normal[c] / length) : 0.0f;
+        order[c] = (uint32_t)c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indexCount);
+    for (size_t i = 0; i < clusterCount; i++)
+    {
+        uint32_t c = order[i];
+        size_t end = (c + 1 < clusterCount) ? soft[c + 1] : triangleCount;
+        sorted.insert(sorted.end(), indices + soft[c] * 3, indices + end * 3);
+    }
+    memcpy(indices, sorted.data(), indexCount * sizeof(uint32_t));
+}
+
+void MeshCooker::optimizeVertexFetch(ImportedMesh& mesh)
+{
+    const uint32_t unused = 0xFFFFFFFFu;
+    std::vector<uint32_t> remap(mesh.positions.size(), unused);
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        uint32_t& target = remap[mesh.indices[i]];
+        if (target == unused)
+            target = next++;
+        mesh.indices[i] = target;
+    }
+
+    std::vector<glm::vec3> positions(next), normals(next);
+    std::vector<glm::vec2> texCoords(next);
+    for (size_t v = 0; v < remap.size(); v++)
+    {
+        if (remap[v] == unused)
+            continue;
+        positions[remap[v]] = mesh.positions[v];
+        normals[remap[v]] = mesh.normals[v];
+        texCoords[remap[v]] = mesh.texCoords[v];
+    }
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+    mesh.texCoords.swap(texCoords);
+}
+
+float MeshCooker::averageCacheMissRatio(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+    if (indexCount < 3)
+        return 0.0f;
+
+    // FIFO: a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> stamp(vertexCount, 0);
+    uint32_t misses = 0;
+    uint32_t time = cacheSize + 1;
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        if (time - stamp[indices[i]] > (uint32_t)cacheSize)
+        {
+            stamp[indices[i]] = time++;
+            misses++;
+        }
+    }
+    return (float)misses / (indexCount / 3);
+}
+
+bool MeshCooker::needsCook(const std::string& source, const std::string& output)
+{
+    uint64_t cooked, original;
+    if (!MappedFile::LastWriteTime(output.c_str(), cooked))
+        return true;
+    if (MappedFile::LastWriteTime(source.c_str(), original) && original > cooked)
+        return true;
+
+    CookedMesh existing;
+    return !existing.open(output.c_str());
+}
+
+static inline uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + COOKED_MESH_ALIGNMENT - 1) & ~(uint64_t)(COOKED_MESH_ALIGNMENT - 1);
+}
+
+static void copyName(char* destination, size_t capacity, const std::string& source)
+{
+    size_t length = (source.size() < capacity - 1) ? source.size() : capacity - 1;
+    memcpy(destination, source.c_str(), length);
+    destination[length] = '\0';
+}
+
+bool MeshCooker::cook(const std::string& source, const std::string& output)
+{
+    double startTime = Timer::getAppRunTime();
+
+    ImportedMesh mesh;
+    if (!ObjImporter::import(source, mesh))
+        return false;
+
+    size_t vertexCount = mesh.positions.size();
+    float missesBefore = averageCacheMissRatio(mesh.indices.data(), mesh.indices.size(), vertexCount, VERTEX_CACHE_SIZE);
+
+    // subsets are drawn separately, optimize each on its own
+    for (size_t s = 0; s < mesh.subsets.size(); s++)
+    {
+        uint32_t* subsetIndices = &mesh.indices[mesh.subsets[s].indexOffset];
+        std::vector<uint32_t> clusters;
+        optimizeVertexCache(subsetIndices, mesh.subsets[s].indexCount, vertexCount, &clusters);
+        optimizeOverdraw(subsetIndices, mesh.subsets[s].indexCount, mesh.positions, clusters);
+    }
+    optimizeVertexFetch(mesh);
+    vertexCount = mesh.positions.size();
+    float missesAfter = averageCacheMissRatio(mesh.indices.data(), mesh.indices.size(), vertexCount, VERTEX_CACHE_SIZE);
+
+    // quantize
+    glm::vec3 boundsMin = mesh.positions[0];
+    glm::vec3 boundsMax = mesh.positions[0];
+    for (size_t v = 1; v < vertexCount; v++)
+    {
+        boundsMin = glm::min(boundsMin, mesh.positions[v]);
+        boundsMax = glm::max(boundsMax, mesh.positions[v]);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+    std::vector<CookedMeshVertex> vertices(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        glm::vec3 unit = (mesh.positions[v] - boundsMin) * inverseExtent;
+        vertices[v].position[0] = glm::packUnorm1x16(unit.x);
+        vertices[v].position[1] = glm::packUnorm1x16(unit.y);
+        vertices[v].position[2] = glm::packUnorm1x16(unit.z);
+        vertices[v].position[3] = 0;
+        vertices[v].normal = glm::packSnorm3x10_1x2(glm::vec4(mesh.normals[v], 0.0f));
+        vertices[v].texCoord[0] = glm::packHalf1x16(mesh.texCoords[v].x);
+        vertices[v].texCoord[1] = glm::packHalf1x16(mesh.texCoords[v].y);
+    }
+
+    CookedMeshHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.vertexCount = (uint32_t)vertexCount;
+    header.indexCount = (uint32_t)mesh.indices.size();
+    header.indexSize = (vertexCount <= 0x10000) ? 2 : 4;
+    header.subsetCount = (uint32_t)mesh.subsets.size();
+    header.materialCount = (uint32_t)mesh.materials.size();
+    for (int c = 0; c < 3; c++)
+    {
+        header.boundsMin[c] = boundsMin[c];
+        header.boundsMax[c] = boundsMax[c];
+    }
+    header.vertexOffset = alignOffset(sizeof(CookedMeshHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + vertexCount * sizeof(CookedMeshVertex));
+    header.subsetOffset = alignOffset(header.indexOffset + (uint64_t)header.indexCount * header.indexSize);
+    header.materialOffset = alignOffset(header.subsetOffset + header.subsetCount * sizeof(CookedMeshSubset));
+    uint64_t fileSize = header.materialOffset + header.materialCount * sizeof(CookedMeshMaterial);
+
+    std::vector<uint8_t> fileData((size_t)fileSize, 0);
+    memcpy(&fileData[0], &header, sizeof(header));
+    memcpy(&fileData[(size_t)header.vertexOffset], vertices.data(), vertexCount * sizeof(CookedMeshVertex));
+    if (header.indexSize == 2)
+    {
+        uint16_t* out = (uint16_t*)&fileData[(size_t)header.indexOffset];
+        for (size_t i = 0; i < mesh.indices.size(); i++)
+            out[i] = (uint16_t)mesh.indices[i];
+    }
+    else
+    {
+        memcpy(&fileData[(size_t)header.indexOffset], mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    CookedMeshSubset* subsets = (CookedMeshSubset*)&fileData[(size_t)header.subsetOffset];
+    for (size_t s = 0; s < mesh.subsets.size(); s++)
+    {
+        subsets[s].indexOffset = mesh.subsets[s].indexOffset;
+        subsets[s].indexCount = mesh.subsets[s].indexCount;
+        subsets[s].material = mesh.subsets[s].material;
+    }
+
+    CookedMeshMaterial* materials = (CookedMeshMaterial*)&fileData[(size_t)header.materialOffset];
+    for (size_t m = 0; m < mesh.materials.size(); m++)
+    {
+        const MeshMaterial& material = mesh.materials[m];
+        copyName(materials[m].name, sizeof(materials[m].name), material.name);
+        copyName(materials[m].diffuseMap, sizeof(materials[m].diffuseMap), material.diffuseMap);
+        for (int c = 0; c < 4; c++)
+            materials[m].diffuse[c] = material.diffuse[c];
+        for (int c = 0; c < 3; c++)
+            materials[m].specular[c] = material.specular[c];
+        materials[m].shininess = material.shininess;
+    }
+
+    // write next to the target and swap in, so a crash never leaves a torn file
+    std::string temporary = output + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        LOG_ERROR("MeshCooker: cannot write %s", temporary.c_str());
+        return false;
+    }
+    bool written = fwrite(fileData.data(), 1, fileData.size(), file) == fileData.size();
+    fclose(file);
+    if (!written || !MoveFileExA(temporary.c_str(), output.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        LOG_ERROR("MeshCooker: failed to write %s", output.c_str());
+        DeleteFileA(temporary.c_str());
+        return false;
+    }
+
+    LOG_INFO("MeshCooker: %s, %d vertices %d triangles, ACMR %.3f -> %.3f, %d KB in %.3f seconds", output.c_str(), (int)vertexCount,
+        (int)(mesh.indices.size() / 3), missesBefore, missesAfter, (int)(fileData.size() / 1024), Timer::getAppRunTime() - startTime);
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef MESHCOOKER_H
+#define MESHCOOKER_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "ObjImporter.h"
+
+// Offline mesh step: imports an OBJ, reorders each subset's triangles for
+// the post-transform vertex cache (Forsyth) and then for overdraw (clusters
+// sorted outside-in), reorders vertices into first-use order for fetch
+// locality, quantizes attributes to 16 bytes per vertex and writes a
+// CookedMesh file that loads with a single memory map.
+class MeshCooker
+{
+public:
+    static bool cook(const std::string& source, const std::string& output);
+    // output missing, unreadable or older than the source
+    static bool needsCook(const std::string& source, const std::string& output);
+
+    // exposed for tools and statistics; indices are rewritten in place
+    static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters);
+    static void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& clusters);
+    static void optimizeVertexFetch(ImportedMesh& mesh);
+    // average cache misses per triangle for a FIFO cache of the given size
+    static float averageCacheMissRatio(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize);
+};
+
+#endif // MESHCOOKER_H
@@ -0,0 +1,793 @@
+#include "NoiseBench.h"
+
+#include <emmintrin.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "Logger.h"
+
+// samples per measurement, and the shortest a sample may be (the batch is
+// repeated until it is, so small batches are not all timer resolution)
+#define NOISE_BENCH_SAMPLES 15
+#define NOISE_BENCH_MIN_SAMPLE_MS 2.0
+// terrain.tes' perlin with the demo terrain's frequency (0.005 * 20) and octaves
+#define NOISE_BENCH_FREQUENCY 0.1f
+#define NOISE_BENCH_OCTAVES 6
+// worley.comp's first cell count
+#define NOISE_BENCH_CELLS 2.0f
+
+// keeps the scalar variants scalar, the auto variants are the same loop without it
+#ifdef _MSC_VER
+#define NOISE_BENCH_NO_VECTOR __pragma(loop(no_vector))
+#else
+#define NOISE_BENCH_NO_VECTOR
+#endif
+
+static const int benchBatchSizes[] = { 256, 4096, 65536 };
+static const int BENCH_BATCH_COUNT = sizeof(benchBatchSizes) / sizeof(benchBatchSizes[0]);
+static const int BENCH_MAX_BATCH = 65536;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchInput
+{
+    std::vector<float> x, y;            // terrain-sized world positions
+    std::vector<float> cx, cy, cz;      // worley cell space, [0, 1)
+    std::vector<int32_t> ix, iy;        // hash lattice coordinates
+    std::vector<float> yaw, pitch;      // degrees
+};
+
+// out holds outputWidth values per element, value k of element i at out[k * count + i]
+typedef void (*BenchFunction)(const BenchInput& in, float* out, int count);
+
+struct BenchVariant
+{
+    const char* name;
+    BenchFunction function;
+};
+
+struct BenchKernel
+{
+    const char* name;
+    int outputWidth;
+    float tolerance;    // largest difference to the scalar variant that still agrees
+    float outliers;     // fraction of elements allowed past it, see benchKernels
+    bool periodic;      // values in [0, 1) compared with wrap-around (hash outputs)
+    BenchVariant variants[3];
+};
+
+static volatile float benchSink = 0.0f;
+
+// ============================================================================
+// scalar kernels, one element; the scalar and auto variants share them
+
+static inline float fractf(float x)
+{
+    return x - floorf(x);
+}
+
+// Random2D from terrain.tes / weather.comp with seed 0
+static inline float hashSin(float x, float y)
+{
+    return fractf(sinf(x * 12.9898f + y * 78.233f) * 43758.5453123f);
+}
+
+// pcg2d (Jarzynski and Olano, "Hash Functions for GPU Rendering"), x component
+static inline float hashPcg(uint32_t x, uint32_t y)
+{
+    x = x * 1664525u + 1013904223u;
+    y = y * 1664525u + 1013904223u;
+    x += y * 1664525u;
+    y += x * 1664525u;
+    x ^= x >> 16;
+    y ^= y >> 16;
+    x += y * 1664525u;
+    y += x * 1664525u;
+    x ^= x >> 16;
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline float hashXx(uint32_t x, uint32_t y)
+{
+    uint32_t h = y + 374761393u + x * 3266489917u;
+    h = 668265263u * ((h << 17) | (h >> 15));
+    h = 2246822519u * (h ^ (h >> 15));
+    h = 3266489917u * (h ^ (h >> 13));
+    h ^= h >> 16;
+    return (float)(h >> 8) * (1.0f / 16777216.0f);
+}
+
+// InterpolatedNoise from terrain.tes; Quintic selects its fade, Pcg the integer hash
+template <bool Quintic, bool Pcg>
+static inline float valueNoise(float x, float y)
+{
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float wx = x - fx;
+    float wy = y - fy;
+    float a, b, c, d;
+    if (Pcg)
+    {
+        uint32_t ux = (uint32_t)(int32_t)fx;
+        uint32_t uy = (uint32_t)(int32_t)fy;
+        a = hashPcg(ux, uy);
+        b = hashPcg(ux + 1, uy);
+        c = hashPcg(ux, uy + 1);
+        d = hashPcg(ux + 1, uy + 1);
+    }
+    else
+    {
+        a = hashSin(fx, fy);
+        b = hashSin(fx + 1.0f, fy);
+        c = hashSin(fx, fy + 1.0f);
+        d = hashSin(fx + 1.0f, fy + 1.0f);
+    }
+    if (Quintic)
+    {
+        wx = wx * wx * wx * (10.0f + wx * (-15.0f + 6.0f * wx));
+        wy = wy * wy * wy * (10.0f + wy * (-15.0f + 6.0f * wy));
+    }
+    else
+    {
+        wx = wx * wx * (3.0f - 2.0f * wx);
+        wy = wy * wy * (3.0f - 2.0f * wy);
+    }
+    return a + (b - a) * wx + (c - a) * wy + (d - c - b + a) * wx * wy;
+}
+
+// perlin() from terrain.tes, power 1
+template <bool Pcg>
+static inline float perlinFbm(float x, float y)
+{
+    float total = 0.0f;
+    float frequency = NOISE_BENCH_FREQUENCY;
+    float amplitude = 1.0f;
+    for (int i = 0; i < NOISE_BENCH_OCTAVES; i++)
+    {
+        frequency *= 2.0f;
+        amplitude *= 0.5f;
+        float vx = frequency * (0.8f * x + 0.6f * y);
+        float vy = frequency * (-0.6f * x + 0.8f * y);
+        total += valueNoise<true, Pcg>(vx, vy) * amplitude;
+    }
+    return total;
+}
+
+// worley.comp's hash, noise and cells
+static inline float worleyHash(float n)
+{
+    return fractf(sinf(n + 1.951f) * 43758.5453123f);
+}
+
+static inline float worleyNoise(float x, float y, float z)
+{
+    float px = floorf(x), py = floorf(y), pz = floorf(z);
+    float fx = x - px, fy = y - py, fz = z - pz;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+    fz = fz * fz * (3.0f - 2.0f * fz);
+    float n = px + py * 57.0f + 113.0f * pz;
+    float x00 = worleyHash(n) + (worleyHash(n + 1.0f) - worleyHash(n)) * fx;
+    float x10 = worleyHash(n + 57.0f) + (worleyHash(n + 58.0f) - worleyHash(n + 57.0f)) * fx;
+    float x01 = worleyHash(n + 113.0f) + (worleyHash(n + 114.0f) - worleyHash(n + 113.0f)) * fx;
+    float x11 = worleyHash(n + 170.0f) + (worleyHash(n + 171.0f) - worleyHash(n + 170.0f)) * fx;
+    float y0 = x00 + (x10 - x00) * fy;
+    float y1 = x01 + (x11 - x01) * fy;
+    return y0 + (y1 - y0) * fz;
+}
+
+static inline float glslMod(float x, float y)
+{
+    return x - y * floorf(x / y);
+}
+
+static inline float worleyCells(float x, float y, float z)
+{
+    float px = x * NOISE_BENCH_CELLS, py = y * NOISE_BENCH_CELLS, pz = z * NOISE_BENCH_CELLS;
+    float d = 1.0e10f;
+    for (int xo = -1; xo <= 1; xo++)
+    {
+        for (int yo = -1; yo <= 1; yo++)
+        {
+            for (int zo = -1; zo <= 1; zo++)
+            {
+                float tx = floorf(px) + xo, ty = floorf(py) + yo, tz = floorf(pz) + zo;
+                float offset = worleyNoise(glslMod(tx, NOISE_BENCH_CELLS), glslMod(ty, NOISE_BENCH_CELLS), glslMod(tz, NOISE_BENCH_CELLS));
+                tx = px - tx - offset;
+                ty = py - ty - offset;
+                tz = pz - tz - offset;
+                d = std::min(d, tx * tx + ty * ty + tz * tz);
+            }
+        }
+    }
+    return std::min(std::max(d, 0.0f), 1.0f);
+}
+
+// loops over the element kernels above
+template <float (*Hash)(float, float)>
+static void runHashFloat(const BenchInput& in, float* out, int count, bool vectorize)
+{
+    if (vectorize)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = Hash((float)in.ix[i], (float)in.iy[i]);
+        return;
+    }
+    NOISE_BENCH_NO_VECTOR
+    for (int i = 0; i < count; i++)
+        out[i] = Hash((float)in.ix[i], (float)in.iy[i]);
+}
+
+template <float (*Hash)(uint32_t, uint32_t)>
+static void runHashInt(const BenchInput& in, float* out, int count, bool vectorize)
+{
+    if (vectorize)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = Hash((uint32_t)in.ix[i], (uint32_t)in.iy[i]);
+        return;
+    }
+    NOISE_BENCH_NO_VECTOR
+    for (int i = 0; i < count; i++)
+        out[i] = Hash((uint32_t)in.ix[i], (uint32_t)in.iy[i]);
+}
+
+template <float (*Noise)(float, float)>
+static void runNoise2D(const BenchInput& in, float* out, int count, bool vectorize)
+{
+    if (vectorize)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = Noise(in.x[i], in.y[i]);
+        return;
+    }
+    NOISE_BENCH_NO_VECTOR
+    for (int i = 0; i < count; i++)
+        out[i] = Noise(in.x[i], in.y[i]);
+}
+
+static void runWorley(const BenchInput& in, float* out, int count, bool vectorize)
+{
+    if (vectorize)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = worleyCells(in.cx[i], in.cy[i], in.cz[i]);
+        return;
+    }
+    NOISE_BENCH_NO_VECTOR
+    for (int i = 0; i < count; i++)
+        out[i] = worleyCells(in.cx[i], in.cy[i], in.cz[i]);
+}
+
+template <void (*Run)(const BenchInput&, float*, int, bool)>
+static void scalarVariant(const BenchInput& in, float* out, int count)
+{
+    Run(in, out, count, false);
+}
+
+template <void (*Run)(const BenchInput&, float*, int, bool)>
+static void autoVariant(const BenchInput& in, float* out, int count)
+{
+    Run(in, out, count, true);
+}
+
+// Camera::updateCameraVectors as written: one camera at a time through glm
+static void cameraAos(const BenchInput& in, float* out, int count)
+{
+    const glm::vec3 worldUp(0.0f, 1.0f, 0.0f);
+    NOISE_BENCH_NO_VECTOR
+    for (int i = 0; i < count; i++)
+    {
+        float yaw = glm::radians(in.yaw[i]);
+        float pitch = glm::radians(in.pitch[i]);
+        glm::vec3 front;
+        front.x = cosf(yaw) * cosf(pitch);
+        front.y = sinf(pitch);
+        front.z = sinf(yaw) * cosf(pitch);
+        front = glm::normalize(front);
+        glm::vec3 right = glm::normalize(glm::cross(front, worldUp));
+        glm::vec3 up = glm::normalize(glm::cross(right, front));
+        const glm::vec3 vectors[3] = { front, right, up };
+        for (int k = 0; k < 9; k++)
+            out[k * count + i] = vectors[k / 3][k % 3];
+    }
+}
+
+// the same on structure-of-arrays, written for the auto-vectorizer
+static void cameraSoa(const BenchInput& in, float* out, int count)
+{
+    float* fx = out;
+    float* fy = out + count;
+    float* fz = out + 2 * count;
+    float* rx = out + 3 * count;
+    float* ry = out + 4 * count;
+    float* rz = out + 5 * count;
+    float* ux = out + 6 * count;
+    float* uy = out + 7 * count;
+    float* uz = out + 8 * count;
+    const float degrees = 3.14159265358979f / 180.0f;
+    for (int i = 0; i < count; i++)
+    {
+        float yaw = in.yaw[i] * degrees;
+        float pitch = in.pitch[i] * degrees;
+        float x = cosf(yaw) * cosf(pitch);
+        float y = sinf(pitch);
+        float z = sinf(yaw) * cosf(pitch);
+        float inverse = 1.0f / sqrtf(x * x + y * y + z * z);
+        x *= inverse; y *= inverse; z *= inverse;
+        // cross(front, (0, 1, 0))
+        float ax = -z, ay = 0.0f, az = x;
+        inverse = 1.0f / sqrtf(ax * ax + az * az);
+        ax *= inverse; az *= inverse;
+        float bx = ay * z - az * y;
+        float by = az * x - ax * z;
+        float bz = ax * y - ay * x;
+        inverse = 1.0f / sqrtf(bx * bx + by * by + bz * bz);
+        fx[i] = x; fy[i] = y; fz[i] = z;
+        rx[i] = ax; ry[i] = ay; rz[i] = az;
+        ux[i] = bx * inverse; uy[i] = by * inverse; uz[i] = bz * inverse;
+    }
+}
+
+// ============================================================================
+// SSE2, four elements per iteration (batch sizes are multiples of 4)
+
+static inline __m128 floor4(__m128 x)
+{
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 fract4(__m128 x)
+{
+    return _mm_sub_ps(x, floor4(x));
+}
+
+// reduced by pi in double, so the large arguments of the sin hashes keep
+// their precision, then an odd Taylor polynomial on [-pi/2, pi/2]
+static inline __m128 sin4(__m128 x)
+{
+    const __m128d inversePi = _mm_set1_pd(0.31830988618379067);
+    const __m128d pi = _mm_set1_pd(3.14159265358979323);
+    __m128d low = _mm_cvtps_pd(x);
+    __m128d high = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+    __m128i quadrantLow = _mm_cvtpd_epi32(_mm_mul_pd(low, inversePi));
+    __m128i quadrantHigh = _mm_cvtpd_epi32(_mm_mul_pd(high, inversePi));
+    low = _mm_sub_pd(low, _mm_mul_pd(_mm_cvtepi32_pd(quadrantLow), pi));
+    high = _mm_sub_pd(high, _mm_mul_pd(_mm_cvtepi32_pd(quadrantHigh), pi));
+    __m128 r = _mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high));
+    __m128i quadrant = _mm_unpacklo_epi64(quadrantLow, quadrantHigh);
+
+    __m128 r2 = _mm_mul_ps(r, r);
+    __m128 p = _mm_set1_ps(-2.5052108e-8f);
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(2.7557319e-6f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-1.9841270e-4f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(8.3333333e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(-1.6666667e-1f));
+    __m128 s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(p, r2), r));
+    // sin(r + q * pi) = (-1)^q sin(r)
+    return _mm_xor_ps(s, _mm_castsi128_ps(_mm_slli_epi32(quadrant, 31)));
+}
+
+static inline __m128 cos4(__m128 x)
+{
+    return sin4(_mm_add_ps(x, _mm_set1_ps(1.57079632679f)));
+}
+
+// 32-bit low multiply, SSE2 only has the unsigned 32x32->64 one
+static inline __m128i mullo4(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128 unitFloat4(__m128i h)
+{
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+}
+
+static inline __m128 hashSin4(__m128 x, __m128 y)
+{
+    __m128 dot = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(12.9898f)), _mm_mul_ps(y, _mm_set1_ps(78.233f)));
+    return fract4(_mm_mul_ps(sin4(dot), _mm_set1_ps(43758.5453123f)));
+}
+
+static inline __m128 hashPcg4(__m128i x, __m128i y)
+{
+    const __m128i multiplier = _mm_set1_epi32(1664525);
+    const __m128i increment = _mm_set1_epi32(1013904223);
+    x = _mm_add_epi32(mullo4(x, multiplier), increment);
+    y = _mm_add_epi32(mullo4(y, multiplier), increment);
+    x = _mm_add_epi32(x, mullo4(y, multiplier));
+    y = _mm_add_epi32(y, mullo4(x, multiplier));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    y = _mm_xor_si128(y, _mm_srli_epi32(y, 16));
+    x = _mm_add_epi32(x, mullo4(y, multiplier));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    return unitFloat4(x);
+}
+
+static inline __m128 hashXx4(__m128i x, __m128i y)
+{
+    __m128i h = _mm_add_epi32(_mm_add_epi32(y, _mm_set1_epi32(374761393)), mullo4(x, _mm_set1_epi32((int)3266489917u)));
+    h = mullo4(_mm_or_si128(_mm_slli_epi32(h, 17), _mm_srli_epi32(h, 15)), _mm_set1_epi32(668265263));
+    h = mullo4(_mm_xor_si128(h, _mm_srli_epi32(h, 15)), _mm_set1_epi32((int)2246822519u));
+    h = mullo4(_mm_xor_si128(h, _mm_srli_epi32(h, 13)), _mm_set1_epi32((int)3266489917u));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    return unitFloat4(h);
+}
+
+template <bool Quintic, bool Pcg>
+static inline __m128 valueNoise4(__m128 x, __m128 y)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 fx = floor4(x);
+    __m128 fy = floor4(y);
+    __m128 wx = _mm_sub_ps(x, fx);
+    __m128 wy = _mm_sub_ps(y, fy);
+    __m128 a, b, c, d;
+    if (Pcg)
+    {
+        const __m128i oneInt = _mm_set1_epi32(1);
+        __m128i ux = _mm_cvttps_epi32(fx);
+        __m128i uy = _mm_cvttps_epi32(fy);
+        a = hashPcg4(ux, uy);
+        b = hashPcg4(_mm_add_epi32(ux, oneInt), uy);
+        c = hashPcg4(ux, _mm_add_epi32(uy, oneInt));
+        d = hashPcg4(_mm_add_epi32(ux, oneInt), _mm_add_epi32(uy, oneInt));
+    }
+    else
+    {
+        a = hashSin4(fx, fy);
+        b = hashSin4(_mm_add_ps(fx, one), fy);
+        c = hashSin4(fx, _mm_add_ps(fy, one));
+        d = hashSin4(_mm_add_ps(fx, one), _mm_add_ps(fy, one));
+    }
+    if (Quintic)
+    {
+        __m128 px = _mm_add_ps(_mm_set1_ps(-15.0f), _mm_mul_ps(_mm_set1_ps(6.0f), wx));
+        __m128 py = _mm_add_ps(_mm_set1_ps(-15.0f), _mm_mul_ps(_mm_set1_ps(6.0f), wy));
+        px = _mm_add_ps(_mm_set1_ps(10.0f), _mm_mul_ps(wx, px));
+        py = _mm_add_ps(_mm_set1_ps(10.0f), _mm_mul_ps(wy, py));
+        wx = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(wx, wx), wx), px);
+        wy = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(wy, wy), wy), py);
+    }
+    else
+    {
+        wx = _mm_mul_ps(_mm_mul_ps(wx, wx), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(wx, wx)));
+        wy = _mm_mul_ps(_mm_mul_ps(wy, wy), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(wy, wy)));
+    }
+    __m128 k3 = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(d, c), b), a);
+    __m128 result = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wx));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_sub_ps(c, a), wy));
+    return _mm_add_ps(result, _mm_mul_ps(_mm_mul_ps(k3, wx), wy));
+}
+
+template <bool Pcg>
+static inline __m128 perlinFbm4(__m128 x, __m128 y)
+{
+    __m128 total = _mm_setzero_ps();
+    float frequency = NOISE_BENCH_FREQUENCY;
+    float amplitude = 1.0f;
+    for (int i = 0; i < NOISE_BENCH_OCTAVES; i++)
+    {
+        frequency *= 2.0f;
+        amplitude *= 0.5f;
+        __m128 f = _mm_set1_ps(frequency);
+        __m128 vx = _mm_mul_ps(f, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.8f), x), _mm_mul_ps(_mm_set1_ps(0.6f), y)));
+        __m128 vy = _mm_mul_ps(f, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.6f), x), _mm_mul_ps(_mm_set1_ps(0.8f), y)));
+        total = _mm_add_ps(total, _mm_mul_ps(valueNoise4<true, Pcg>(vx, vy), _mm_set1_ps(amplitude)));
+    }
+    return total;
+}
+
+static inline __m128 worleyHash4(__m128 n)
+{
+    return fract4(_mm_mul_ps(sin4(_mm_add_ps(n, _mm_set1_ps(1.951f))), _mm_set1_ps(43758.5453123f)));
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+static inline __m128 worleyNoise4(__m128 x, __m128 y, __m128 z)
+{
+    __m128 px = floor4(x), py = floor4(y), pz = floor4(z);
+    __m128 fx = _mm_sub_ps(x, px), fy = _mm_sub_ps(y, py), fz = _mm_sub_ps(z, pz);
+    const __m128 three = _mm_set1_ps(3.0f);
+    fx = _mm_mul_ps(_mm_mul_ps(fx, fx), _mm_sub_ps(three, _mm_add_ps(fx, fx)));
+    fy = _mm_mul_ps(_mm_mul_ps(fy, fy), _mm_sub_ps(three, _mm_add_ps(fy, fy)));
+    fz = _mm_mul_ps(_mm_mul_ps(fz, fz), _mm_sub_ps(three, _mm_add_ps(fz, fz)));
+    __m128 n = _mm_add_ps(_mm_add_ps(px, _mm_mul_ps(py, _mm_set1_ps(57.0f))), _mm_mul_ps(pz, _mm_set1_ps(113.0f)));
+    __m128 x00 = lerp4(worleyHash4(n), worleyHash4(_mm_add_ps(n, _mm_set1_ps(1.0f))), fx);
+    __m128 x10 = lerp4(worleyHash4(_mm_add_ps(n, _mm_set1_ps(57.0f))), worleyHash4(_mm_add_ps(n, _mm_set1_ps(58.0f))), fx);
+    __m128 x01 = lerp4(worleyHash4(_mm_add_ps(n, _mm_set1_ps(113.0f))), worleyHash4(_mm_add_ps(n, _mm_set1_ps(114.0f))), fx);
+    __m128 x11 = lerp4(worleyHash4(_mm_add_ps(n, _mm_set1_ps(170.0f))), worleyHash4(_mm_add_ps(n, _mm_set1_ps(171.0f))), fx);
+    return lerp4(lerp4(x00, x10, fy), lerp4(x01, x11, fy), fz);
+}
+
+static inline __m128 glslMod4(__m128 x, float y)
+{
+    return _mm_sub_ps(x, _mm_mul_ps(_mm_set1_ps(y), floor4(_mm_mul_ps(x, _mm_set1_ps(1.0f / y)))));
+}
+
+static inline __m128 worleyCells4(__m128 x, __m128 y, __m128 z)
+{
+    const __m128 cells = _mm_set1_ps(NOISE_BENCH_CELLS);
+    __m128 px = _mm_mul_ps(x, cells), py = _mm_mul_ps(y, cells), pz = _mm_mul_ps(z, cells);
+    __m128 bx = floor4(px), by = floor4(py), bz = floor4(pz);
+    __m128 d = _mm_set1_ps(1.0e10f);
+    for (int xo = -1; xo <= 1; xo++)
+    {
+        for (int yo = -1; yo <= 1; yo++)
+        {
+            for (int zo = -1; zo <= 1; zo++)
+            {
+                __m128 tx = _mm_add_ps(bx, _mm_set1_ps((float)xo));
+                __m128 ty = _mm_add_ps(by, _mm_set1_ps((float)yo));
+                __m128 tz = _mm_add_ps(bz, _mm_set1_ps((float)zo));
+                __m128 offset = worleyNoise4(glslMod4(tx, NOISE_BENCH_CELLS), glslMod4(ty, NOISE_BENCH_CELLS), glslMod4(tz, NOISE_BENCH_CELLS));
+                tx = _mm_sub_ps(_mm_sub_ps(px, tx), offset);
+                ty = _mm_sub_ps(_mm_sub_ps(py, ty), offset);
+                tz = _mm_sub_ps(_mm_sub_ps(pz, tz), offset);
+                d = _mm_min_ps(d, _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+            }
+        }
+    }
+    return _mm_min_ps(_mm_max_ps(d, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+template <__m128 (*Hash)(__m128, __m128)>
+static void sseHashFloat(const BenchInput& in, float* out, int count)
+{
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128i ix = _mm_loadu_si128((const __m128i*)&in.ix[i]);
+        __m128i iy = _mm_loadu_si128((const __m128i*)&in.iy[i]);
+        _mm_storeu_ps(&out[i], Hash(_mm_cvtepi32_ps(ix), _mm_cvtepi32_ps(iy)));
+    }
+}
+
+template <__m128 (*Hash)(__m128i, __m128i)>
+static void sseHashInt(const BenchInput& in, float* out, int count)
+{
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128i ix = _mm_loadu_si128((const __m128i*)&in.ix[i]);
+        __m128i iy = _mm_loadu_si128((const __m128i*)&in.iy[i]);
+        _mm_storeu_ps(&out[i], Hash(ix, iy));
+    }
+}
+
+template <__m128 (*Noise)(__m128, __m128)>
+static void sseNoise2D(const BenchInput& in, float* out, int count)
+{
+    for (int i = 0; i < count; i += 4)
+        _mm_storeu_ps(&out[i], Noise(_mm_loadu_ps(&in.x[i]), _mm_loadu_ps(&in.y[i])));
+}
+
+static void sseWorley(const BenchInput& in, float* out, int count)
+{
+    for (int i = 0; i < count; i += 4)
+        _mm_storeu_ps(&out[i], worleyCells4(_mm_loadu_ps(&in.cx[i]), _mm_loadu_ps(&in.cy[i]), _mm_loadu_ps(&in.cz[i])));
+}
+
+static inline __m128 normalizeScale4(__m128 x, __m128 y, __m128 z)
+{
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    return _mm_div_ps(_mm_set1_ps(1.0f), length);
+}
+
+static void sseCamera(const BenchInput& in, float* out, int count)
+{
+    const __m128 degrees = _mm_set1_ps(3.14159265358979f / 180.0f);
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 yaw = _mm_mul_ps(_mm_loadu_ps(&in.yaw[i]), degrees);
+        __m128 pitch = _mm_mul_ps(_mm_loadu_ps(&in.pitch[i]), degrees);
+        __m128 cosPitch = cos4(pitch);
+        __m128 x = _mm_mul_ps(cos4(yaw), cosPitch);
+        __m128 y = sin4(pitch);
+        __m128 z = _mm_mul_ps(sin4(yaw), cosPitch);
+        __m128 scale = normalizeScale4(x, y, z);
+        x = _mm_mul_ps(x, scale); y = _mm_mul_ps(y, scale); z = _mm_mul_ps(z, scale);
+        // cross(front, (0, 1, 0))
+        __m128 ax = _mm_sub_ps(_mm_setzero_ps(), z), ay = _mm_setzero_ps(), az = x;
+        scale = normalizeScale4(ax, ay, az);
+        ax = _mm_mul_ps(ax, scale); az = _mm_mul_ps(az, scale);
+        __m128 bx = _mm_sub_ps(_mm_mul_ps(ay, z), _mm_mul_ps(az, y));
+        __m128 by = _mm_sub_ps(_mm_mul_ps(az, x), _mm_mul_ps(ax, z));
+        __m128 bz = _mm_sub_ps(_mm_mul_ps(ax, y), _mm_mul_ps(ay, x));
+        scale = normalizeScale4(bx, by, bz);
+        const __m128 values[9] = { x, y, z, ax, ay, az, _mm_mul_ps(bx, scale), _mm_mul_ps(by, scale), _mm_mul_ps(bz, scale) };
+        for (int k = 0; k < 9; k++)
+            _mm_storeu_ps(&out[k * count + i], values[k]);
+    }
+}
+
+// ============================================================================
+
+static const BenchKernel benchKernels[] =
+{
+    // fract(sin(x) * 43758.5) turns a 1 ulp difference between sin implementations
+    // into ~3e-3, and into ~1 where it crosses a wrap: the sin based kernels
+    // agree to 1e-2 except for a few elements, the integer hashes exactly
+    { "hash_sin", 1, 0.01f, 0.02f, true,
+        { { "scalar", scalarVariant<runHashFloat<hashSin>> }, { "auto", autoVariant<runHashFloat<hashSin>> }, { "sse2", sseHashFloat<hashSin4> } } },
+    { "hash_pcg2d", 1, 0.0f, 0.0f, true,
+        { { "scalar", scalarVariant<runHashInt<hashPcg>> }, { "auto", autoVariant<runHashInt<hashPcg>> }, { "sse2", sseHashInt<hashPcg4> } } },
+    { "hash_xxhash32", 1, 0.0f, 0.0f, true,
+        { { "scalar", scalarVariant<runHashInt<hashXx>> }, { "auto", autoVariant<runHashInt<hashXx>> }, { "sse2", sseHashInt<hashXx4> } } },
+    { "value_noise_quintic_sin", 1, 0.01f, 0.02f, false,
+        { { "scalar", scalarVariant<runNoise2D<valueNoise<true, false>>> }, { "auto", autoVariant<runNoise2D<valueNoise<true, false>>> }, { "sse2", sseNoise2D<valueNoise4<true, false>> } } },
+    { "value_noise_cubic_sin", 1, 0.01f, 0.02f, false,
+        { { "scalar", scalarVariant<runNoise2D<valueNoise<false, false>>> }, { "auto", autoVariant<runNoise2D<valueNoise<false, false>>> }, { "sse2", sseNoise2D<valueNoise4<false, false>> } } },
+    { "value_noise_quintic_pcg2d", 1, 1.0e-5f, 0.0f, false,
+        { { "scalar", scalarVariant<runNoise2D<valueNoise<true, true>>> }, { "auto", autoVariant<runNoise2D<valueNoise<true, true>>> }, { "sse2", sseNoise2D<valueNoise4<true, true>> } } },
+    { "perlin_fbm6_sin", 1, 0.01f, 0.02f, false,
+        { { "scalar", scalarVariant<runNoise2D<perlinFbm<false>>> }, { "auto", autoVariant<runNoise2D<perlinFbm<false>>> }, { "sse2", sseNoise2D<perlinFbm4<false>> } } },
+    { "perlin_fbm6_pcg2d", 1, 1.0e-5f, 0.0f, false,
+        { { "scalar", scalarVariant<runNoise2D<perlinFbm<true>>> }, { "auto", autoVariant<runNoise2D<perlinFbm<true>>> }, { "sse2", sseNoise2D<perlinFbm4<true>> } } },
+    { "worley_cells", 1, 0.02f, 0.02f, false,
+        { { "scalar", scalarVariant<runWorley> }, { "auto", autoVariant<runWorley> }, { "sse2", sseWorley } } },
+    { "camera_vectors", 9, 1.0e-5f, 0.0f, false,
+        { { "aos_glm", cameraAos }, { "soa_auto", cameraSoa }, { "sse2", sseCamera } } }
+};
+static const int BENCH_KERNEL_COUNT = sizeof(benchKernels) / sizeof(benchKernels[0]);
+
+// deterministic inputs, the same on every run
+static void fillInput(BenchInput& in)
+{
+    uint32_t state = 0x9E3779B9u;
+    auto next = [&state]() { state = state * 1664525u + 1013904223u; return (float)(state >> 8) * (1.0f / 16777216.0f); };
+    in.x.resize(BENCH_MAX_BATCH); in.y.resize(BENCH_MAX_BATCH);
+    in.cx.resize(BENCH_MAX_BATCH); in.cy.resize(BENCH_MAX_BATCH); in.cz.resize(BENCH_MAX_BATCH);
+    in.ix.resize(BENCH_MAX_BATCH); in.iy.resize(BENCH_MAX_BATCH);
+    in.yaw.resize(BENCH_MAX_BATCH); in.pitch.resize(BENCH_MAX_BATCH);
+    for (int i = 0; i < BENCH_MAX_BATCH; i++)
+    {
+        // terrain-sized world positions, cell space and lattice coordinates around it
+        in.x[i] = next() * 2000.0f - 1000.0f;
+        in.y[i] = next() * 2000.0f - 1000.0f;
+        in.cx[i] = next();
+        in.cy[i] = next();
+        in.cz[i] = next();
+        in.ix[i] = (int32_t)(next() * 1024.0f) - 512;
+        in.iy[i] = (int32_t)(next() * 1024.0f) - 512;
+        // CameraController clamps pitch to +-89
+        in.yaw[i] = next() * 720.0f - 360.0f;
+        in.pitch[i] = next() * 178.0f - 89.0f;
+    }
+}
+
+static double elapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// nanoseconds per element: min, median, mean, standard deviation
+static void measure(BenchFunction function, const BenchInput& in, float* out, int count, double stats[4], int& iterations)
+{
+    // warm caches and calibrate how many batches make up one sample
+    function(in, out, count);
+    iterations = 1;
+    for (;;)
+    {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++)
+            function(in, out, count);
+        if (elapsedNs(start) >= NOISE_BENCH_MIN_SAMPLE_MS * 1000000.0 || iterations >= (1 << 24))
+            break;
+        iterations *= 2;
+    }
+
+    double samples[NOISE_BENCH_SAMPLES];
+    float checksum = 0.0f;
+    for (int s = 0; s < NOISE_BENCH_SAMPLES; s++)
+    {
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < iterations; i++)
+            function(in, out, count);
+        samples[s] = elapsedNs(start) / ((double)iterations * count);
+        checksum += out[s % count];
+    }
+    benchSink = benchSink + checksum;
+
+    std::sort(samples, samples + NOISE_BENCH_SAMPLES);
+    double mean = 0.0;
+    for (int s = 0; s < NOISE_BENCH_SAMPLES; s++)
+        mean += samples[s];
+    mean /= NOISE_BENCH_SAMPLES;
+    double variance = 0.0;
+    for (int s = 0; s < NOISE_BENCH_SAMPLES; s++)
+        variance += (samples[s] - mean) * (samples[s] - mean);
+    stats[0] = samples[0];
+    stats[1] = samples[NOISE_BENCH_SAMPLES / 2];
+    stats[2] = mean;
+    stats[3] = sqrt(variance / (NOISE_BENCH_SAMPLES - 1));
+}
+
+// largest difference of a variant's full batch to the scalar reference,
+// and the fraction of values differing by more than the kernel's tolerance
+static float maxError(const BenchKernel& kernel, const std::vector<float>& reference, const std::vector<float>& result, float& outliers)
+{
+    float worst = 0.0f;
+    size_t beyond = 0;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        float difference = fabsf(reference[i] - result[i]);
+        if (kernel.periodic && difference > 0.5f)
+            difference = 1.0f - difference;
+        // NaN counts as the worst possible
+        if (!(difference <= kernel.tolerance))
+            beyond++;
+        if (!(difference <= worst))
+            worst = difference;
+    }
+    outliers = (float)beyond / reference.size();
+    return worst;
+}
+
+bool NoiseBench::run(const char* csvPath)
+{
+    BenchInput input;
+    fillInput(input);
+
+    FILE* csv = fopen(csvPath, "w");
+    if (!csv)
+    {
+        LOG_ERROR("Benchmark output %s cannot be written", csvPath);
+        return false;
+    }
+    fprintf(csv, "kernel,variant,batch,iterations,min_ns,median_ns,mean_ns,stddev_ns,max_error,outliers,agrees\n");
+
+    bool agreed = true;
+    std::vector<float> reference;
+    std::vector<float> result;
+    for (int k = 0; k < BENCH_KERNEL_COUNT; k++)
+    {
+        const BenchKernel& kernel = benchKernels[k];
+        size_t outputSize = (size_t)kernel.outputWidth * BENCH_MAX_BATCH;
+        reference.assign(outputSize, 0.0f);
+        kernel.variants[0].function(input, reference.data(), BENCH_MAX_BATCH);
+
+        for (int v = 0; v < 3; v++)
+        {
+            const BenchVariant& variant = kernel.variants[v];
+            result.assign(outputSize, 0.0f);
+            variant.function(input, result.data(), BENCH_MAX_BATCH);
+            float outliers = 0.0f;
+            float error = maxError(kernel, reference, result, outliers);
+            bool agrees = outliers <= kernel.outliers;
+            if (!agrees)
+            {
+                LOG_ERROR("%s/%s differs from %s by up to %g, %.3f%% past %g", kernel.name, variant.name, kernel.variants[0].name, error, outliers * 100.0f, kernel.tolerance);
+                agreed = false;
+            }
+
+            for (int b = 0; b < BENCH_BATCH_COUNT; b++)
+            {
+                int count = benchBatchSizes[b];
+                double stats[4];
+                int iterations = 0;
+                measure(variant.function, input, result.data(), count, stats, iterations);
+                LOG_INFO("%-26s %-8s %6d: median %8.3f ns  min %8.3f  mean %8.3f  sd %7.3f  (%.1f M/s)",
+                    kernel.name, variant.name, count, stats[1], stats[0], stats[2], stats[3], 1000.0 / stats[1]);
+                fprintf(csv, "%s,%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%g,%g,%d\n",
+                    kernel.name, variant.name, count, iterations, stats[0], stats[1], stats[2], stats[3], error, outliers, agrees ? 1 : 0);
+            }
+        }
+    }
+
+    fclose(csv);
+    LOG_INFO("Benchmark results written to %s%s", csvPath, agreed ? "" : ", some variants disagree");
+    return agreed;
+}
@@ -0,0 +1,21 @@
+#ifndef NOISEBENCH_H
+#define NOISEBENCH_H
+
+// Microbenchmarks for the noise and camera math the renderer runs per
+// pixel/vertex, ported to C++: the sin based Random2D hash against
+// integer hashes (PCG2D, xxHash32), InterpolatedNoise with quintic and
+// cubic fades, terrain.tes' multi-octave perlin, worley.comp's cell search
+// and Camera::updateCameraVectors (AoS glm against SoA). Every kernel runs
+// as a scalar loop, the same loop left to the compiler's auto-vectorizer
+// and an explicit SSE2 version, over several batch sizes; each is timed
+// in repeated samples (min/median/mean/stddev per element) and checked
+// against the scalar result. Runs from "OGL.exe -bench[=<csv>]", results
+// go to the log and to a CSV file.
+class NoiseBench
+{
+public:
+    // false when a variant disagrees with its scalar reference
+    static bool run(const char* csvPath);
+};
+
+#endif // NOISEBENCH_H
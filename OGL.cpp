@@ -2,6 +2,7 @@
 #include <windowsx.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fstream>
 #include <sstream>
 #include <vector>
@@ -18,38 +19,257 @@
 #include "Logger.h"
 #include "Timer.h"
 #include "camera.h"
+#include "Input.h"
+#include "CameraController.h"
 #include "Shader.h"
+#include "InstancedMesh.h"
+#include "GpuDrivenRenderer.h"
+#include "PostProcess.h"
+#include "Vegetation.h"
+#include "HiZPyramid.h"
+#include "CloudNoise.h"
+#include "DynamicResolution.h"
+#include "TemporalUpsampler.h"
+#include "StreamBuffer.h"
+#include "GLState.h"
+#include "TextureStreamer.h"
+#include "TextureCooker.h"
+#include "MeshCooker.h"
+#include "StaticMesh.h"
+#include "FontCooker.h"
+#include "ShaderCooker.h"
+#include "TextRenderer.h"
+#include "Profiler.h"
+#include "PerfHud.h"
+#include "GpuMemory.h"
+#include "Memory.h"
+#include "JobSystem.h"
+#include "RenderThread.h"
+#include "StartupGraph.h"
+#include "FrameCapture.h"
+#include "GoldenTest.h"
+#include "NoiseBench.h"
+#include "FrustumTest.h"
 
 
 
 //*** Globle Function Declarations ***
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+bool CookMeshIfStale(const char* source, const char* cooked);
+StaticMesh* LoadCookedMesh(const char* source, const char* cooked);
+void AddStartupPhases(StartupGraph& graph);
+bool InitSceneShaders(void);
+bool InitGLState(void);
+bool InitCubes(void);
+bool InitTextureStreamer(void);
+bool InitText(void);
+bool InitRenderTargets(void);
+bool InitVegetation(void);
+bool InitCloudNoise(void);
+bool InitHud(void);
+bool InitSceneMesh(void);
+bool RenderInit(void);
+void RenderFrame(const FramePacket& packet);
+void RenderShutdown(void);
+void StopRendering(void);
+void RecordFrame(FramePacket& packet, float currentFrame);
+void RecordOpaque(RenderCommandList& commands);
+bool RecordGoldenFrame(FramePacket& packet);
 
 
 //*** Global Variable Declaration ***
 WindowManager* pWindow = NULL;
 Camera* camera = NULL;
-float lastX = WindowManager::SCR_WIDTH / 2.0f;
-float lastY = WindowManager::SCR_HEIGHT / 2.0f;
-bool firstMouse = true;
+CameraController* cameraController = NULL;
+// 'F' switches from the orbiting demo view to free flight:
+// WASD/QE to move, shift to speed up, right mouse button to look
+bool bFreeCamera = false;
 // timing
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
 
-GLuint vaoCube = 0;
-GLuint vbo_position_cube = 0;
-GLuint vbo_color_cube = 0;
-GLuint mvpMatrixUniform = 0;
-glm::mat4 perspectiveProjectionMatrix;
+// owns the GL context; everything GL below is created and used on that thread only,
+// besides the scene shaders the startup loader builds on a shared context
+RenderThread* renderThread = NULL;
+// startup phases, from WinMain until the first frame reports the timeline
+StartupGraph* startup = NULL;
+Shader* cubeShader = NULL;
+Shader* gpuDrivenShader = NULL;
+Shader* meshShader = NULL;
+// the same vertex shaders with depth_only.fs, for the depth prepass
+Shader* cubeDepthShader = NULL;
+Shader* gpuDrivenDepthShader = NULL;
+Shader* meshDepthShader = NULL;
+GLint uniformAlignment = 256;
+
+InstancedMesh* cubeMesh = NULL;
+GpuDrivenRenderer* gpuScene = NULL;
+uint32_t cubeMeshId = 0;
+StreamBuffer* frameStream = NULL;
+TextureStreamer* textureStreamer = NULL;
+
+
+// terrain materials, block-compressed offline into texture arrays by "-cook"; albedo
+// layers follow terrain.frag's sand, grass1, grass, rock, snow samplers (there is no
+// grass1 image, grass2.jpg stands in). Nothing loads them yet: terrain.frag keeps its
+// sampler2Ds until a terrain pass draws it and binds these arrays, with CookedTexture.
+// Albedo stays UNORM, terrain.frag was tuned against the raw JPG values
+const TextureRecipe textureRecipes[] = {
+	{ "resources/terrain_albedo.ctex", BLOCK_BC7, false,
+		{ "resources/sand.jpg", "resources/grass2.jpg", "resources/grass.jpg", "resources/rock.jpg", "resources/snow.jpg" } },
+	{ "resources/terrain_normal.ctex", BLOCK_BC5, false,
+		{ "resources/rnormal.jpg" } },
+};
+const int TEXTURE_RECIPE_COUNT = sizeof(textureRecipes) / sizeof(textureRecipes[0]);
+
+// imported model, cooked from the OBJ on first run; skipped if neither file is present
+const char* SCENE_MESH_SOURCE = "resources/model.obj";
+const char* SCENE_MESH_COOKED = "resources/model.cmesh";
+StaticMesh* sceneMesh = NULL;
+glm::mat4 sceneMeshModel = glm::mat4(1.0f);
+glm::vec3 sceneMeshCenter = glm::vec3(0.0f);	// world bounds, the simulation skips the draw when outside the frustum
+glm::vec3 sceneMeshExtent = glm::vec3(0.0f);
+
+// overlay font, a distance field atlas so one cook serves every text size
+const FontRecipe fontRecipe = { "resources/calibri.cfnt", "resources/calibri.ttf", "Calibri", 32, true, 4 };
+// every stage the renderer builds a program from, cooked to SPIR-V ahead of the
+// programs; the other files in shaders/ belong to passes that are not drawn yet
+const char* const shaderSources[] = {
+	"shaders/camera_instanced.vs", "shaders/gpu_driven.vs", "shaders/mesh.vs", "shaders/grass.vs",
+	"shaders/camera.fs", "shaders/depth_only.fs", "shaders/textShader.vert", "shaders/textShader.frag",
+	"shaders/cull.comp", "shaders/vegetation_scatter.comp", "shaders/hiz_downsample.comp",
+	"shaders/perlinworley.comp", "shaders/worley.comp", "shaders/weather.comp",
+	"shaders/post_process.comp", "shaders/luminance_histogram.comp", "shaders/auto_exposure.comp",
+	"shaders/temporal_upsample.comp",
+};
+const int SHADER_SOURCE_COUNT = sizeof(shaderSources) / sizeof(shaderSources[0]);
+TextRenderer* textRenderer = NULL;
+// 'H' shows/hides the performance overlay
+PerfHud* perfHud = NULL;
+// render thread copies of the toggles for the HUD, taken from each frame's overlay command
+bool bHudStressScene = false;
+bool bHudGpuDriven = false;
+bool bHudCpuCulling = false;
+bool bHudVegetation = false;
+bool bHudDepthPrepass = false;
+bool bHudDynamicResolution = false;
+// scene target and the fused post pass that resolves it to the window
+PostProcess* postProcess = NULL;
+// 'V' grows GPU scattered grass on the terrain below the demo scene
+Vegetation* vegetation = NULL;
+bool bVegetation = false;
+// the terrain shaders' parameters; the terrain mesh itself is not drawn yet
+const RenderVegetationCommand vegetationTerrain = { glm::vec4(0.0f), -3.0f, 2.0f, 20.0f, 6, 1.0f, 0.7f, -2.7f };
+// 'Z' draws the opaque geometry depth-only first, then shades it with an equal depth test
+bool bDepthPrepass = false;
+// min/max depth pyramid of the opaque geometry for the ray marching passes' early
+// outs, only built while one of them needs it: none does while water and clouds
+// are not drawn
+HiZPyramid* hiZ = NULL;
+bool bHiZPyramid = false;
+// cloud noise volumes and weather map, generated a slice at a time within a per-frame
+// GPU budget; 'N' starts a new weather map that fades in over the current one
+CloudNoise* cloudNoise = NULL;
+const float WEATHER_BUDGET_MS = 0.5f;
+bool bNewWeather = false;
+// 'R' renders the scene at a scale picked from the GPU frame time to hold the display's
+// refresh rate, jittered and temporally upsampled back to the output resolution
+DynamicResolution* dynamicResolution = NULL;
+TemporalUpsampler* temporalUpsampler = NULL;
+bool bDynamicResolution = false;
+// HDR scene: GPU auto exposure, ACES and gamma, plus the vignette post_processing.frag had
+const RenderPostCommand postSettings = { 1.0f, 2.2f, 0.11f, true, true, 1.5f, false };
+// snap auto exposure instead of easing, set for the first frame and golden scenarios
+bool bResetExposure = true;
+// F12 saves a screenshot to captures/, F11 starts/stops a Y4M recording there;
+// "-record=<path>" records from the first frame (.y4m video, anything else a PNG sequence prefix)
+FrameCapture* frameCapture = NULL;
+std::vector<RenderCaptureCommand> pendingCaptures;
+bool bRecording = false;
+const int CAPTURE_FRAMES_PER_SECOND = 60;
+// "-golden" renders the scenarios below offscreen with the window hidden, compares
+// them against golden/<name>.png and exits non-zero on a mismatch; "-golden=update"
+// rewrites the images. Camera, time and toggles are fixed so frames are repeatable.
+struct GoldenScenario
+{
+	const char* name;
+	bool stressScene;
+	bool gpuDriven;
+	bool cpuCulling;
+	bool vegetation;
+	bool depthPrepass;
+	float orbitAngle;	// anglePiramid of the orbit camera
+};
+const GoldenScenario goldenScenarios[] = {
+	{ "cubes",                  false, false, false, false, false,   0.0f },
+	{ "cubes_orbit",            false, false, false, false, false,  40.0f },
+	{ "cubes_gpu_driven",       false, true,  false, false, false,   0.0f },
+	{ "cubes_cpu_culled",       false, true,  true,  false, false,   0.0f },
+	{ "stress_grid",            true,  false, false, false, false,  10.0f },
+	{ "stress_grid_gpu_driven", true,  true,  false, false, false,  10.0f },
+	{ "vegetation",             false, false, false, true,  false,  20.0f },
+	{ "depth_prepass",          false, true,  false, true,  true,   20.0f }
+};
+const int GOLDEN_SCENARIO_COUNT = sizeof(goldenScenarios) / sizeof(goldenScenarios[0]);
+const int GOLDEN_WARMUP_FRAMES = 8;	// scene rebuild, texture streaming and profiler latency settle
+const int GOLDEN_TIMED_FRAMES = 16;
+const int GOLDEN_WIDTH = 960;
+const int GOLDEN_HEIGHT = 540;
+const float GOLDEN_TIME = 10.0f;
+GoldenTest* goldenTest = NULL;
+int goldenFrame = 0;
+// "-vram=<MB>" caps tracked GPU memory, 0 leaves it unbounded; 'M' dumps the report
+// of GPU and heap memory. "-allocguard" logs heap allocations made inside a frame
+uint64_t gpuMemoryBudget = 0;
+
+// std140 mirror of the FrameData uniform block in the shaders
+#define FRAME_UNIFORMS_BINDING 0
+struct FrameUniforms
+{
+	glm::mat4 viewProjection;
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 cameraPosition;
+	glm::vec4 time;
+	glm::mat4 inverseView;
+	glm::mat4 inverseProjection;
+};
 GLfloat anglePiramid = 0.0f;
 
+// 'T' swaps the 10 demo cubes for a 100k cube stress grid
+bool bStressScene = false;
+bool bSceneDirty = true;
+const int STRESS_GRID_SIZE = 47; // 47^3 = 103823 cubes
+// 'G' submits through the GPU culled multi-draw path, 'C' culls it on the CPU instead
+bool bGpuDriven = false;
+bool bCpuCulling = false;
+// 'H', 'M' and 'P' requests, recorded into the next frame packet
+uint32_t pendingDebugActions = 0;
+// client area from WM_SIZE, minimized sizes are ignored
+int viewportWidth = WindowManager::SCR_WIDTH;
+int viewportHeight = WindowManager::SCR_HEIGHT;
+
+// world space positions of our cubes
+const glm::vec3 cubePositions[] = {
+	glm::vec3(0.0f,  0.0f,  0.0f),
+	glm::vec3(2.0f,  5.0f, -15.0f),
+	glm::vec3(-1.5f, -2.2f, -2.5f),
+	glm::vec3(-3.8f, -2.0f, -12.3f),
+	glm::vec3(2.4f, -0.4f, -3.5f),
+	glm::vec3(-1.7f,  3.0f, -7.5f),
+	glm::vec3(1.3f, -2.0f, -2.5f),
+	glm::vec3(1.5f,  2.0f, -2.5f),
+	glm::vec3(1.5f,  0.2f, -1.5f),
+	glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+
 
 
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpszCmdLine, int iCmdShow)
 {
-    BOOL LoadGLTexture(GLuint * texture, GLsizei width, GLsizei height, void* data);
 	pWindow = new WindowManager();
 	MSG msg = { 0 };
 	camera = new Camera();
@@ -58,16 +278,434 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpszCmdLi
 
 	Logger::Init();
 
-	TIMER_INIT("Window");
-	pWindow->initialize();
-	TIMER_END(); 
-	LOG_INFO("Window Initialized in %.6f seconds", TIMER_GET("Window"));
+	// "OGL.exe -cook" rebuilds every cooked asset and exits without opening a window
+	if (strstr(lpszCmdLine, "-cook") != NULL)
+	{
+		bool cooked = true;
+		for (int i = 0; i < TEXTURE_RECIPE_COUNT; i++)
+			cooked = TextureCooker::cook(textureRecipes[i]) && cooked;
+		uint64_t sourceTime = 0;
+		if (MappedFile::LastWriteTime(SCENE_MESH_SOURCE, sourceTime))
+			cooked = MeshCooker::cook(SCENE_MESH_SOURCE, SCENE_MESH_COOKED) && cooked;
+		cooked = FontCooker::cook(fontRecipe) && cooked;
+		cooked = ShaderCooker::cookAll(shaderSources, SHADER_SOURCE_COUNT) && cooked;
+		delete camera;
+		delete pWindow;
+		return cooked ? 0 : 1;
+	}
+
+	// "OGL.exe -bench[=<csv>]" times the CPU ports of the noise and camera math and exits,
+	// non-zero when a variant disagrees with its scalar reference
+	const char* benchArgument = strstr(lpszCmdLine, "-bench");
+	if (benchArgument != NULL)
+	{
+		char benchPath[MAX_PATH] = "noise_bench.csv";
+		if (benchArgument[6] == '=')
+		{
+			size_t length = strcspn(benchArgument + 7, " \t");
+			if (length >= sizeof(benchPath))
+				length = sizeof(benchPath) - 1;
+			memcpy(benchPath, benchArgument + 7, length);
+			benchPath[length] = '\0';
+		}
+		bool agreed = NoiseBench::run(benchPath);
+		delete camera;
+		delete pWindow;
+		return agreed ? 0 : 1;
+	}
+
+	// "OGL.exe -selftest" runs the checks that need no window or GL context and exits,
+	// non-zero when one fails
+	if (strstr(lpszCmdLine, "-selftest") != NULL)
+	{
+		bool passed = FrustumTest::run();
+		delete camera;
+		delete pWindow;
+		return passed ? 0 : 1;
+	}
+
+	const char* vramArgument = strstr(lpszCmdLine, "-vram=");
+	if (vramArgument != NULL)
+		gpuMemoryBudget = (uint64_t)atoi(vramArgument + 6) * 1024 * 1024;
+
+	if (strstr(lpszCmdLine, "-allocguard") != NULL)
+		Memory::SetGuard(true);
+
+	const char* recordArgument = strstr(lpszCmdLine, "-record=");
+	if (recordArgument != NULL)
+	{
+		RenderCaptureCommand record = {};
+		record.action = RENDER_CAPTURE_START;
+		record.framesPerSecond = CAPTURE_FRAMES_PER_SECOND;
+		size_t length = strcspn(recordArgument + 8, " \t");
+		if (length >= sizeof(record.path))
+			length = sizeof(record.path) - 1;
+		memcpy(record.path, recordArgument + 8, length);
+		record.video = length > 4 && _stricmp(record.path + length - 4, ".y4m") == 0;
+		pendingCaptures.push_back(record);
+		bRecording = true;
+	}
+	CreateDirectoryA("captures", NULL);
+
+	const char* goldenArgument = strstr(lpszCmdLine, "-golden");
+	if (goldenArgument != NULL)
+		goldenTest = new GoldenTest("golden", strncmp(goldenArgument, "-golden=update", 14) == 0);
+
+	// every core but this one; the main thread helps while it waits on jobs
+	JobSystem::Init();
+
+	// cooks and asset reads start on the workers now and overlap the window and context
+	startup = new StartupGraph();
+	AddStartupPhases(*startup);
+	startup->start();
+	bool windowCreated = startup->runLane(STARTUP_LANE_MAIN);
+	cameraController = new CameraController(*camera);
+	if (!windowCreated)
+	{
+		pWindow->releaseLoaderContext();
+		startup->wait();
+		startup->report(TIMER_NOW());
+		pWindow->isRunning = TRUE;
+	}
+	else
+	{
+		if (goldenTest)
+			ShowWindow(pWindow->windowHandle, SW_HIDE);
+		Input::Register(pWindow->windowHandle);
+
+		// from here on WinMain only pumps messages and simulates, the GL context
+		// moves to the render thread which runs the GL phases in RenderInit
+		renderThread = new RenderThread();
+		if (!renderThread->start(pWindow->deviceContext, pWindow->renderingContext, RenderInit, RenderFrame, RenderShutdown))
+		{
+			pWindow->releaseLoaderContext();
+			startup->report(TIMER_NOW());
+			pWindow->isRunning = TRUE;
+		}
+	}
+
+	cameraController->setProjection(45.0f, (float)WindowManager::SCR_WIDTH / (float)WindowManager::SCR_HEIGHT, 0.1f, 100.0f);
+
+
+
+
+	//*** Game LOOP ***
+	while (pWindow->isRunning == FALSE)
+	{
+		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		{
+			if (msg.message == WM_QUIT)
+				pWindow->isRunning = TRUE;
+			else
+			{
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		}
+		// nothing to submit to once WM_CLOSE stopped rendering, WM_QUIT follows
+		else if (renderThread != NULL)
+		{
+			// per-frame time logic
+			// --------------------
+			float currentFrame = static_cast<float>(Timer::getAppRunTime());
+			deltaTime = currentFrame - lastFrame;
+			lastFrame = currentFrame;
+
+			// waits only while the render thread still holds both packets,
+			// i.e. simulation runs at most one frame ahead of submission
+			Memory::BeginFrame(MEMORY_LOOP_SIMULATION);
+			FramePacket* packet = renderThread->beginPacket();
+			if (!goldenTest)
+				RecordFrame(*packet, currentFrame);
+			else if (!RecordGoldenFrame(*packet))
+				pWindow->isRunning = TRUE;
+			renderThread->submitPacket(packet);
+			Input::EndFrame();
+			Memory::EndFrame(MEMORY_LOOP_SIMULATION);
+
+			///================== UPDATE =======================//
+			anglePiramid = anglePiramid + 0.01f;
+			
+		}
+	}
+	
+
+	StopRendering();
+	// still here when startup failed or no frame was rendered
+	delete startup;
+	startup = NULL;
+	JobSystem::Shutdown();
+	delete cameraController;
+	cameraController = NULL;
+	delete camera;
+	camera = NULL;
+
+	if (goldenTest)
+	{
+		goldenTest->report();
+		int failures = goldenTest->getFailures();
+		delete goldenTest;
+		goldenTest = NULL;
+		return failures > 0 ? 1 : 0;
+	}
+	return((int)msg.wParam);
+}
+
+
+// simulation side of a frame: everything that changed since the last one
+// becomes a command for the render thread
+void RecordFrame(FramePacket& packet, float currentFrame)
+{
+	RenderCommandList& commands = packet.commands;
+
+	// instance matrices are static, rebuild only when the scene changes
+	if (bSceneDirty)
+	{
+		uint32_t firstMatrix = 0;
+		uint32_t count = bStressScene ? STRESS_GRID_SIZE * STRESS_GRID_SIZE * STRESS_GRID_SIZE : 10;
+		glm::mat4* models = commands.allocateMatrices(count, firstMatrix);
+		if (bStressScene)
+		{
+			// one job per x slab of the grid
+			float half = (STRESS_GRID_SIZE - 1) * 0.5f;
+			JobSystem::ParallelFor(STRESS_GRID_SIZE, 1, [&](int begin, int end)
+			{
+				for (int x = begin; x < end; x++)
+					for (int y = 0; y < STRESS_GRID_SIZE; y++)
+						for (int z = 0; z < STRESS_GRID_SIZE; z++)
+						{
+							size_t index = ((size_t)x * STRESS_GRID_SIZE + y) * STRESS_GRID_SIZE + z;
+							glm::vec3 position = glm::vec3(x - half, y - half, z - half) * 3.0f;
+							glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+							modelMatrix = glm::rotate(modelMatrix, glm::radians(20.0f * (float)(index % 18)), glm::vec3(1.0f, 0.3f, 0.5f));
+							models[index] = modelMatrix;
+						}
+			});
+			cameraController->setProjection(45.0f, (float)WindowManager::SCR_WIDTH / (float)WindowManager::SCR_HEIGHT, 0.1f, 500.0f);
+		}
+		else
+		{
+			for (unsigned int i = 0; i < 10; i++)
+			{
+				glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), cubePositions[i]);
+				float angle = 20.0f * i;
+				modelMatrix = glm::rotate(modelMatrix, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+				models[i] = modelMatrix;
+			}
+			cameraController->setProjection(45.0f, (float)WindowManager::SCR_WIDTH / (float)WindowManager::SCR_HEIGHT, 0.1f, 100.0f);
+		}
+
+		RenderInstancesCommand instances = { firstMatrix, count };
+		commands.push(RENDER_COMMAND_SET_INSTANCES, instances);
+		bSceneDirty = false;
+	}
+
+	// camera/view transformation, free flight picks up wherever the orbit left it
+	if (bFreeCamera)
+	{
+		cameraController->update(deltaTime);
+	}
+	else
+	{
+		float radius = bStressScene ? 160.0f : 10.0f;
+		float camX = static_cast<float>(sin(anglePiramid*0.05f) * radius);
+		float camZ = static_cast<float>(cos(anglePiramid*0.05f) * radius);
+		cameraController->lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f));
+	}
+
+	RenderViewCommand view;
+	view.view = cameraController->getView();
+	view.projection = cameraController->getProjection();
+	view.viewProjection = cameraController->getViewProjection();
+	view.inverseView = cameraController->getInverseView();
+	view.inverseProjection = cameraController->getInverseProjection();
+	view.cameraPosition = glm::vec4(cameraController->getPosition(), 1.0f);
+	view.time = currentFrame;
+	view.deltaTime = deltaTime;
+	view.viewportWidth = viewportWidth;
+	view.viewportHeight = viewportHeight;
+	view.dynamicResolution = bDynamicResolution;
+	commands.push(RENDER_COMMAND_BEGIN_VIEW, view);
+
+	RenderWeatherCommand weather = {};
+	weather.budgetMs = WEATHER_BUDGET_MS;
+	if (bNewWeather)
+	{
+		weather.seed = glm::vec4((float)(rand() % 1000), (float)(rand() % 1000), (float)(rand() % 1000), 0.0f);
+		weather.regenerate = true;
+		bNewWeather = false;
+	}
+	commands.push(RENDER_COMMAND_UPDATE_WEATHER, weather);
+
+	// opaque geometry, twice with the prepass: depth only, then shaded against that depth
+	if (bDepthPrepass)
+	{
+		RenderDepthPassCommand prepass = { RENDER_DEPTH_PREPASS };
+		commands.push(RENDER_COMMAND_DEPTH_PASS, prepass);
+		RecordOpaque(commands);
+		RenderDepthPassCommand shading = { RENDER_DEPTH_SHADING };
+		commands.push(RENDER_COMMAND_DEPTH_PASS, shading);
+	}
+	RecordOpaque(commands);
+	RenderDepthPassCommand opaqueDone = { bHiZPyramid ? RENDER_DEPTH_PYRAMID : RENDER_DEPTH_OPAQUE_DONE };
+	commands.push(RENDER_COMMAND_DEPTH_PASS, opaqueDone);
+
+	RenderPostCommand post = postSettings;
+	post.resetAdaptation = bResetExposure;
+	commands.push(RENDER_COMMAND_POST_PROCESS, post);
+	bResetExposure = false;
+
+	// the HUD's numbers change every frame, golden images leave it out
+	if (!goldenTest)
+	{
+		RenderOverlayCommand overlay = { bStressScene, bGpuDriven, bCpuCulling, bVegetation, bDepthPrepass, bDynamicResolution };
+		commands.push(RENDER_COMMAND_DRAW_OVERLAY, overlay);
+	}
+
+	if (pendingDebugActions != 0)
+	{
+		RenderDebugCommand debug = { pendingDebugActions };
+		commands.push(RENDER_COMMAND_DEBUG, debug);
+		pendingDebugActions = 0;
+	}
+
+	for (size_t i = 0; i < pendingCaptures.size(); i++)
+		commands.push(RENDER_COMMAND_CAPTURE, pendingCaptures[i]);
+	pendingCaptures.clear();
+}
+
+
+// cubes, scene mesh and grass; recorded once per depth pass
+void RecordOpaque(RenderCommandList& commands)
+{
+	RenderCubesCommand cubes = { bGpuDriven, bCpuCulling };
+	commands.push(RENDER_COMMAND_DRAW_CUBES, cubes);
+
+	// sceneMesh is only written before RenderInit returns
+	if (sceneMesh && !bStressScene && cameraController->getFrustum().intersectsAabb(sceneMeshCenter, sceneMeshExtent))
+	{
+		RenderMeshCommand mesh = { sceneMeshModel };
+		commands.push(RENDER_COMMAND_DRAW_MESH, mesh);
+	}
+
+	if (bVegetation)
+		commands.push(RENDER_COMMAND_DRAW_VEGETATION, vegetationTerrain);
+}
+
 
+// one frame of the current golden scenario, false once every scenario ran
+bool RecordGoldenFrame(FramePacket& packet)
+{
+	int scenarioIndex = goldenFrame / (GOLDEN_WARMUP_FRAMES + GOLDEN_TIMED_FRAMES);
+	int frame = goldenFrame % (GOLDEN_WARMUP_FRAMES + GOLDEN_TIMED_FRAMES);
+	if (scenarioIndex >= GOLDEN_SCENARIO_COUNT)
+		return false;
+	goldenFrame++;
+
+	const GoldenScenario& scenario = goldenScenarios[scenarioIndex];
+	if (scenario.stressScene != bStressScene)
+		bSceneDirty = true;
+	bStressScene = scenario.stressScene;
+	bGpuDriven = scenario.gpuDriven;
+	bCpuCulling = scenario.cpuCulling;
+	bVegetation = scenario.vegetation;
+	bDepthPrepass = scenario.depthPrepass;
+	// the render scale follows GPU timings, golden images stay at full resolution
+	bDynamicResolution = false;
+	bFreeCamera = false;
+	anglePiramid = scenario.orbitAngle;
+	// every scenario starts from its own converged exposure, not the previous one's
+	bResetExposure = frame == 0;
+	deltaTime = 1.0f / 60.0f;
+	viewportWidth = GOLDEN_WIDTH;
+	viewportHeight = GOLDEN_HEIGHT;
+
+	RenderGoldenCommand golden = {};
+	golden.begin = true;
+	golden.width = GOLDEN_WIDTH;
+	golden.height = GOLDEN_HEIGHT;
+	sprintf_s(golden.name, "%s", scenario.name);
+	packet.commands.push(RENDER_COMMAND_GOLDEN, golden);
+
+	RecordFrame(packet, GOLDEN_TIME);
+
+	golden.begin = false;
+	golden.timed = frame >= GOLDEN_WARMUP_FRAMES;
+	golden.compare = frame == GOLDEN_WARMUP_FRAMES + GOLDEN_TIMED_FRAMES - 1;
+	packet.commands.push(RENDER_COMMAND_GOLDEN, golden);
+	return true;
+}
 
 
-	///======================== OpenGL ==============================///
-	Shader ourShader("shaders/camera.vs", "shaders/camera.fs");
+///======================== OpenGL ==============================///
+// render thread, with the context current: its lane of the startup graph,
+// then whatever the loader and job workers still have going
+bool RenderInit(void)
+{
+	startup->startLoader(pWindow->deviceContext, pWindow->loaderContext);
+	pWindow->loaderContext = NULL;
+	bool initialized = startup->runLane(STARTUP_LANE_GL);
+	return startup->wait() && initialized;
+}
+
+// Startup phases and what each needs: the window and context here on the main
+// thread, cooking and reading assets on job workers meanwhile, GL objects on the
+// render thread and the scene programs on the loader context next to them.
+// A failed cook leaves that asset out, as it always did, and fails nothing.
+void AddStartupPhases(StartupGraph& graph)
+{
+	int cookMesh = graph.add("cook mesh", STARTUP_LANE_CPU, [] { CookMeshIfStale(SCENE_MESH_SOURCE, SCENE_MESH_COOKED); return true; });
+	int cookFont = graph.add("cook font", STARTUP_LANE_CPU, [] { if (FontCooker::needsCook(fontRecipe)) FontCooker::cook(fontRecipe); return true; });
+	// stale SPIR-V modules; Shader never cooks, a module still stale after this loads from source
+	int cookShaders = graph.add("cook shaders", STARTUP_LANE_CPU, [] { ShaderCooker::cookAll(shaderSources, SHADER_SOURCE_COUNT); return true; });
+
+	int window = graph.add("window", STARTUP_LANE_MAIN, [] { return pWindow->initializeWin32(); });
+	int context = graph.add("context", STARTUP_LANE_MAIN, [] { return pWindow->initializeOpenGL(); }, { window });
+
+	graph.add("scene shaders", STARTUP_LANE_LOADER, InitSceneShaders, { context, cookShaders });
+	int glState = graph.add("gl state", STARTUP_LANE_GL, InitGLState, { context });
+	graph.add("texture streamer", STARTUP_LANE_GL, InitTextureStreamer, { glState });
+	graph.add("scene mesh", STARTUP_LANE_GL, InitSceneMesh, { glState, cookMesh });
+	graph.add("cubes", STARTUP_LANE_GL, InitCubes, { glState, cookShaders });
+	graph.add("text", STARTUP_LANE_GL, InitText, { glState, cookShaders, cookFont });
+	graph.add("render targets", STARTUP_LANE_GL, InitRenderTargets, { glState, cookShaders });
+	graph.add("vegetation", STARTUP_LANE_GL, InitVegetation, { glState, cookShaders });
+	// setup only, the volumes themselves are generated a slice per frame
+	graph.add("cloud noise", STARTUP_LANE_GL, InitCloudNoise, { glState, cookShaders });
+	graph.add("hud", STARTUP_LANE_GL, InitHud, { glState, cookShaders });
+}
 
+// loader context: programs are shared with the render thread's context
+bool InitSceneShaders(void)
+{
+	cubeShader = new Shader("shaders/camera_instanced.vs", "shaders/camera.fs");
+	gpuDrivenShader = new Shader("shaders/gpu_driven.vs", "shaders/camera.fs");
+	meshShader = new Shader("shaders/mesh.vs", "shaders/camera.fs");
+	cubeDepthShader = new Shader("shaders/camera_instanced.vs", "shaders/depth_only.fs");
+	gpuDrivenDepthShader = new Shader("shaders/gpu_driven.vs", "shaders/depth_only.fs");
+	meshDepthShader = new Shader("shaders/mesh.vs", "shaders/depth_only.fs");
+	return true;
+}
+
+bool InitGLState(void)
+{
+	Profiler::Init();
+	GpuMemory::SetBudget(gpuMemoryBudget);
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+
+	//07 - 2nd step Enabling Depth
+	GLState::Enable(GL_DEPTH_TEST);
+	GLState::DepthFunc(GL_LEQUAL);
+	glClearDepth(1.0f);
+
+
+	//08 - Set the Clear Color of Window To Blue
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	return true;
+}
+
+bool InitCubes(void)
+{
 	//Declare Position And Color Arrays
 	///CUBE
 	const GLfloat cube_position[] =
@@ -144,139 +782,510 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpszCmdLi
 
 	};
 
+	// two triangles per face, following the old per-face fan order
+	const GLushort cube_indices[] =
+	{
+		0, 1, 2, 0, 2, 3,
+		4, 5, 6, 4, 6, 7,
+		8, 9, 10, 8, 10, 11,
+		12, 13, 14, 12, 14, 15,
+		16, 17, 18, 16, 18, 19,
+		20, 21, 22, 20, 22, 23
+	};
+
 	/// CUBE 
-	//VAO
-	glGenVertexArrays(1, &vaoCube);
-	glBindVertexArray(vaoCube);
+	{
+		GPU_MEMORY_OWNER("cubes");
+		cubeMesh = new InstancedMesh(cube_position, cube_color, 24, cube_indices, 36);
+	}
 
-	//VBO for Position 
-	glGenBuffers(1, &vbo_position_cube);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_position_cube);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_position), cube_position, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
+	GLuint cube_indices_32[36];
+	for (int i = 0; i < 36; i++)
+		cube_indices_32[i] = cube_indices[i];
+	// 4 MB per frame in flight covers the frame uniforms plus CPU-culled draw data for the stress grid
+	{
+		GPU_MEMORY_OWNER("frame stream");
+		frameStream = new StreamBuffer(4 * 1024 * 1024);
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	{
+		GPU_MEMORY_OWNER("gpu scene");
+		gpuScene = new GpuDrivenRenderer();
+		cubeMeshId = gpuScene->addMesh(cube_position, cube_color, 24, cube_indices_32, 36, glm::vec3(-0.5f), glm::vec3(0.5f));
+	}
+	return true;
+}
 
-	//VBO For Color
-	glGenBuffers(1, &vbo_color_cube);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_color_cube);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_color), cube_color, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
+bool InitTextureStreamer(void)
+{
+	// a pass loads its textures here once it is drawn; they stream in over the first
+	// frames with placeholders bound until then. Nothing drawn samples a file texture
+	// yet (the water maps wait for the water pass), so nothing is loaded
+	textureStreamer = new TextureStreamer();
+	// first to give back memory when over budget, streamed textures drop a mip each
+	GpuMemory::AddEvictCallback("texture streamer", 0, [](uint64_t bytes) { return textureStreamer->trim(bytes); });
+	return true;
+}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+bool InitText(void)
+{
+	GPU_MEMORY_OWNER("text");
+	textRenderer = new TextRenderer();
+	if (!FontCooker::needsCook(fontRecipe))
+		textRenderer->load(fontRecipe.output.c_str());
+	return true;
+}
 
-	//-------------------------------------------------------------------------------------//
+bool InitRenderTargets(void)
+{
+	frameCapture = new FrameCapture();
+	{
+		GPU_MEMORY_OWNER("scene targets");
+		postProcess = new PostProcess();
+	}
+	{
+		GPU_MEMORY_OWNER("temporal history");
+		temporalUpsampler = new TemporalUpsampler();
+	}
+	// the budget follows the display the window opened on
+	dynamicResolution = new DynamicResolution();
+	DEVMODEA displayMode = {};
+	displayMode.dmSize = sizeof(displayMode);
+	if (EnumDisplaySettingsA(NULL, ENUM_CURRENT_SETTINGS, &displayMode) && displayMode.dmDisplayFrequency > 1)
+		dynamicResolution->setTargetFrameTime(1000.0f / displayMode.dmDisplayFrequency);
+	LOG_INFO("Dynamic resolution GPU budget %.2f ms", dynamicResolution->getBudget());
+	return true;
+}
 
-	//07 - 2nd step Enabling Depth
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LEQUAL);
-	glClearDepth(1.0f);
+bool InitVegetation(void)
+{
+	GPU_MEMORY_OWNER("vegetation");
+	vegetation = new Vegetation();
+	return true;
+}
 
+bool InitCloudNoise(void)
+{
+	GPU_MEMORY_OWNER("cloud noise");
+	cloudNoise = new CloudNoise();
+	return true;
+}
 
-	//08 - Set the Clear Color of Window To Blue
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+bool InitHud(void)
+{
+	perfHud = new PerfHud();
+	perfHud->addToggle("stress grid", 'T', &bHudStressScene);
+	perfHud->addToggle("GPU-driven submission", 'G', &bHudGpuDriven);
+	perfHud->addToggle("CPU culling", 'C', &bHudCpuCulling);
+	perfHud->addToggle("grass", 'V', &bHudVegetation);
+	perfHud->addToggle("depth prepass", 'Z', &bHudDepthPrepass);
+	perfHud->addToggle("dynamic resolution", 'R', &bHudDynamicResolution);
+	return true;
+}
 
-	ourShader.use();
-	glm::mat4 perspectiveProjectionMatrix = glm::perspective(glm::radians(45.0f), (float)WindowManager::SCR_WIDTH / (float)WindowManager::SCR_HEIGHT, 0.1f, 100.0f);
-	ourShader.setMat4("uMVPMatrix", perspectiveProjectionMatrix);
-
-	// world space positions of our cubes
-	glm::vec3 cubePositions[] = {
-		glm::vec3(0.0f,  0.0f,  0.0f),
-		glm::vec3(2.0f,  5.0f, -15.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f,  3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -2.5f),
-		glm::vec3(1.5f,  2.0f, -2.5f),
-		glm::vec3(1.5f,  0.2f, -1.5f),
-		glm::vec3(-1.3f,  1.0f, -1.5f)
-	};
+bool InitSceneMesh(void)
+{
+	{
+		GPU_MEMORY_OWNER("scene mesh");
+		sceneMesh = LoadCookedMesh(SCENE_MESH_SOURCE, SCENE_MESH_COOKED);
+	}
+	if (sceneMesh)
+	{
+		// fit into a 2 unit box next to the demo cubes
+		glm::vec3 extent = sceneMesh->getBoundsMax() - sceneMesh->getBoundsMin();
+		float size = glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-6f));
+		glm::vec3 center = (sceneMesh->getBoundsMin() + sceneMesh->getBoundsMax()) * 0.5f;
+		sceneMeshModel = glm::translate(glm::mat4(1.0f), glm::vec3(3.5f, 0.0f, 1.5f));
+		sceneMeshModel = glm::scale(sceneMeshModel, glm::vec3(2.0f / size));
+		sceneMeshModel = glm::translate(sceneMeshModel, -center);
+
+		// transformed box extent: |M| * extent (Arvo)
+		glm::vec3 halfExtent = extent * 0.5f;
+		sceneMeshCenter = glm::vec3(sceneMeshModel * glm::vec4(center, 1.0f));
+		for (int row = 0; row < 3; row++)
+			sceneMeshExtent[row] = fabsf(sceneMeshModel[0][row]) * halfExtent.x + fabsf(sceneMeshModel[1][row]) * halfExtent.y + fabsf(sceneMeshModel[2][row]) * halfExtent.z;
+	}
+	return true;
+}
 
+// render thread: replays one packet
+void RenderFrame(const FramePacket& packet)
+{
+	Memory::BeginFrame(MEMORY_LOOP_RENDER);
+	Profiler::BeginFrame();
 
+	// bounded slice of texture uploads, never a full-resolution stall
+	{
+		PROFILE_SCOPE("texture streaming");
+		textureStreamer->update();
+	}
+	GpuMemory::Update();
+
+	frameStream->beginFrame();
+
+	glm::mat4 viewProjectionMatrix = glm::mat4(1.0f);
+	float frameDeltaTime = 0.0f;
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	// with the depth prepass the opaque draws come twice, culling and scattering run once
+	bool depthOnly = false;
+	bool cubesCulled = false;
+	bool vegetationScattered = false;
+	int frameWidth = WindowManager::SCR_WIDTH;
+	int frameHeight = WindowManager::SCR_HEIGHT;
+	// the scene's share of the frame; with dynamic resolution smaller, jittered and upsampled
+	int renderWidth = frameWidth;
+	int renderHeight = frameHeight;
+	bool temporalUpsample = false;
+	glm::mat4 unjitteredViewProjection = glm::mat4(1.0f);
+	// where the post pass puts the finished image: the window, or the golden test target
+	GLuint outputFramebuffer = 0;
+
+	size_t cursor = 0;
+	RenderCommandList::Header header;
+	const void* payload = NULL;
+	while (packet.commands.next(cursor, header, payload))
+	{
+		switch (header.type)
+		{
+		case RENDER_COMMAND_SET_INSTANCES:
+		{
+			PROFILE_SCOPE("scene rebuild");
+			const RenderInstancesCommand& instances = *(const RenderInstancesCommand*)payload;
+			// straight from the packet, no copy of the matrices in between
+			const glm::mat4* matrices = packet.commands.getMatrices(instances.firstMatrix);
+			{
+				GPU_MEMORY_OWNER("cubes");
+				cubeMesh->setInstances(matrices, instances.count);
+			}
 
+			GPU_MEMORY_OWNER("gpu scene");
+			gpuScene->clearObjects();
+			gpuScene->addObjects(cubeMeshId, matrices, instances.count);
+			gpuScene->build();
 
-	//*** Game LOOP ***
-	while (pWindow->isRunning == FALSE)
-	{
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+			LOG_INFO("Scene rebuilt with %d cube instances", cubeMesh->getInstanceCount());
+			break;
+		}
+
+		case RENDER_COMMAND_BEGIN_VIEW:
 		{
-			if (msg.message == WM_QUIT)
-				pWindow->isRunning = TRUE;
+			const RenderViewCommand& view = *(const RenderViewCommand*)payload;
+			frameWidth = view.viewportWidth;
+			frameHeight = view.viewportHeight;
+			frameDeltaTime = view.deltaTime;
+			renderWidth = frameWidth;
+			renderHeight = frameHeight;
+			unjitteredViewProjection = view.viewProjection;
+			glm::mat4 projection = view.projection;
+			glm::mat4 inverseProjection = view.inverseProjection;
+
+			// the scale reacts to GPU times from PROFILER_FRAME_LATENCY frames ago
+			temporalUpsample = view.dynamicResolution;
+			if (temporalUpsample)
+			{
+				dynamicResolution->update(Profiler::GetLatest().gpuMs);
+				renderWidth = dynamicResolution->getRenderWidth(frameWidth);
+				renderHeight = dynamicResolution->getRenderHeight(frameHeight);
+				glm::vec2 jitter = temporalUpsampler->nextJitter(renderWidth, renderHeight, frameWidth, frameHeight);
+				projection = TemporalUpsampler::JitterProjection(view.projection, jitter, renderWidth, renderHeight);
+				inverseProjection = glm::inverse(projection);
+			}
 			else
 			{
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
+				// full resolution while off, and the history starts over when it comes back
+				if (dynamicResolution->getScale() < DYNAMIC_RESOLUTION_MAX_SCALE)
+					dynamicResolution->reset();
+				temporalUpsampler->invalidate();
 			}
+
+			postProcess->beginScene(frameWidth, frameHeight, renderWidth, renderHeight);
+			GLState::Viewport(0, 0, renderWidth, renderHeight);
+			// glClear honours the depth mask
+			GLState::DepthMask(GL_TRUE);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			viewProjectionMatrix = projection * view.view;
+			cameraPosition = glm::vec3(view.cameraPosition);
+
+			// per-frame uniforms go through the ring buffer, one range bind for every program
+			FrameUniforms frameUniforms;
+			frameUniforms.viewProjection = viewProjectionMatrix;
+			frameUniforms.view = view.view;
+			frameUniforms.projection = projection;
+			frameUniforms.cameraPosition = view.cameraPosition;
+			frameUniforms.time = glm::vec4(view.time, view.deltaTime, 0.0f, 0.0f);
+			frameUniforms.inverseView = view.inverseView;
+			frameUniforms.inverseProjection = inverseProjection;
+			StreamBuffer::Allocation frameAlloc = frameStream->write(&frameUniforms, sizeof(FrameUniforms), uniformAlignment);
+			frameStream->bindRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frameAlloc);
+			break;
 		}
-		else
+
+		case RENDER_COMMAND_UPDATE_WEATHER:
 		{
-			// per-frame time logic
-			// --------------------
-			float currentFrame = static_cast<float>(Timer::getAppRunTime());
-			deltaTime = currentFrame - lastFrame;
-			lastFrame = currentFrame;
+			PROFILE_SCOPE("cloud noise");
+			const RenderWeatherCommand& weather = *(const RenderWeatherCommand*)payload;
+			if (weather.regenerate)
+				cloudNoise->regenerateWeather(glm::vec3(weather.seed));
+			cloudNoise->update(weather.budgetMs, frameDeltaTime);
+			break;
+		}
 
+		case RENDER_COMMAND_DRAW_CUBES:
+		{
+			const RenderCubesCommand& cubes = *(const RenderCubesCommand*)payload;
+			if (cubes.gpuDriven)
+			{
+				// cull into the indirect buffer, then one multi-draw for every mesh
+				if (!cubesCulled)
+				{
+					PROFILE_SCOPE("culling");
+					if (cubes.cpuCulling)
+						gpuScene->cullCpu(viewProjectionMatrix, *frameStream);
+					else
+						gpuScene->cullGpu(viewProjectionMatrix);
+					cubesCulled = true;
+				}
+
+				PROFILE_SCOPE("cubes");
+				(depthOnly ? gpuDrivenDepthShader : gpuDrivenShader)->use();
+				gpuScene->draw();
+			}
+			else
+			{
+				// render boxes, one instanced draw for the whole set
+				PROFILE_SCOPE("cubes");
+				(depthOnly ? cubeDepthShader : cubeShader)->use();
+				cubeMesh->draw();
+			}
+			break;
+		}
 
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			ourShader.use();
+		case RENDER_COMMAND_DRAW_MESH:
+		{
+			PROFILE_SCOPE("mesh");
+			const RenderMeshCommand& mesh = *(const RenderMeshCommand*)payload;
+			Shader* shader = depthOnly ? meshDepthShader : meshShader;
+			shader->use();
+			sceneMesh->draw(*shader, mesh.model);
+			break;
+		}
 
-			glm::mat4 modelMatrix = glm::mat4(1.0f);
-			glm::mat4 viewMatrix = glm::mat4(1.0f);
-			glm::mat4 translationMatrix = glm::mat4(1.0f);
-			glm::mat4 rotationMatrix = glm::mat4(1.0f);
-			glm::mat4 modelViewProjectionMatrix = glm::mat4(1.0f);
+		case RENDER_COMMAND_DRAW_VEGETATION:
+		{
+			PROFILE_SCOPE("vegetation");
+			const RenderVegetationCommand& grass = *(const RenderVegetationCommand*)payload;
+			TerrainShape terrain = { glm::vec3(grass.seed), grass.baseHeight, grass.dispFactor, grass.frequency, grass.octaves, grass.power, grass.grassCoverage, grass.shoreHeight };
+			if (!vegetationScattered)
+			{
+				vegetation->update(viewProjectionMatrix, cameraPosition, terrain);
+				vegetationScattered = true;
+			}
+			vegetation->draw(depthOnly);
+			break;
+		}
 
-			
-			// camera/view transformation
-			float radius = 10.0f;
-			float camX = static_cast<float>(sin(anglePiramid*0.05f) * radius);
-			float camZ = static_cast<float>(cos(anglePiramid*0.05f) * radius);
-			viewMatrix = glm::lookAt(glm::vec3(camX, 0.0f, camZ), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			//viewMatrix = camera->GetViewMatrix();
-			
+		case RENDER_COMMAND_DEPTH_PASS:
+		{
+			const RenderDepthPassCommand& depthPass = *(const RenderDepthPassCommand*)payload;
+			depthOnly = depthPass.pass == RENDER_DEPTH_PREPASS;
+			GLState::ColorMask(depthOnly ? GL_FALSE : GL_TRUE);
+			GLState::DepthMask(depthPass.pass == RENDER_DEPTH_SHADING ? GL_FALSE : GL_TRUE);
+			GLState::DepthFunc(depthPass.pass == RENDER_DEPTH_SHADING ? GL_EQUAL : GL_LEQUAL);
+			if (depthPass.pass == RENDER_DEPTH_PYRAMID)
+			{
+				PROFILE_SCOPE("hi-z");
+				// its program is only built once something asks for the pyramid
+				if (hiZ == NULL)
+					hiZ = new HiZPyramid();
+				hiZ->build(postProcess->getDepthTexture(), postProcess->getWidth(), postProcess->getHeight(),
+					postProcess->getRenderWidth(), postProcess->getRenderHeight());
+			}
+			break;
+		}
 
-			// render boxes
-			glBindVertexArray(vaoCube);
-			for (unsigned int i = 0; i < 10; i++)
+		case RENDER_COMMAND_POST_PROCESS:
+		{
+			PROFILE_SCOPE("post process");
+			const RenderPostCommand& post = *(const RenderPostCommand*)payload;
+			PostSettings settings = { post.exposure, post.gamma, post.vignette, post.tonemap, post.autoExposure, post.adaptationRate, post.resetAdaptation };
+			GLuint upsampled = 0;
+			if (temporalUpsample)
 			{
-				// calculate the model matrix for each object and pass it to shader before drawing
-				modelMatrix = glm::translate(modelMatrix, cubePositions[i]);
-				float angle = 20.0f * i;
-				modelMatrix = glm::rotate(modelMatrix, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-				ourShader.setMat4("model", modelMatrix);
+				PROFILE_SCOPE("temporal upsample");
+				upsampled = temporalUpsampler->resolve(postProcess->getColorTexture(), postProcess->getDepthTexture(),
+					renderWidth, renderHeight, frameWidth, frameHeight, unjitteredViewProjection);
+			}
+			GLState::Viewport(0, 0, frameWidth, frameHeight);
+			postProcess->resolve(settings, frameDeltaTime, outputFramebuffer, 0, upsampled);
+			break;
+		}
 
-				modelViewProjectionMatrix = perspectiveProjectionMatrix * viewMatrix * modelMatrix;
-				ourShader.setMat4("uMVPMatrix", modelViewProjectionMatrix);
+		case RENDER_COMMAND_DRAW_OVERLAY:
+		{
+			// overlay text and graphs go out in a single draw after the scene
+			PROFILE_SCOPE("overlay");
+			const RenderOverlayCommand& overlay = *(const RenderOverlayCommand*)payload;
+			bHudStressScene = overlay.stressScene;
+			bHudGpuDriven = overlay.gpuDriven;
+			bHudCpuCulling = overlay.cpuCulling;
+			bHudVegetation = overlay.vegetation;
+			bHudDepthPrepass = overlay.depthPrepass;
+			bHudDynamicResolution = overlay.dynamicResolution;
+			perfHud->setResolution(renderWidth, renderHeight, frameWidth, frameHeight);
+			perfHud->setMemory(GpuMemory::GetTotal(GPU_RESOURCE_TEXTURE) + GpuMemory::GetTotal(GPU_RESOURCE_RENDERBUFFER), GpuMemory::GetTotal(GPU_RESOURCE_BUFFER));
+			perfHud->draw(*textRenderer, 10.0f, 10.0f);
+			textRenderer->flush(*frameStream, frameWidth, frameHeight);
+			break;
+		}
 
-				glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-				glDrawArrays(GL_TRIANGLE_FAN, 4, 4);
-				glDrawArrays(GL_TRIANGLE_FAN, 8, 4);
-				glDrawArrays(GL_TRIANGLE_FAN, 12, 4);
-				glDrawArrays(GL_TRIANGLE_FAN, 16, 4);
-				glDrawArrays(GL_TRIANGLE_FAN, 20, 4);
+		case RENDER_COMMAND_DEBUG:
+		{
+			const RenderDebugCommand& debug = *(const RenderDebugCommand*)payload;
+			if (debug.actions & RENDER_DEBUG_TOGGLE_HUD)
+				perfHud->toggleVisible();
+			if (debug.actions & RENDER_DEBUG_MEMORY_REPORT)
+			{
+				GpuMemory::DumpReport();
+				Memory::DumpReport();
 			}
+			if (debug.actions & RENDER_DEBUG_STATE_COUNTERS)
+				LOG_INFO("GL state calls issued %llu, elided %llu", (unsigned long long)GLState::GetIssued(), (unsigned long long)GLState::GetElided());
+			break;
+		}
 
-			
-			
-			glBindVertexArray(0);
-			glUseProgram(0);
-            
-			
-            pWindow->swapDisplayBuffer();
+		case RENDER_COMMAND_GOLDEN:
+		{
+			const RenderGoldenCommand& golden = *(const RenderGoldenCommand*)payload;
+			if (golden.begin)
+			{
+				goldenTest->begin(golden.width, golden.height);
+				outputFramebuffer = goldenTest->getFramebuffer();
+			}
+			else
+				goldenTest->end(golden.name, golden.timed, golden.compare);
+			break;
+		}
 
-			///================== UPDATE =======================//
-			anglePiramid = anglePiramid + 0.01f;
-			
+		case RENDER_COMMAND_CAPTURE:
+		{
+			const RenderCaptureCommand& capture = *(const RenderCaptureCommand*)payload;
+			if (capture.action == RENDER_CAPTURE_SCREENSHOT)
+				frameCapture->screenshot(capture.path);
+			else if (capture.action == RENDER_CAPTURE_START)
+				frameCapture->startRecording(capture.path, capture.video ? CAPTURE_Y4M : CAPTURE_PNG_SEQUENCE, capture.framesPerSecond);
+			else
+				frameCapture->stopRecording();
+			break;
+		}
 		}
 	}
-	
 
+	// readback of the finished frame, mapped a few frames later
+	{
+		PROFILE_SCOPE("capture");
+		frameCapture->capture(frameWidth, frameHeight);
+	}
 
-	return((int)msg.wParam);
+	Profiler::EndFrame();
+
+	frameStream->endFrame();
+	Memory::EndFrame(MEMORY_LOOP_RENDER);
+
+	// time to first frame and the startup timeline, once
+	if (startup)
+	{
+		startup->report(TIMER_NOW());
+		delete startup;
+		startup = NULL;
+	}
+}
+
+// main thread: renders what is still queued, then RenderShutdown releases the
+// GL side; before the window is destroyed, and again (a no-op) at exit
+void StopRendering(void)
+{
+	delete renderThread;
+	renderThread = NULL;
+}
+
+// render thread, after the last frame
+void RenderShutdown(void)
+{
+	// finishes any recording and writes what is still queued
+	delete frameCapture;
+	frameCapture = NULL;
+	if (goldenTest)
+		goldenTest->releaseTargets();
+	delete temporalUpsampler;
+	temporalUpsampler = NULL;
+	delete dynamicResolution;
+	dynamicResolution = NULL;
+	delete cloudNoise;
+	cloudNoise = NULL;
+	delete hiZ;
+	hiZ = NULL;
+	delete vegetation;
+	vegetation = NULL;
+	delete postProcess;
+	postProcess = NULL;
+	delete perfHud;
+	perfHud = NULL;
+	delete textRenderer;
+	textRenderer = NULL;
+	Profiler::Shutdown();
+	delete sceneMesh;
+	sceneMesh = NULL;
+	delete textureStreamer;
+	textureStreamer = NULL;
+	delete gpuScene;
+	gpuScene = NULL;
+	delete frameStream;
+	frameStream = NULL;
+	delete cubeMesh;
+	cubeMesh = NULL;
+	delete meshDepthShader;
+	meshDepthShader = NULL;
+	delete gpuDrivenDepthShader;
+	gpuDrivenDepthShader = NULL;
+	delete cubeDepthShader;
+	cubeDepthShader = NULL;
+	delete meshShader;
+	meshShader = NULL;
+	delete gpuDrivenShader;
+	gpuDrivenShader = NULL;
+	delete cubeShader;
+	cubeShader = NULL;
+	// anything still listed here was never released
+	GpuMemory::DumpReport();
+}
+
+
+// job worker: a present source is recooked when newer, a shipped .cmesh loads without it
+bool CookMeshIfStale(const char* source, const char* cooked)
+{
+	uint64_t sourceTime = 0;
+	if (!MappedFile::LastWriteTime(source, sourceTime) || !MeshCooker::needsCook(source, cooked))
+		return true;
+	return MeshCooker::cook(source, cooked);
+}
+
+StaticMesh* LoadCookedMesh(const char* source, const char* cooked)
+{
+	uint64_t sourceTime = 0;
+	bool hasSource = MappedFile::LastWriteTime(source, sourceTime);
+
+	StaticMesh* mesh = new StaticMesh();
+	if (!mesh->load(cooked))
+	{
+		if (hasSource)
+			LOG_ERROR("Cooked mesh %s could not be opened", cooked);
+		else
+			LOG_INFO("No %s or %s, scene mesh skipped", source, cooked);
+		delete mesh;
+		return NULL;
+	}
+	return mesh;
 }
 
 
@@ -288,6 +1297,9 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT iMsg, WPARAM wParam, LPARAM lParam)
 
 
 	//*** Code ***
+	// raw keyboard/mouse state for the camera, the cases below only handle one-shot keys
+	Input::HandleMessage(iMsg, wParam, lParam);
+
 	switch (iMsg)
 	{
 	case WM_SETFOCUS:
@@ -297,40 +1309,47 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT iMsg, WPARAM wParam, LPARAM lParam)
 		break;
 
 	case WM_SIZE:
-        glViewport(0, 0, LOWORD(lParam), HIWORD(lParam));
+		// the render thread applies it with the next frame
+		if (LOWORD(lParam) > 0 && HIWORD(lParam) > 0)
+		{
+			viewportWidth = LOWORD(lParam);
+			viewportHeight = HIWORD(lParam);
+		}
 		break;
 
 	case WM_ERASEBKGND:
 		return(0);
 
-	case WM_MOUSEMOVE:
-		{
-			float xpos = static_cast<float>(GET_X_LPARAM(lParam));
-			float ypos = static_cast<float>(GET_Y_LPARAM(lParam));
-
-			if (firstMouse)
-			{
-				lastX = xpos;
-				lastY = ypos;
-				firstMouse = false;
-			}
-
-			float xoffset = xpos - lastX;
-			float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-			lastX = xpos;
-			lastY = ypos;
-			camera->ProcessMouseMovement(xoffset, yoffset);
-		}
-		
-		break;
-
 	case WM_KEYDOWN:
 		switch (LOWORD(wParam))
 		{
 		case VK_ESCAPE:
+			StopRendering();
 			DestroyWindow(hwnd);
 			break;
+
+		case VK_F12:
+		case VK_F11:
+		{
+			SYSTEMTIME time;
+			GetLocalTime(&time);
+			RenderCaptureCommand capture = {};
+			capture.framesPerSecond = CAPTURE_FRAMES_PER_SECOND;
+			if (LOWORD(wParam) == VK_F12)
+			{
+				capture.action = RENDER_CAPTURE_SCREENSHOT;
+				sprintf_s(capture.path, "captures/%04d%02d%02d_%02d%02d%02d_%03d.png", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond, time.wMilliseconds);
+			}
+			else
+			{
+				capture.action = bRecording ? RENDER_CAPTURE_STOP : RENDER_CAPTURE_START;
+				capture.video = true;
+				sprintf_s(capture.path, "captures/%04d%02d%02d_%02d%02d%02d.y4m", time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+				bRecording = !bRecording;
+			}
+			pendingCaptures.push_back(capture);
+			break;
+		}
 		}
 		break;
 
@@ -339,34 +1358,66 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT iMsg, WPARAM wParam, LPARAM lParam)
 		{
 		case 'F':
 		case 'f':
-			
+			bFreeCamera = !bFreeCamera;
+			break;
+
+		case 'T':
+		case 't':
+			bStressScene = !bStressScene;
+			bSceneDirty = true;
+			break;
+
+		case 'G':
+		case 'g':
+			bGpuDriven = !bGpuDriven;
+			break;
+
+		case 'C':
+		case 'c':
+			bCpuCulling = !bCpuCulling;
+			break;
+
+		case 'V':
+		case 'v':
+			bVegetation = !bVegetation;
+			break;
+
+		case 'Z':
+		case 'z':
+			bDepthPrepass = !bDepthPrepass;
+			break;
+
+		case 'N':
+		case 'n':
+			bNewWeather = true;
 			break;
 
-		case 'W':
-		case 'w':
-			camera->ProcessKeyboard(FORWARD, deltaTime);
+		case 'R':
+		case 'r':
+			bDynamicResolution = !bDynamicResolution;
 			break;
 
-		case 'A':
-		case 'a':
-			camera->ProcessKeyboard(LEFT, deltaTime);
+		case 'H':
+		case 'h':
+			pendingDebugActions |= RENDER_DEBUG_TOGGLE_HUD;
 			break;
 
-		case 'S':
-		case 's':
-			camera->ProcessKeyboard(BACKWARD, deltaTime);
+		case 'M':
+		case 'm':
+			pendingDebugActions |= RENDER_DEBUG_MEMORY_REPORT;
 			break;
 
-		case 'D':
-		case 'd':
-			camera->ProcessKeyboard(RIGHT, deltaTime);
+		case 'P':
+		case 'p':
+			pendingDebugActions |= RENDER_DEBUG_STATE_COUNTERS;
 			break;
 
-		
 		}
 		break;
 
 	case WM_CLOSE:
+		// the render thread presents to this window's device context
+		StopRendering();
 		DestroyWindow(hwnd);
 		break;
 
@@ -0,0 +1,560 @@
+#include "ObjImporter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <thread>
+#include <unordered_map>
+#include <string.h>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "MappedFile.h"
+
+// below this a file is parsed on one thread, splitting costs more than it saves
+#define OBJ_MIN_CHUNK_BYTES (256 * 1024)
+#define OBJ_MATERIAL_UNSET 0xFFFFFFFFu
+
+enum ObjAttribute
+{
+    OBJ_POSITION,
+    OBJ_TEXCOORD,
+    OBJ_NORMAL
+};
+
+// one face corner as written in the file; -1 = attribute not given.
+// Negative (relative) OBJ indices can only be resolved once the chunk's
+// starting counts are known, so they are stored chunk-local and flagged.
+struct ObjCorner
+{
+    int32_t index[3];
+    uint32_t relativeMask;
+};
+
+struct ObjMaterialSwitch
+{
+    size_t corner;
+    std::string name;
+};
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners;         // three per triangle
+    std::vector<ObjMaterialSwitch> materialSwitches;
+    std::vector<std::string> materialLibraries;
+    int malformedLines;
+    int zeroIndexFaces;                     // subset of the malformed lines
+};
+
+struct ObjVertexKey
+{
+    int32_t position;
+    int32_t texCoord;
+    int32_t normal;
+
+    bool operator==(const ObjVertexKey& other) const
+    {
+        return position == other.position && texCoord == other.texCoord && normal == other.normal;
+    }
+};
+
+struct ObjVertexKeyHash
+{
+    size_t operator()(const ObjVertexKey& key) const
+    {
+        uint64_t h = (uint32_t)key.position * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint32_t)key.texCoord + 0x7F4A7C15ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+        h ^= ((uint32_t)key.normal + 0x94D049BBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+        return (size_t)(h ^ (h >> 31));
+    }
+};
+
+static inline const char* skipSpace(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end)
+{
+    while (p < end && *p != '\n')
+        p++;
+    return (p < end) ? p + 1 : end;
+}
+
+static inline bool isLineEnd(const char* p, const char* end)
+{
+    return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value, bool& ok)
+{
+    p = skipSpace(p, end);
+    if (p < end && *p == '+')
+        p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+    {
+        value = 0.0f;
+        ok = false;
+        return p;
+    }
+    return result.ptr;
+}
+
+// rest of the line with surrounding blanks trimmed
+static std::string parseName(const char* p, const char* end)
+{
+    p = skipSpace(p, end);
+    const char* last = p;
+    while (last < end && *last != '\n' && *last != '\r')
+        last++;
+    while (last > p && (last[-1] == ' ' || last[-1] == '\t'))
+        last--;
+    return std::string(p, last);
+}
+
+static inline bool startsWith(const char* p, const char* end, const char* keyword, size_t length)
+{
+    return (size_t)(end - p) > length && memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+}
+
+static void parseChunk(ObjChunk& chunk)
+{
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    chunk.malformedLines = 0;
+    chunk.zeroIndexFaces = 0;
+
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        if (p >= end)
+            break;
+
+        bool ok = true;
+        if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            glm::vec3 v;
+            p = parseFloat(p + 1, end, v.x, ok);
+            p = parseFloat(p, end, v.y, ok);
+            p = parseFloat(p, end, v.z, ok);
+            chunk.positions.push_back(v);
+        }
+        else if (p[0] == 'v' && p + 2 < end && p[1] == 't')
+        {
+            glm::vec2 t;
+            p = parseFloat(p + 2, end, t.x, ok);
+            p = parseFloat(p, end, t.y, ok);
+            chunk.texCoords.push_back(t);
+        }
+        else if (p[0] == 'v' && p + 2 < end && p[1] == 'n')
+        {
+            glm::vec3 n;
+            p = parseFloat(p + 2, end, n.x, ok);
+            p = parseFloat(p, end, n.y, ok);
+            p = parseFloat(p, end, n.z, ok);
+            chunk.normals.push_back(n);
+        }
+        else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            const int32_t counts[3] = { (int32_t)chunk.positions.size(), (int32_t)chunk.texCoords.size(), (int32_t)chunk.normals.size() };
+            ObjCorner first = {}, previous = {};
+            int cornerCount = 0;
+            // a malformed face is dropped whole, not just from the bad corner on
+            size_t faceStart = chunk.corners.size();
+            p++;
+
+            for (;;)
+            {
+                p = skipSpace(p, end);
+                if (isLineEnd(p, end))
+                    break;
+
+                ObjCorner corner = { { -1, -1, -1 }, 0 };
+                for (int attribute = OBJ_POSITION; attribute <= OBJ_NORMAL; attribute++)
+                {
+                    // "v", "v/t", "v//n", "v/t/n"
+                    if (attribute > OBJ_POSITION)
+                    {
+                        if (p >= end || *p != '/')
+                            break;
+                        p++;
+                        if (p < end && *p == '/')
+                            continue;
+                    }
+
+                    int raw = 0;
+                    std::from_chars_result result = std::from_chars(p, end, raw);
+                    if (result.ec != std::errc())
+                    {
+                        if (attribute == OBJ_POSITION)
+                            ok = false;
+                        break;
+                    }
+                    p = result.ptr;
+
+                    if (raw > 0)
+                    {
+                        corner.index[attribute] = raw - 1;
+                    }
+                    else if (raw < 0)
+                    {
+                        corner.index[attribute] = counts[attribute] + raw;
+                        corner.relativeMask |= 1u << attribute;
+                    }
+                    else
+                    {
+                        // indices start at 1, 0 is not "absent"
+                        chunk.zeroIndexFaces++;
+                        ok = false;
+                        break;
+                    }
+                }
+                if (!ok)
+                {
+                    chunk.corners.resize(faceStart);
+                    break;
+                }
+
+                if (cornerCount == 0)
+                {
+                    first = corner;
+                }
+                else if (cornerCount >= 2)
+                {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(corner);
+                }
+                previous = corner;
+                cornerCount++;
+            }
+        }
+        else if (startsWith(p, end, "usemtl", 6))
+        {
+            ObjMaterialSwitch change;
+            change.corner = chunk.corners.size();
+            change.name = parseName(p + 6, end);
+            chunk.materialSwitches.push_back(change);
+        }
+        else if (startsWith(p, end, "mtllib", 6))
+        {
+            chunk.materialLibraries.push_back(parseName(p + 6, end));
+        }
+        // comments, o, g, s, l, p and unknown keywords are skipped
+
+        if (!ok)
+            chunk.malformedLines++;
+        p = skipLine(p, end);
+    }
+}
+
+static std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+}
+
+static uint32_t findOrAddMaterial(std::vector<MeshMaterial>& materials, const std::string& name)
+{
+    for (size_t i = 0; i < materials.size(); i++)
+    {
+        if (materials[i].name == name)
+            return (uint32_t)i;
+    }
+
+    MeshMaterial material;
+    material.name = name;
+    material.diffuse = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+    material.specular = glm::vec3(0.0f);
+    material.shininess = 0.0f;
+    materials.push_back(material);
+    return (uint32_t)materials.size() - 1;
+}
+
+bool ObjImporter::importMaterials(const std::string& path, std::vector<MeshMaterial>& materials)
+{
+    MappedFile file;
+    if (!file.open(path.c_str()))
+    {
+        LOG_ERROR("ObjImporter: cannot open material library %s", path.c_str());
+        return false;
+    }
+
+    const char* p = (const char*)file.data();
+    const char* end = p + file.size();
+    MeshMaterial* current = NULL;
+
+    while (p < end)
+    {
+        p = skipSpace(p, end);
+        bool ok = true;
+
+        if (startsWith(p, end, "newmtl", 6))
+        {
+            current = &materials[findOrAddMaterial(materials, parseName(p + 6, end))];
+        }
+        else if (current && startsWith(p, end, "Kd", 2))
+        {
+            p = parseFloat(p + 2, end, current->diffuse.x, ok);
+            p = parseFloat(p, end, current->diffuse.y, ok);
+            p = parseFloat(p, end, current->diffuse.z, ok);
+        }
+        else if (current && startsWith(p, end, "Ks", 2))
+        {
+            p = parseFloat(p + 2, end, current->specular.x, ok);
+            p = parseFloat(p, end, current->specular.y, ok);
+            p = parseFloat(p, end, current->specular.z, ok);
+        }
+        else if (current && startsWith(p, end, "Ns", 2))
+        {
+            p = parseFloat(p + 2, end, current->shininess, ok);
+        }
+        else if (current && startsWith(p, end, "d", 1))
+        {
+            p = parseFloat(p + 1, end, current->diffuse.w, ok);
+        }
+        else if (current && startsWith(p, end, "map_Kd", 6))
+        {
+            current->diffuseMap = directoryOf(path) + parseName(p + 6, end);
+        }
+
+        p = skipLine(p, end);
+    }
+    return true;
+}
+
+bool ObjImporter::import(const std::string& path, ImportedMesh& mesh, int threadCount)
+{
+    double startTime = Timer::getAppRunTime();
+
+    MappedFile file;
+    if (!file.open(path.c_str()))
+    {
+        LOG_ERROR("ObjImporter: cannot open %s", path.c_str());
+        return false;
+    }
+
+    const char* data = (const char*)file.data();
+    size_t size = (size_t)file.size();
+
+    // split at line boundaries, one chunk per thread
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    size_t maxChunks = size / OBJ_MIN_CHUNK_BYTES + 1;
+    size_t chunkCount = ((size_t)threadCount < maxChunks) ? (size_t)threadCount : maxChunks;
+    chunkCount = (chunkCount > 0) ? chunkCount : 1;
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* cursor = data;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        const char* split = (i + 1 == chunkCount) ? data + size : data + size * (i + 1) / chunkCount;
+        if (split < cursor)
+            split = cursor;
+        split = skipLine(split == data ? split : split - 1, data + size);
+        chunks[i].begin = cursor;
+        chunks[i].end = split;
+        cursor = split;
+    }
+
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < chunkCount; i++)
+            threads.emplace_back(parseChunk, std::ref(chunks[i]));
+        parseChunk(chunks[0]);
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+
+    // starting counts of every chunk
+    std::vector<size_t> firstPosition(chunkCount + 1, 0), firstTexCoord(chunkCount + 1, 0), firstNormal(chunkCount + 1, 0), firstCorner(chunkCount + 1, 0);
+    int malformedLines = 0;
+    int zeroIndexFaces = 0;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        firstPosition[i + 1] = firstPosition[i] + chunks[i].positions.size();
+        firstTexCoord[i + 1] = firstTexCoord[i] + chunks[i].texCoords.size();
+        firstNormal[i + 1] = firstNormal[i] + chunks[i].normals.size();
+        firstCorner[i + 1] = firstCorner[i] + chunks[i].corners.size();
+        malformedLines += chunks[i].malformedLines;
+        zeroIndexFaces += chunks[i].zeroIndexFaces;
+    }
+    if (malformedLines > 0)
+        LOG_ERROR("ObjImporter: %s has %d malformed lines, skipped", path.c_str(), malformedLines);
+    if (zeroIndexFaces > 0)
+        LOG_ERROR("ObjImporter: %s has %d faces with index 0, OBJ indices start at 1", path.c_str(), zeroIndexFaces);
+
+    size_t positionCount = firstPosition[chunkCount];
+    size_t texCoordCount = firstTexCoord[chunkCount];
+    size_t normalCount = firstNormal[chunkCount];
+    size_t cornerCount = firstCorner[chunkCount];
+    if (positionCount == 0 || cornerCount == 0)
+    {
+        LOG_ERROR("ObjImporter: %s contains no triangles", path.c_str());
+        return false;
+    }
+
+    // stitch: copy attributes into place and make every index absolute
+    std::vector<glm::vec3> positions(positionCount);
+    std::vector<glm::vec2> texCoords(texCoordCount);
+    std::vector<glm::vec3> normals(normalCount);
+    std::vector<ObjCorner> corners(cornerCount);
+    std::vector<char> chunkValid(chunkCount, 1);
+    {
+        auto stitch = [&](size_t i)
+        {
+            const ObjChunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + firstPosition[i]);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + firstTexCoord[i]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + firstNormal[i]);
+
+            const int32_t offsets[3] = { (int32_t)firstPosition[i], (int32_t)firstTexCoord[i], (int32_t)firstNormal[i] };
+            const int32_t counts[3] = { (int32_t)positionCount, (int32_t)texCoordCount, (int32_t)normalCount };
+            for (size_t c = 0; c < chunk.corners.size(); c++)
+            {
+                ObjCorner corner = chunk.corners[c];
+                for (int attribute = OBJ_POSITION; attribute <= OBJ_NORMAL; attribute++)
+                {
+                    if (corner.relativeMask & (1u << attribute))
+                        corner.index[attribute] += offsets[attribute];
+                    else if (corner.index[attribute] == -1)
+                        continue;
+                    if (corner.index[attribute] < 0 || corner.index[attribute] >= counts[attribute])
+                        chunkValid[i] = 0;
+                }
+                corners[firstCorner[i] + c] = corner;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < chunkCount; i++)
+            threads.emplace_back(stitch, i);
+        stitch(0);
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        if (!chunkValid[i])
+        {
+            LOG_ERROR("ObjImporter: %s references vertices that do not exist", path.c_str());
+            return false;
+        }
+    }
+
+    // materials: libraries first, then one id per triangle from the usemtl runs
+    mesh.materials.clear();
+    for (size_t i = 0; i < chunkCount; i++)
+        for (size_t l = 0; l < chunks[i].materialLibraries.size(); l++)
+            importMaterials(directoryOf(path) + chunks[i].materialLibraries[l], mesh.materials);
+
+    size_t triangleCount = cornerCount / 3;
+    std::vector<uint32_t> triangleMaterial(triangleCount);
+    {
+        uint32_t material = OBJ_MATERIAL_UNSET;
+        size_t triangle = 0;
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            for (size_t s = 0; s <= chunks[i].materialSwitches.size(); s++)
+            {
+                size_t runEnd = (s < chunks[i].materialSwitches.size()) ? (firstCorner[i] + chunks[i].materialSwitches[s].corner) / 3 : firstCorner[i + 1] / 3;
+                if (triangle < runEnd && material == OBJ_MATERIAL_UNSET)
+                    material = findOrAddMaterial(mesh.materials, "default");
+                for (; triangle < runEnd; triangle++)
+                    triangleMaterial[triangle] = material;
+                if (s < chunks[i].materialSwitches.size())
+                    material = findOrAddMaterial(mesh.materials, chunks[i].materialSwitches[s].name);
+            }
+        }
+    }
+
+    // de-duplicate corners into vertices
+    bool generateNormals = (normalCount == 0);
+    std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash> vertexMap;
+    vertexMap.reserve(cornerCount / 2);
+    std::vector<uint32_t> cornerVertex(cornerCount);
+    std::vector<int32_t> vertexPosition;
+    mesh.positions.clear();
+    mesh.texCoords.clear();
+    mesh.normals.clear();
+    for (size_t c = 0; c < cornerCount; c++)
+    {
+        const ObjCorner& corner = corners[c];
+        if (corner.index[OBJ_NORMAL] < 0)
+            generateNormals = true;
+
+        ObjVertexKey key = { corner.index[OBJ_POSITION], corner.index[OBJ_TEXCOORD], corner.index[OBJ_NORMAL] };
+        std::pair<std::unordered_map<ObjVertexKey, uint32_t, ObjVertexKeyHash>::iterator, bool> inserted = vertexMap.emplace(key, (uint32_t)mesh.positions.size());
+        if (inserted.second)
+        {
+            mesh.positions.push_back(positions[key.position]);
+            mesh.texCoords.push_back(key.texCoord >= 0 ? texCoords[key.texCoord] : glm::vec2(0.0f));
+            mesh.normals.push_back(key.normal >= 0 ? normals[key.normal] : glm::vec3(0.0f));
+            vertexPosition.push_back(key.position);
+        }
+        cornerVertex[c] = inserted.first->second;
+    }
+
+    // area weighted face normals, shared by every vertex on the same position
+    if (generateNormals)
+    {
+        std::vector<glm::vec3> accumulated(positionCount, glm::vec3(0.0f));
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            int32_t a = corners[t * 3].index[OBJ_POSITION];
+            int32_t b = corners[t * 3 + 1].index[OBJ_POSITION];
+            int32_t c = corners[t * 3 + 2].index[OBJ_POSITION];
+            glm::vec3 faceNormal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+            accumulated[a] += faceNormal;
+            accumulated[b] += faceNormal;
+            accumulated[c] += faceNormal;
+        }
+        for (size_t v = 0; v < mesh.normals.size(); v++)
+        {
+            if (mesh.normals[v] != glm::vec3(0.0f))
+                continue;
+            glm::vec3 n = accumulated[vertexPosition[v]];
+            float length = glm::length(n);
+            mesh.normals[v] = (length > 0.0f) ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // group triangles by material, keeping file order inside a group
+    std::vector<uint32_t> materialStart(mesh.materials.size() + 1, 0);
+    for (size_t t = 0; t < triangleCount; t++)
+        materialStart[triangleMaterial[t] + 1]++;
+    for (size_t m = 0; m < mesh.materials.size(); m++)
+        materialStart[m + 1] += materialStart[m];
+
+    mesh.indices.resize(triangleCount * 3);
+    mesh.subsets.clear();
+    std::vector<uint32_t> fill(materialStart.begin(), materialStart.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        uint32_t slot = fill[triangleMaterial[t]]++ * 3;
+        mesh.indices[slot] = cornerVertex[t * 3];
+        mesh.indices[slot + 1] = cornerVertex[t * 3 + 1];
+        mesh.indices[slot + 2] = cornerVertex[t * 3 + 2];
+    }
+    for (size_t m = 0; m < mesh.materials.size(); m++)
+    {
+        if (materialStart[m + 1] == materialStart[m])
+            continue;
+        MeshSubset subset;
+        subset.indexOffset = materialStart[m] * 3;
+        subset.indexCount = (materialStart[m + 1] - materialStart[m]) * 3;
+        subset.material = (uint32_t)m;
+        mesh.subsets.push_back(subset);
+    }
+
+    LOG_INFO("ObjImporter: %s, %d vertices %d triangles %d materials, %d threads in %.3f seconds", path.c_str(), (int)mesh.positions.size(),
+        (int)triangleCount, (int)mesh.materials.size(), (int)chunkCount, Timer::getAppRunTime() - startTime);
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef OBJIMPORTER_H
+#define OBJIMPORTER_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+struct MeshMaterial
+{
+    std::string name;
+    glm::vec4 diffuse;      // Kd, alpha from d
+    glm::vec3 specular;     // Ks
+    float shininess;        // Ns
+    std::string diffuseMap; // map_Kd, relative to the .mtl
+};
+
+// contiguous index range drawn with one material
+struct MeshSubset
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t material;
+};
+
+// de-duplicated, indexed triangle mesh; all attribute arrays share the index buffer
+struct ImportedMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+    std::vector<uint32_t> indices;
+    std::vector<MeshSubset> subsets;    // one per material, in material order
+    std::vector<MeshMaterial> materials;
+};
+
+// Wavefront OBJ/MTL reader. The file is memory mapped and split at line
+// boundaries into one chunk per thread; chunks are parsed in parallel with
+// std::from_chars, then stitched (relative indices fixed up, materials
+// resolved) and de-duplicated into a single indexed vertex stream.
+// Polygons are fan triangulated; missing normals are generated smooth.
+class ObjImporter
+{
+public:
+    static bool import(const std::string& path, ImportedMesh& mesh, int threadCount = 0);
+    static bool importMaterials(const std::string& path, std::vector<MeshMaterial>& materials);
+};
+
+#endif // OBJIMPORTER_H
@@ -0,0 +1,220 @@
+#pragma once
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Profiler.h"
+#include "Memory.h"
+#include "TextRenderer.h"
+
+#define PERF_HUD_TEXT_SIZE 16.0f
+#define PERF_HUD_WIDTH 440.0f
+#define PERF_HUD_GRAPH_HEIGHT 60.0f
+#define PERF_HUD_GRAPH_MAX_MS 33.3f
+#define PERF_HUD_VIDMEM_INTERVAL 30     // frames between driver memory queries
+
+// On-screen performance overlay: frame time graph, per-pass CPU/GPU times,
+// draw and primitive counts from the Profiler, GPU memory totals, heap
+// allocations per frame (yellow until both loops reach zero), the render
+// resolution and the state of the quality toggles. Everything is queued into the TextRenderer, so the
+// whole overlay costs that renderer's single draw.
+class PerfHud
+{
+public:
+    PerfHud()
+        : visible(true), memoryKnown(false), textureBytes(0), bufferBytes(0), vidmemTotalKB(0), vidmemAvailableKB(0),
+          renderWidth(0), renderHeight(0), outputWidth(0), outputHeight(0)
+    {
+    }
+
+    PerfHud(const PerfHud&) = delete;
+    PerfHud& operator=(const PerfHud&) = delete;
+
+    // the key is only shown, input handling stays with the owner of the flag
+    // ------------------------------------------------------------------------
+    void addToggle(const char* label, char key, const bool* value)
+    {
+        Toggle toggle = { label, key, value };
+        toggles.push_back(toggle);
+    }
+    // ------------------------------------------------------------------------
+    void setMemory(uint64_t textures, uint64_t buffers)
+    {
+        memoryKnown = true;
+        textureBytes = textures;
+        bufferBytes = buffers;
+    }
+    // scene render size against the output it is upsampled to
+    // ------------------------------------------------------------------------
+    void setResolution(int sceneWidth, int sceneHeight, int targetWidth, int targetHeight)
+    {
+        renderWidth = sceneWidth;
+        renderHeight = sceneHeight;
+        outputWidth = targetWidth;
+        outputHeight = targetHeight;
+    }
+    // ------------------------------------------------------------------------
+    void toggleVisible()
+    {
+        visible = !visible;
+    }
+    // ------------------------------------------------------------------------
+    bool isVisible() const
+    {
+        return visible;
+    }
+    // queue the overlay with its top-left corner at (x, y)
+    // ------------------------------------------------------------------------
+    void draw(TextRenderer& text, float x, float y)
+    {
+        if (!visible)
+            return;
+
+        queryVideoMemory();
+
+        const Profiler::Frame& frame = Profiler::GetLatest();
+        float line = floorf(text.getLineHeight(PERF_HUD_TEXT_SIZE) + 0.5f);
+        float left = x + 8.0f;
+        float cursor = y + 6.0f;
+        char buffer[160];
+
+        // panel height: header, graph, pass table, counters, memory, heap, resolution and toggles
+        float height = 6.0f + line + PERF_HUD_GRAPH_HEIGHT + 6.0f + line * (1 + frame.passCount) + line * 5 + line * toggles.size() + 6.0f;
+        text.addRect(x, y, PERF_HUD_WIDTH, height, glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+
+        double frameMs = Profiler::GetHistory(PROFILER_HISTORY - 1);
+        snprintf(buffer, sizeof(buffer), "%.2f ms  %d fps   CPU %.2f ms   GPU %.2f ms",
+            frameMs, (frameMs > 0.0) ? (int)(1000.0 / frameMs + 0.5) : 0, frame.cpuMs, frame.gpuMs);
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+        cursor += line;
+
+        drawGraph(text, left, cursor, PERF_HUD_WIDTH - 16.0f);
+        cursor += PERF_HUD_GRAPH_HEIGHT + 6.0f;
+
+        text.addText("pass", left, cursor, PERF_HUD_TEXT_SIZE, GREY);
+        text.addText("CPU ms", left + 220.0f, cursor, PERF_HUD_TEXT_SIZE, GREY);
+        text.addText("GPU ms", left + 320.0f, cursor, PERF_HUD_TEXT_SIZE, GREY);
+        cursor += line;
+        for (int i = 0; i < frame.passCount; i++)
+        {
+            const Profiler::Pass& pass = frame.passes[i];
+            text.addText(pass.name, left + 12.0f * pass.depth, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+            snprintf(buffer, sizeof(buffer), "%.3f", pass.cpuMs);
+            text.addText(buffer, left + 220.0f, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+            snprintf(buffer, sizeof(buffer), "%.3f", pass.gpuMs);
+            text.addText(buffer, left + 320.0f, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+            cursor += line;
+        }
+
+        snprintf(buffer, sizeof(buffer), "draws %llu   dispatches %llu",
+            (unsigned long long)frame.drawCalls, (unsigned long long)frame.dispatches);
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+        cursor += line;
+
+        snprintf(buffer, sizeof(buffer), "primitives %.3fM submitted, %.3fM after tessellation",
+            frame.primitivesSubmitted / 1000000.0, frame.primitivesGenerated / 1000000.0);
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+        cursor += line;
+
+        int length = snprintf(buffer, sizeof(buffer), "memory:");
+        if (memoryKnown)
+            length += snprintf(buffer + length, sizeof(buffer) - length, " textures %.1f MB, buffers %.1f MB",
+                textureBytes / (1024.0 * 1024.0), bufferBytes / (1024.0 * 1024.0));
+        if (vidmemTotalKB > 0)
+            length += snprintf(buffer + length, sizeof(buffer) - length, "%s VRAM %d / %d MB", memoryKnown ? "," : "",
+                (vidmemTotalKB - vidmemAvailableKB) / 1024, vidmemTotalKB / 1024);
+        if (!memoryKnown && vidmemTotalKB == 0)
+            snprintf(buffer + length, sizeof(buffer) - length, " n/a");
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+        cursor += line;
+
+        uint64_t simulationAllocations = Memory::GetFrameAllocations(MEMORY_LOOP_SIMULATION);
+        uint64_t renderAllocations = Memory::GetFrameAllocations(MEMORY_LOOP_RENDER);
+        snprintf(buffer, sizeof(buffer), "heap allocations/frame: simulation %llu, render %llu",
+            (unsigned long long)simulationAllocations, (unsigned long long)renderAllocations);
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, simulationAllocations + renderAllocations > 0 ? YELLOW : WHITE);
+        cursor += line;
+
+        if (outputWidth > 0)
+            snprintf(buffer, sizeof(buffer), "resolution %dx%d of %dx%d (%d%%)", renderWidth, renderHeight, outputWidth, outputHeight,
+                (int)(100.0f * renderHeight / outputHeight + 0.5f));
+        else
+            snprintf(buffer, sizeof(buffer), "resolution n/a");
+        text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, WHITE);
+        cursor += line;
+
+        for (size_t i = 0; i < toggles.size(); i++)
+        {
+            snprintf(buffer, sizeof(buffer), "[%c] %s", toggles[i].key, toggles[i].label);
+            text.addText(buffer, left, cursor, PERF_HUD_TEXT_SIZE, GREY);
+            text.addText(*toggles[i].value ? "on" : "off", left + 220.0f, cursor, PERF_HUD_TEXT_SIZE, *toggles[i].value ? GREEN : WHITE);
+            cursor += line;
+        }
+    }
+
+private:
+    struct Toggle
+    {
+        const char* label;
+        char key;
+        const bool* value;
+    };
+
+    inline static const glm::vec4 WHITE = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    inline static const glm::vec4 GREY = glm::vec4(0.7f, 0.7f, 0.7f, 1.0f);
+    inline static const glm::vec4 GREEN = glm::vec4(0.3f, 0.9f, 0.3f, 1.0f);
+    inline static const glm::vec4 YELLOW = glm::vec4(0.95f, 0.85f, 0.2f, 1.0f);
+    inline static const glm::vec4 RED = glm::vec4(0.95f, 0.25f, 0.2f, 1.0f);
+
+    bool visible;
+    bool memoryKnown;
+    std::vector<Toggle> toggles;
+    uint64_t textureBytes;
+    uint64_t bufferBytes;
+    GLint vidmemTotalKB;
+    GLint vidmemAvailableKB;
+    int renderWidth;
+    int renderHeight;
+    int outputWidth;
+    int outputHeight;
+
+    // one bar per frame, green under 60 Hz, yellow under 30 Hz, red above
+    void drawGraph(TextRenderer& text, float x, float y, float width) const
+    {
+        text.addRect(x, y, width, PERF_HUD_GRAPH_HEIGHT, glm::vec4(1.0f, 1.0f, 1.0f, 0.08f));
+
+        float barWidth = width / PROFILER_HISTORY;
+        for (int i = 0; i < PROFILER_HISTORY; i++)
+        {
+            float ms = (float)Profiler::GetHistory(i);
+            if (ms <= 0.0f)
+                continue;
+            float barHeight = glm::min(ms / PERF_HUD_GRAPH_MAX_MS, 1.0f) * PERF_HUD_GRAPH_HEIGHT;
+            const glm::vec4& color = (ms < 16.7f) ? GREEN : (ms < 33.3f) ? YELLOW : RED;
+            text.addRect(x + i * barWidth, y + PERF_HUD_GRAPH_HEIGHT - barHeight, barWidth, barHeight, color);
+        }
+
+        // 16.7 ms reference line
+        float target = y + PERF_HUD_GRAPH_HEIGHT * (1.0f - 16.7f / PERF_HUD_GRAPH_MAX_MS);
+        text.addRect(x, target, width, 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+    }
+
+    // dedicated video memory from the driver where it is exposed (NVIDIA only)
+    void queryVideoMemory()
+    {
+        if (!GLEW_NVX_gpu_memory_info || Profiler::GetFrameCount() % PERF_HUD_VIDMEM_INTERVAL != 0)
+            return;
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, &vidmemTotalKB);
+        glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &vidmemAvailableKB);
+    }
+};
+
+
+#endif
@@ -0,0 +1,234 @@
+#pragma once
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <memory>
+#include <math.h>
+
+#include "Shader.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+// image/texture units and SSBO bindings shared with shaders/post_process.comp,
+// luminance_histogram.comp and auto_exposure.comp
+#define POST_PROCESS_OUTPUT_IMAGE 0
+#define POST_PROCESS_SCENE_UNIT 0
+#define POST_PROCESS_DEPTH_UNIT 1
+#define POST_PROCESS_CLOUDS_UNIT 2
+#define POST_PROCESS_HISTOGRAM_BINDING 3
+#define POST_PROCESS_EXPOSURE_BINDING 4
+#define POST_PROCESS_TILE 16
+
+#define POST_PROCESS_HISTOGRAM_BINS 256
+// log2 luminance range the histogram covers
+#define POST_PROCESS_MIN_LOG_LUMINANCE -10.0f
+#define POST_PROCESS_MAX_LOG_LUMINANCE 6.0f
+// average luminance is mapped to this middle grey, within the exposure limits
+#define POST_PROCESS_EXPOSURE_KEY 0.18f
+#define POST_PROCESS_MIN_EXPOSURE 0.03f
+#define POST_PROCESS_MAX_EXPOSURE 32.0f
+
+struct PostSettings
+{
+    float exposure;         // manual, or compensation on top of the adapted value
+    float gamma;            // 1 leaves the values as they are
+    float vignette;         // falloff exponent, 0 disables
+    bool tonemap;           // ACES
+    bool autoExposure;
+    float adaptationRate;   // 1/s
+    bool resetAdaptation;   // jump straight to the target (cuts, repeatable captures)
+};
+
+// The scene renders into an offscreen R11G11B10F color + depth target
+// instead of the window. The targets are allocated at the output size and
+// the scene may cover only a render size region at their origin, so a
+// dynamic resolution change never reallocates. resolve() turns it into the
+// LDR output:
+// - auto exposure stays on the GPU: luminance_histogram.comp bins the log
+//   luminance with shared-memory atomics in one dispatch, auto_exposure.comp
+//   (one workgroup) reduces it and eases the adapted exposure in an SSBO;
+//   nothing is read back.
+// - post_process.comp composites clouds over the sky, applies exposure,
+//   tonemapping, gamma and vignette in a single read and write per pixel,
+//   and the result is blitted to the output framebuffer.
+// Depth and clouds are sampled where they live, there is no copy pass. A
+// temporally upsampled color (see TemporalUpsampler) can stand in for the
+// scene color; without one a smaller render region is stretched nearest.
+class PostProcess
+{
+public:
+    PostProcess()
+        : shader("shaders/post_process.comp", { { "TILE_SIZE", 0, POST_PROCESS_TILE }, { "TILE_SIZE", 1, POST_PROCESS_TILE } }),
+          histogramShader("shaders/luminance_histogram.comp"),
+          exposureShader("shaders/auto_exposure.comp"), noClouds(GL_TEXTURE_2D), width(0), height(0),
+          renderWidth(0), renderHeight(0)
+    {
+        // transparent 1x1 until a cloud pass provides a texture
+        const GLubyte transparent[4] = { 0, 0, 0, 0 };
+        noClouds.storage2D(1, GL_RGBA8, 1, 1);
+        noClouds.subImage2D(0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+
+        // adapted luminance 0 makes the first frame snap to its target
+        const GLuint zeroBins[POST_PROCESS_HISTOGRAM_BINS] = {};
+        const GLfloat initialExposure[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+        histogram.storage(sizeof(zeroBins), zeroBins, 0);
+        exposure.storage(sizeof(initialExposure), initialExposure, 0);
+    }
+
+    PostProcess(const PostProcess&) = delete;
+    PostProcess& operator=(const PostProcess&) = delete;
+
+    // bind the scene target, (re)created when the output size changed;
+    // the scene renders into renderWidth x renderHeight of it
+    // ------------------------------------------------------------------------
+    void beginScene(int outputWidth, int outputHeight, int sceneWidth, int sceneHeight)
+    {
+        renderWidth = sceneWidth < outputWidth ? sceneWidth : outputWidth;
+        renderHeight = sceneHeight < outputHeight ? sceneHeight : outputHeight;
+        if (!framebuffer || outputWidth != width || outputHeight != height)
+        {
+            GPU_MEMORY_OWNER("scene targets");
+            width = outputWidth;
+            height = outputHeight;
+            color.reset(new GLTexture(GL_TEXTURE_2D));
+            color->storage2D(1, GL_R11F_G11F_B10F, width, height);
+            color->parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            color->parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            color->parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            color->parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            depth.reset(new GLTexture(GL_TEXTURE_2D));
+            depth->storage2D(1, GL_DEPTH_COMPONENT32F, width, height);
+            depth->parameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            depth->parameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            framebuffer.reset(new GLFramebuffer());
+            framebuffer->texture(GL_COLOR_ATTACHMENT0, *color);
+            framebuffer->texture(GL_DEPTH_ATTACHMENT, *depth);
+            framebuffer->isComplete();
+
+            output.reset(new GLTexture(GL_TEXTURE_2D));
+            output->storage2D(1, GL_RGBA8, width, height);
+            outputFramebuffer.reset(new GLFramebuffer());
+            outputFramebuffer->texture(GL_COLOR_ATTACHMENT0, *output);
+            outputFramebuffer->isComplete();
+        }
+        GLState::BindFramebuffer(framebuffer->ID);
+    }
+    // post-process the scene target and copy it to target, which is left bound;
+    // upsampled replaces the scene color with an output sized texture
+    // ------------------------------------------------------------------------
+    void resolve(const PostSettings& settings, float deltaTime, GLuint target, GLuint clouds = 0, GLuint upsampled = 0)
+    {
+        int sceneWidth = upsampled != 0 ? width : renderWidth;
+        int sceneHeight = upsampled != 0 ? height : renderHeight;
+        GLState::BindTextureUnit(POST_PROCESS_SCENE_UNIT, upsampled != 0 ? upsampled : color->ID);
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, POST_PROCESS_HISTOGRAM_BINDING, histogram.ID);
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, POST_PROCESS_EXPOSURE_BINDING, exposure.ID);
+
+        if (settings.autoExposure)
+        {
+            float range = POST_PROCESS_MAX_LOG_LUMINANCE - POST_PROCESS_MIN_LOG_LUMINANCE;
+
+            // half resolution, each thread averages a 2x2 block with one bilinear fetch
+            histogramShader.use();
+            glProgramUniform2i(histogramShader.ID, glGetUniformLocation(histogramShader.ID, "u_resolution"), sceneWidth, sceneHeight);
+            histogramShader.setFloat("u_minLogLuminance", POST_PROCESS_MIN_LOG_LUMINANCE);
+            histogramShader.setFloat("u_inverseLogLuminanceRange", 1.0f / range);
+            int blocksX = (sceneWidth + 1) / 2;
+            int blocksY = (sceneHeight + 1) / 2;
+            glDispatchCompute((blocksX + POST_PROCESS_TILE - 1) / POST_PROCESS_TILE, (blocksY + POST_PROCESS_TILE - 1) / POST_PROCESS_TILE, 1);
+            Profiler::CountDispatch();
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+            exposureShader.use();
+            exposureShader.setFloat("u_minLogLuminance", POST_PROCESS_MIN_LOG_LUMINANCE);
+            exposureShader.setFloat("u_logLuminanceRange", range);
+            exposureShader.setFloat("u_adaptation", settings.resetAdaptation ? 1.0f : 1.0f - expf(-deltaTime * settings.adaptationRate));
+            exposureShader.setFloat("u_key", POST_PROCESS_EXPOSURE_KEY);
+            exposureShader.setFloat("u_minExposure", POST_PROCESS_MIN_EXPOSURE);
+            exposureShader.setFloat("u_maxExposure", POST_PROCESS_MAX_EXPOSURE);
+            glDispatchCompute(1, 1, 1);
+            Profiler::CountDispatch();
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        shader.use();
+        glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_resolution"), width, height);
+        glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_sceneSize"), sceneWidth, sceneHeight);
+        glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_depthSize"), renderWidth, renderHeight);
+        shader.setFloat("u_exposure", settings.exposure);
+        shader.setBool("u_autoExposure", settings.autoExposure);
+        shader.setFloat("u_gamma", settings.gamma);
+        shader.setFloat("u_vignette", settings.vignette);
+        shader.setBool("u_tonemap", settings.tonemap);
+
+        glBindImageTexture(POST_PROCESS_OUTPUT_IMAGE, output->ID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        GLState::BindTextureUnit(POST_PROCESS_DEPTH_UNIT, depth->ID);
+        GLState::BindTextureUnit(POST_PROCESS_CLOUDS_UNIT, clouds != 0 ? clouds : noClouds.ID);
+
+        glDispatchCompute((width + POST_PROCESS_TILE - 1) / POST_PROCESS_TILE, (height + POST_PROCESS_TILE - 1) / POST_PROCESS_TILE, 1);
+        Profiler::CountDispatch();
+        glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+        glBlitNamedFramebuffer(outputFramebuffer->ID, target, 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        GLState::BindFramebuffer(target);
+    }
+    // scene depth of the last frame, e.g. for occlusion culling; valid in the render region
+    // ------------------------------------------------------------------------
+    GLuint getDepthTexture() const
+    {
+        return depth ? depth->ID : 0;
+    }
+    // HDR scene color, valid in the render region
+    // ------------------------------------------------------------------------
+    GLuint getColorTexture() const
+    {
+        return color ? color->ID : 0;
+    }
+    // output size, the targets' allocated size
+    // ------------------------------------------------------------------------
+    int getWidth() const
+    {
+        return width;
+    }
+    // ------------------------------------------------------------------------
+    int getHeight() const
+    {
+        return height;
+    }
+    // region of the targets the scene renders into
+    // ------------------------------------------------------------------------
+    int getRenderWidth() const
+    {
+        return renderWidth;
+    }
+    // ------------------------------------------------------------------------
+    int getRenderHeight() const
+    {
+        return renderHeight;
+    }
+
+private:
+    Shader shader;
+    Shader histogramShader;
+    Shader exposureShader;
+    GLTexture noClouds;
+    GLBuffer histogram;     // POST_PROCESS_HISTOGRAM_BINS counts, cleared by auto_exposure.comp
+    GLBuffer exposure;      // adapted luminance, exposure, frame average, padding
+    std::unique_ptr<GLTexture> color;
+    std::unique_ptr<GLTexture> depth;
+    std::unique_ptr<GLFramebuffer> framebuffer;
+    std::unique_ptr<GLTexture> output;
+    std::unique_ptr<GLFramebuffer> outputFramebuffer;
+    int width;
+    int height;
+    int renderWidth;
+    int renderHeight;
+};
+
+
+#endif
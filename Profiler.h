@@ -0,0 +1,256 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <chrono>
+#include <stdint.h>
+
+#include "Memory.h"
+
+#define PROFILER_MAX_PASSES 16
+#define PROFILER_MAX_DEPTH 8
+#define PROFILER_FRAME_LATENCY 4    // GPU results are read back this many frames later
+#define PROFILER_HISTORY 240
+
+// Per-frame CPU and GPU timings for named (nestable) passes, plus draw call
+// and primitive counts. GPU times come from timestamp queries kept in a ring
+// of PROFILER_FRAME_LATENCY frames and are only read once available, so the
+// profiler never stalls the pipeline; a frame's numbers are published
+// together when its queries come back. Pass names are kept by pointer and
+// must be string literals.
+class Profiler
+{
+public:
+    struct Pass
+    {
+        const char* name;
+        int depth;
+        double cpuMs;
+        double gpuMs;
+    };
+
+    struct Frame
+    {
+        Pass passes[PROFILER_MAX_PASSES];
+        int passCount;
+        double cpuMs;               // BeginFrame to EndFrame on this thread
+        double gpuMs;               // first to last command of the frame on the GPU
+        uint64_t drawCalls;
+        uint64_t dispatches;
+        uint64_t primitivesSubmitted;   // before tessellation
+        uint64_t primitivesGenerated;   // after tessellation/geometry, what the rasterizer sees
+    };
+
+    // needs a current GL context
+    // ------------------------------------------------------------------------
+    static void Init()
+    {
+        for (int i = 0; i < PROFILER_FRAME_LATENCY; i++)
+        {
+            Slot& slot = slots[i];
+            glCreateQueries(GL_TIMESTAMP, SLOT_TIMESTAMPS, slot.timestamps);
+            glCreateQueries(GL_PRIMITIVES_SUBMITTED, 1, &slot.submittedQuery);
+            glCreateQueries(GL_PRIMITIVES_GENERATED, 1, &slot.generatedQuery);
+            slot.pending = false;
+        }
+        initialized = true;
+    }
+    // ------------------------------------------------------------------------
+    static void Shutdown()
+    {
+        if (!initialized)
+            return;
+        for (int i = 0; i < PROFILER_FRAME_LATENCY; i++)
+        {
+            glDeleteQueries(SLOT_TIMESTAMPS, slots[i].timestamps);
+            glDeleteQueries(1, &slots[i].submittedQuery);
+            glDeleteQueries(1, &slots[i].generatedQuery);
+        }
+        initialized = false;
+    }
+    // ------------------------------------------------------------------------
+    static void BeginFrame()
+    {
+        Clock::time_point now = Clock::now();
+        if (frameCount > 0)
+        {
+            history[historyHead] = std::chrono::duration<double, std::milli>(now - frameStart).count();
+            historyHead = (historyHead + 1) % PROFILER_HISTORY;
+        }
+        frameStart = now;
+
+        Slot& slot = slots[frameCount % PROFILER_FRAME_LATENCY];
+        if (slot.pending)
+            collect(slot);
+
+        slot.frame.passCount = 0;
+        slot.frame.drawCalls = 0;
+        slot.frame.dispatches = 0;
+        slot.queryCount = 0;
+        depth = 0;
+        overflow = 0;
+        inFrame = initialized;
+        if (!inFrame)
+            return;
+
+        glQueryCounter(slot.timestamps[slot.queryCount++], GL_TIMESTAMP);
+        glBeginQuery(GL_PRIMITIVES_SUBMITTED, slot.submittedQuery);
+        glBeginQuery(GL_PRIMITIVES_GENERATED, slot.generatedQuery);
+    }
+    // ------------------------------------------------------------------------
+    static void EndFrame()
+    {
+        if (!inFrame)
+            return;
+        overflow = 0;
+        while (depth > 0)
+            EndPass();
+
+        Slot& slot = slots[frameCount % PROFILER_FRAME_LATENCY];
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        glEndQuery(GL_PRIMITIVES_SUBMITTED);
+        slot.frameEndQuery = slot.queryCount;
+        glQueryCounter(slot.timestamps[slot.queryCount++], GL_TIMESTAMP);
+        slot.frame.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+        slot.pending = true;
+
+        inFrame = false;
+        frameCount++;
+    }
+    // ------------------------------------------------------------------------
+    static void BeginPass(const char* name)
+    {
+        Slot& slot = slots[frameCount % PROFILER_FRAME_LATENCY];
+        if (!inFrame || slot.frame.passCount >= PROFILER_MAX_PASSES || depth >= PROFILER_MAX_DEPTH)
+        {
+            overflow++;
+            return;
+        }
+
+        int index = slot.frame.passCount++;
+        Pass& pass = slot.frame.passes[index];
+        pass.name = name;
+        pass.depth = depth;
+        pass.gpuMs = 0.0;
+        slot.passQueries[index] = slot.queryCount;
+        glQueryCounter(slot.timestamps[slot.queryCount++], GL_TIMESTAMP);
+
+        stack[depth] = index;
+        passStart[depth] = Clock::now();
+        depth++;
+    }
+    // ------------------------------------------------------------------------
+    static void EndPass()
+    {
+        if (overflow > 0)
+        {
+            overflow--;
+            return;
+        }
+        if (!inFrame || depth == 0)
+            return;
+
+        depth--;
+        Slot& slot = slots[frameCount % PROFILER_FRAME_LATENCY];
+        int index = stack[depth];
+        slot.frame.passes[index].cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - passStart[depth]).count();
+        slot.passEndQueries[index] = slot.queryCount;
+        glQueryCounter(slot.timestamps[slot.queryCount++], GL_TIMESTAMP);
+    }
+    // ------------------------------------------------------------------------
+    static void CountDraw(uint64_t calls = 1) noexcept
+    {
+        slots[frameCount % PROFILER_FRAME_LATENCY].frame.drawCalls += calls;
+    }
+    // ------------------------------------------------------------------------
+    static void CountDispatch(uint64_t calls = 1) noexcept
+    {
+        slots[frameCount % PROFILER_FRAME_LATENCY].frame.dispatches += calls;
+    }
+
+    // most recent frame whose GPU results have come back
+    [[nodiscard]] static const Frame& GetLatest() noexcept { return latest; }
+    // frame to frame times in milliseconds, oldest first for i = 0 .. PROFILER_HISTORY - 1
+    [[nodiscard]] static double GetHistory(int i) noexcept { return history[(historyHead + i) % PROFILER_HISTORY]; }
+    [[nodiscard]] static uint64_t GetFrameCount() noexcept { return frameCount; }
+
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // frame begin/end plus a begin/end pair per pass
+    static constexpr int SLOT_TIMESTAMPS = 2 + 2 * PROFILER_MAX_PASSES;
+
+    struct Slot
+    {
+        GLuint timestamps[SLOT_TIMESTAMPS];
+        GLuint submittedQuery;
+        GLuint generatedQuery;
+        int queryCount;
+        int frameEndQuery;
+        int passQueries[PROFILER_MAX_PASSES];
+        int passEndQueries[PROFILER_MAX_PASSES];
+        bool pending;
+        Frame frame;
+    };
+
+    inline static Slot slots[PROFILER_FRAME_LATENCY] = {};
+    inline static Frame latest = {};
+    inline static double history[PROFILER_HISTORY] = {};
+    inline static int historyHead = 0;
+    inline static uint64_t frameCount = 0;
+    inline static bool initialized = false;
+    inline static bool inFrame = false;
+    inline static int depth = 0;
+    inline static int overflow = 0;
+    inline static int stack[PROFILER_MAX_DEPTH] = {};
+    inline static Clock::time_point passStart[PROFILER_MAX_DEPTH];
+    inline static Clock::time_point frameStart;
+
+    // publish a finished frame; if the GPU is still behind after
+    // PROFILER_FRAME_LATENCY frames its numbers are dropped rather than waited for
+    static void collect(Slot& slot)
+    {
+        slot.pending = false;
+        for (int i = 0; i < slot.queryCount; i++)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(slot.timestamps[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+        }
+
+        GLuint64 times[SLOT_TIMESTAMPS];
+        for (int i = 0; i < slot.queryCount; i++)
+            glGetQueryObjectui64v(slot.timestamps[i], GL_QUERY_RESULT, &times[i]);
+        glGetQueryObjectui64v(slot.submittedQuery, GL_QUERY_RESULT, &slot.frame.primitivesSubmitted);
+        glGetQueryObjectui64v(slot.generatedQuery, GL_QUERY_RESULT, &slot.frame.primitivesGenerated);
+
+        slot.frame.gpuMs = (times[slot.frameEndQuery] - times[0]) / 1000000.0;
+        for (int i = 0; i < slot.frame.passCount; i++)
+            slot.frame.passes[i].gpuMs = (times[slot.passEndQueries[i]] - times[slot.passQueries[i]]) / 1000000.0;
+        latest = slot.frame;
+    }
+};
+
+
+// scoped pass, closes itself at the end of the block; heap allocations
+// inside it are charged to the pass (see Memory)
+struct ProfileScope
+{
+    explicit ProfileScope(const char* name) : previousSubsystem(Memory::SetSubsystem(name)) { Profiler::BeginPass(name); }
+    ~ProfileScope() { Profiler::EndPass(); Memory::SetSubsystem(previousSubsystem); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    const char* previousSubsystem;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+
+#endif
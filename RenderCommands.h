@@ -0,0 +1,240 @@
+#pragma once
+#ifndef RENDER_COMMANDS_H
+#define RENDER_COMMANDS_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <type_traits>
+#include <string.h>
+#include <stdint.h>
+
+enum RenderCommandType
+{
+    RENDER_COMMAND_BEGIN_VIEW,      // RenderViewCommand, clears and sets the frame uniforms
+    RENDER_COMMAND_SET_INSTANCES,   // RenderInstancesCommand, replaces the cube instances
+    RENDER_COMMAND_UPDATE_WEATHER,  // RenderWeatherCommand, time-sliced cloud noise generation
+    RENDER_COMMAND_DRAW_CUBES,      // RenderCubesCommand
+    RENDER_COMMAND_DRAW_MESH,       // RenderMeshCommand
+    RENDER_COMMAND_DRAW_VEGETATION, // RenderVegetationCommand, scatters and draws the grass
+    RENDER_COMMAND_DEPTH_PASS,      // RenderDepthPassCommand, depth prepass and Hi-Z transitions
+    RENDER_COMMAND_POST_PROCESS,    // RenderPostCommand, resolves the scene to the output
+    RENDER_COMMAND_DRAW_OVERLAY,    // RenderOverlayCommand
+    RENDER_COMMAND_DEBUG,           // RenderDebugCommand
+    RENDER_COMMAND_CAPTURE,         // RenderCaptureCommand
+    RENDER_COMMAND_GOLDEN           // RenderGoldenCommand
+};
+
+#define RENDER_COMMAND_ALIGNMENT 16
+
+#define RENDER_DEBUG_TOGGLE_HUD 0x1u
+#define RENDER_DEBUG_MEMORY_REPORT 0x2u
+#define RENDER_DEBUG_STATE_COUNTERS 0x4u
+
+#define RENDER_CAPTURE_PATH_LENGTH 260
+#define RENDER_GOLDEN_NAME_LENGTH 64
+
+struct RenderViewCommand
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;          // computed once by the camera, not per pass
+    glm::mat4 inverseProjection;
+    glm::vec4 cameraPosition;
+    float time;
+    float deltaTime;
+    int viewportWidth;
+    int viewportHeight;
+    bool dynamicResolution;         // render scale from GPU timings, jittered and temporally upsampled
+};
+
+// matrices live in the list's matrix block, see allocateMatrices()
+struct RenderInstancesCommand
+{
+    uint32_t firstMatrix;
+    uint32_t count;
+};
+
+struct RenderWeatherCommand
+{
+    glm::vec4 seed;         // xyz, used when regenerate is set
+    float budgetMs;         // GPU time this frame's generation may take
+    bool regenerate;        // start a new weather map, faded in once complete
+};
+
+struct RenderCubesCommand
+{
+    bool gpuDriven;
+    bool cpuCulling;
+};
+
+struct RenderMeshCommand
+{
+    glm::mat4 model;
+};
+
+enum RenderDepthPass
+{
+    RENDER_DEPTH_PREPASS,   // following draws write depth only
+    RENDER_DEPTH_SHADING,   // following draws shade against the prepass depth (GL_EQUAL, no writes)
+    RENDER_DEPTH_OPAQUE_DONE,   // opaque geometry done: default depth state
+    RENDER_DEPTH_PYRAMID        // the same, then build the Hi-Z pyramid
+};
+
+struct RenderDepthPassCommand
+{
+    RenderDepthPass pass;
+};
+
+// terrain the grass grows on, see TerrainShape
+struct RenderVegetationCommand
+{
+    glm::vec4 seed;
+    float baseHeight;
+    float dispFactor;
+    float frequency;
+    int octaves;
+    float power;
+    float grassCoverage;
+    float shoreHeight;
+};
+
+struct RenderPostCommand
+{
+    float exposure;
+    float gamma;
+    float vignette;
+    bool tonemap;
+    bool autoExposure;
+    float adaptationRate;
+    bool resetAdaptation;
+};
+
+// toggle states shown in the HUD, as the simulation saw them this frame
+struct RenderOverlayCommand
+{
+    bool stressScene;
+    bool gpuDriven;
+    bool cpuCulling;
+    bool vegetation;
+    bool depthPrepass;
+    bool dynamicResolution;
+};
+
+struct RenderDebugCommand
+{
+    uint32_t actions;   // RENDER_DEBUG_* bits
+};
+
+enum RenderCaptureAction
+{
+    RENDER_CAPTURE_SCREENSHOT,      // this frame to path as a PNG
+    RENDER_CAPTURE_START,           // every frame from this one on, see FrameCapture
+    RENDER_CAPTURE_STOP
+};
+
+struct RenderCaptureCommand
+{
+    RenderCaptureAction action;
+    bool video;                     // RENDER_CAPTURE_START: Y4M stream rather than a PNG sequence
+    int framesPerSecond;
+    char path[RENDER_CAPTURE_PATH_LENGTH];
+};
+
+// brackets a golden image scenario frame, see GoldenTest
+struct RenderGoldenCommand
+{
+    bool begin;                     // before the view: render offscreen; after it: finish the frame
+    bool timed;
+    bool compare;
+    int width;
+    int height;
+    char name[RENDER_GOLDEN_NAME_LENGTH];
+};
+
+// One frame's worth of rendering, recorded by the simulation and replayed by
+// the render thread. Commands say what to draw, never how: no GL names or
+// calls, only plain data copied into a byte stream, so recording is cheap
+// and the list can be handed across threads as-is. Bulk data (instance
+// transforms) goes into a separate matrix block and is referenced by index.
+class RenderCommandList
+{
+public:
+    struct Header
+    {
+        RenderCommandType type;
+        uint32_t size;      // payload bytes, padded to RENDER_COMMAND_ALIGNMENT
+    };
+
+    // ------------------------------------------------------------------------
+    void reset()
+    {
+        data.clear();
+        matrices.clear();
+        count = 0;
+    }
+    // ------------------------------------------------------------------------
+    template <typename T>
+    void push(RenderCommandType type, const T& command)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "render commands are copied as raw bytes");
+
+        Header header;
+        header.type = type;
+        header.size = (uint32_t)align(sizeof(T));
+
+        size_t offset = data.size();
+        data.resize(offset + align(sizeof(Header)) + header.size);
+        memcpy(&data[offset], &header, sizeof(Header));
+        memcpy(&data[offset + align(sizeof(Header))], &command, sizeof(T));
+        count++;
+    }
+    // room for count matrices the caller fills in, stays valid until the next allocate
+    // ------------------------------------------------------------------------
+    glm::mat4* allocateMatrices(size_t matrixCount, uint32_t& firstMatrix)
+    {
+        firstMatrix = (uint32_t)matrices.size();
+        matrices.resize(matrices.size() + matrixCount);
+        return matrices.data() + firstMatrix;
+    }
+    // ------------------------------------------------------------------------
+    const glm::mat4* getMatrices(uint32_t firstMatrix) const
+    {
+        return matrices.data() + firstMatrix;
+    }
+    // walk the commands in order: while (list.next(cursor, header, payload))
+    // ------------------------------------------------------------------------
+    bool next(size_t& cursor, Header& header, const void*& payload) const
+    {
+        if (cursor >= data.size())
+            return false;
+        memcpy(&header, &data[cursor], sizeof(Header));
+        payload = &data[cursor + align(sizeof(Header))];
+        cursor += align(sizeof(Header)) + header.size;
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    int getCount() const
+    {
+        return count;
+    }
+    // ------------------------------------------------------------------------
+    size_t getSize() const
+    {
+        return data.size() + matrices.size() * sizeof(glm::mat4);
+    }
+
+private:
+    std::vector<uint8_t> data;
+    std::vector<glm::mat4> matrices;
+    int count = 0;
+
+    static size_t align(size_t size)
+    {
+        return (size + RENDER_COMMAND_ALIGNMENT - 1) & ~(size_t)(RENDER_COMMAND_ALIGNMENT - 1);
+    }
+};
+
+
+#endif
@@ -0,0 +1,124 @@
+#include "RenderThread.h"
+
+#include "Logger.h"
+
+RenderThread::RenderThread()
+    : deviceContext(NULL), renderingContext(NULL), submittedFirst(0), submittedCount(0), running(false), stopping(false),
+      frameIndex(0)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+bool RenderThread::start(HDC dc, HGLRC context, InitFunction init, FrameFunction frame, ShutdownFunction shutdown)
+{
+    deviceContext = dc;
+    renderingContext = context;
+    frameFunction = frame;
+    shutdownFunction = shutdown;
+
+    // a context can only be current on one thread
+    wglMakeCurrent(NULL, NULL);
+
+    bool initResult = false;
+    bool initDone = false;
+    stopping = false;
+    thread = std::thread(&RenderThread::threadMain, this, init, &initResult, &initDone);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    signal.wait(lock, [&] { return initDone; });
+    running = initResult;
+    lock.unlock();
+
+    if (!initResult)
+    {
+        thread.join();
+        LOG_ERROR("Render thread initialization failed");
+    }
+    return initResult;
+}
+
+void RenderThread::stop()
+{
+    if (!running)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    signal.notify_all();
+    thread.join();
+    running = false;
+}
+
+FramePacket* RenderThread::beginPacket()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    signal.wait(lock, [this] { return packets.getFree() > 0; });
+    FramePacket* packet = packets.acquire();
+    lock.unlock();
+    packet->frameIndex = frameIndex++;
+    packet->commands.reset();
+    return packet;
+}
+
+void RenderThread::submitPacket(FramePacket* packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // every packet came from the pool, the ring cannot overflow
+        submitted[(submittedFirst + submittedCount) % RENDER_THREAD_PACKETS] = packet;
+        submittedCount++;
+    }
+    signal.notify_all();
+}
+
+void RenderThread::threadMain(InitFunction init, bool* initResult, bool* initDone)
+{
+    bool initialized = wglMakeCurrent(deviceContext, renderingContext) != FALSE;
+    if (!initialized)
+        LOG_ERROR("Render thread could not make the GL context current");
+    else
+        initialized = init();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        *initResult = initialized;
+        *initDone = true;
+    }
+    signal.notify_all();
+    if (!initialized)
+    {
+        wglMakeCurrent(NULL, NULL);
+        return;
+    }
+
+    for (;;)
+    {
+        FramePacket* packet = NULL;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            signal.wait(lock, [this] { return stopping || submittedCount > 0; });
+            if (submittedCount == 0)
+                break;
+            packet = submitted[submittedFirst];
+            submittedFirst = (submittedFirst + 1) % RENDER_THREAD_PACKETS;
+            submittedCount--;
+        }
+
+        frameFunction(*packet);
+        SwapBuffers(deviceContext);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            packets.release(packet);
+        }
+        signal.notify_all();
+    }
+
+    shutdownFunction();
+    wglMakeCurrent(NULL, NULL);
+}
@@ -0,0 +1,73 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <windows.h>
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "RenderCommands.h"
+#include "Memory.h"
+
+// packets in flight: one being recorded while the other is submitted
+#define RENDER_THREAD_PACKETS 2
+
+struct FramePacket
+{
+    uint64_t frameIndex;
+    RenderCommandList commands;
+};
+
+// Owns the GL context on a thread of its own. The main thread keeps the
+// window and the simulation, records a FramePacket per frame and submits
+// it; the render thread replays packets in order and presents. Packets come
+// from a fixed pool, so simulation runs at most one frame ahead and blocks
+// in beginPacket() rather than queueing latency when rendering falls behind.
+class RenderThread
+{
+public:
+    typedef std::function<bool()> InitFunction;
+    typedef std::function<void(const FramePacket&)> FrameFunction;
+    typedef std::function<void()> ShutdownFunction;
+
+    RenderThread();
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // releases the context from this thread, makes it current on the render
+    // thread and runs init there; returns once init finished, false if it failed
+    bool start(HDC deviceContext, HGLRC renderingContext, InitFunction init, FrameFunction frame, ShutdownFunction shutdown);
+    // renders every submitted packet, runs shutdown and joins
+    void stop();
+
+    // free packet to record into, waits while all packets are in flight
+    FramePacket* beginPacket();
+    void submitPacket(FramePacket* packet);
+
+private:
+    HDC deviceContext;
+    HGLRC renderingContext;
+    FrameFunction frameFunction;
+    ShutdownFunction shutdownFunction;
+
+    std::thread thread;
+    // both only touched under the mutex; neither allocates once constructed
+    FixedPool<FramePacket, RENDER_THREAD_PACKETS> packets;
+    FramePacket* submitted[RENDER_THREAD_PACKETS];     // ring in submission order
+    int submittedFirst;
+    int submittedCount;
+    std::mutex mutex;
+    std::condition_variable signal;
+    bool running;
+    bool stopping;
+    uint64_t frameIndex;
+
+    void threadMain(InitFunction init, bool* initResult, bool* initDone);
+};
+
+#endif // RENDERTHREAD_H
@@ -6,141 +6,315 @@
 #include <gl/GL.h>
 #include <glm/glm.hpp>
 
+#include "GLState.h"
+#include "MappedFile.h"
+#include "Logger.h"
+#include "ShaderCooker.h"
+
+#include <atomic>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <vector>
+#include <initializer_list>
 #include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+// room for the #define lines of a shader's constants
+#define SHADER_MAX_DEFINES 512
+
+// A tunable of a shader (workgroup size, step or octave count). Loaded from
+// SPIR-V it is the specialization constant with constant_id = id; compiled
+// from source it becomes "#define name value" after the #version line.
+// Shaders declare both forms under #ifdef GL_SPIRV, see post_process.comp.
+struct ShaderConstant
+{
+    const char* name;
+    GLuint id;
+    int value;
+};
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
-    // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+    // constructor generates the shader on the fly: from the cooked SPIR-V when
+    // the driver takes it (see ShaderCooker), otherwise from the GLSL source
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, std::initializer_list<ShaderConstant> constants = {})
+    {
+        const Stage stages[2] = { { GL_VERTEX_SHADER, vertexPath, "VERTEX" }, { GL_FRAGMENT_SHADER, fragmentPath, "FRAGMENT" } };
+        ID = build(stages, 2, constants);
     }
-    // activate the shader
+    // constructor for a compute-only program
+    // ------------------------------------------------------------------------
+    explicit Shader(const char* computePath, std::initializer_list<ShaderConstant> constants = {})
+    {
+        const Stage stages[1] = { { GL_COMPUTE_SHADER, computePath, "COMPUTE" } };
+        ID = build(stages, 1, constants);
+    }
+    ~Shader()
+    {
+        GLState::ProgramDeleted(ID);
+        glDeleteProgram(ID);
+    }
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+    // activate the shader, skipped when it is already current
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        GLState::UseProgram(ID);
     }
-    // utility uniform functions
+    // utility uniform functions, set on this program whether it is bound or not;
+    // the name goes straight to GL, no string is built per call
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glProgramUniform1i(ID, glGetUniformLocation(ID, name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glProgramUniform1i(ID, glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glProgramUniform1f(ID, glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glProgramUniform2fv(ID, glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glProgramUniform2f(ID, glGetUniformLocation(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glProgramUniform3fv(ID, glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glProgramUniform3f(ID, glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glProgramUniform4fv(ID, glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glProgramUniform4f(ID, glGetUniformLocation(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glProgramUniformMatrix2fv(ID, glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glProgramUniformMatrix3fv(ID, glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glProgramUniformMatrix4fv(ID, glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    struct Stage
+    {
+        GLenum type;
+        const char* path;
+        const char* label;
+    };
+
+    // SPIR-V programs whose uniforms came back without names (e.g. on Mesa)
+    // cannot be driven through glGetUniformLocation; after the first one
+    // every program compiles from source; programs are built on the render and
+    // the startup loader thread at once
+    inline static std::atomic<bool> spirvNamesMissing{ false };
+
+    static unsigned int build(const Stage* stages, int count, const std::vector<ShaderConstant>& constants)
+    {
+        if (GLEW_VERSION_4_6 && !spirvNamesMissing)
+        {
+            unsigned int program = buildSpirv(stages, count, constants);
+            if (program != 0)
+                return program;
+        }
+        return buildSource(stages, count, constants);
+    }
+    // 0 when a module is missing or stale or the driver rejects it; modules are
+    // only opened here, cooking them is the "cook shaders" startup phase's job
+    // ------------------------------------------------------------------------
+    static unsigned int buildSpirv(const Stage* stages, int count, const std::vector<ShaderConstant>& constants)
+    {
+        unsigned int program = glCreateProgram();
+        for (int i = 0; i < count; i++)
+        {
+            const char* path = stages[i].path;
+            MappedFile module;
+            if (ShaderCooker::needsCook(path) || !module.open(ShaderCooker::spirvPath(path).c_str()) ||
+                module.size() < 5 * sizeof(uint32_t))
+            {
+                glDeleteProgram(program);
+                return 0;
+            }
+
+            // only the constants this stage declares, an unknown id fails specialization
+            std::vector<GLuint> ids;
+            std::vector<GLuint> values;
+            std::vector<GLuint> declared = specializationIds(module);
+            for (size_t c = 0; c < constants.size(); c++)
+            {
+                for (size_t d = 0; d < declared.size(); d++)
+                {
+                    if (declared[d] == constants[c].id)
+                    {
+                        ids.push_back(constants[c].id);
+                        values.push_back((GLuint)constants[c].value);
+                        break;
+                    }
+                }
+            }
+
+            unsigned int shader = glCreateShader(stages[i].type);
+            glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, module.data(), (GLsizei)module.size());
+            glSpecializeShader(shader, "main", (GLuint)ids.size(), ids.data(), values.data());
+            GLint success = GL_FALSE;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                GLchar infoLog[1024] = "";
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                LOG_INFO("SPIR-V %s rejected, compiling from source: %s", path, infoLog);
+                glDeleteShader(shader);
+                glDeleteProgram(program);
+                return 0;
+            }
+            glAttachShader(program, shader);
+            // flagged for deletion, freed with the program
+            glDeleteShader(shader);
+        }
+
+        glLinkProgram(program);
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            GLchar infoLog[1024] = "";
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            LOG_INFO("SPIR-V program with %s failed to link, compiling from source: %s", stages[0].path, infoLog);
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        GLint uniforms = 0;
+        glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniforms);
+        if (uniforms > 0)
+        {
+            const GLenum property = GL_NAME_LENGTH;
+            GLint nameLength = 0;
+            glGetProgramResourceiv(program, GL_UNIFORM, 0, 1, &property, 1, NULL, &nameLength);
+            if (nameLength <= 1)
+            {
+                LOG_INFO("Driver does not reflect SPIR-V uniform names, shaders compile from source");
+                spirvNamesMissing = true;
+                glDeleteProgram(program);
+                return 0;
+            }
+        }
+        return program;
+    }
+    // ------------------------------------------------------------------------
+    static unsigned int buildSource(const Stage* stages, int count, const std::vector<ShaderConstant>& constants)
+    {
+        unsigned int program = glCreateProgram();
+        for (int i = 0; i < count; i++)
+        {
+            // 1. map the source, GL copies it straight from the file's pages
+            MappedFile file;
+            if (!file.open(stages[i].path))
+                LOG_ERROR("Shader %s could not be read", stages[i].path);
+            const char* code = file.data() ? (const char*)file.data() : "";
+            GLint codeLength = (GLint)file.size();
+            // 2. tunables as #defines, they must come after #version; a name
+            // feeding several constant ids (x/y/z of a workgroup) is defined once
+            char defines[SHADER_MAX_DEFINES] = "";
+            int definesLength = 0;
+            for (size_t c = 0; c < constants.size(); c++)
+            {
+                char define[64];
+                snprintf(define, sizeof(define), "#define %s ", constants[c].name);
+                if (strstr(defines, define) != NULL)
+                    continue;
+                int written = snprintf(defines + definesLength, sizeof(defines) - definesLength, "%s%d\n", define, constants[c].value);
+                if (written < 0 || written >= (int)sizeof(defines) - definesLength)
+                {
+                    // no half written #define, the shader keeps its own default
+                    defines[definesLength] = '\0';
+                    LOG_ERROR("Shader %s: defines from %s on do not fit in SHADER_MAX_DEFINES", stages[i].path, constants[c].name);
+                    break;
+                }
+                definesLength += written;
+            }
+            // source up to the end of the #version line, the defines, the rest
+            // (the mapping has no terminating zero, every search is bounded)
+            GLint split = 0;
+            for (GLint c = 0; c + 8 <= codeLength; c++)
+            {
+                if (memcmp(code + c, "#version", 8) == 0)
+                {
+                    const char* lineEnd = (const char*)memchr(code + c, '\n', codeLength - c);
+                    if (lineEnd)
+                        split = (GLint)(lineEnd + 1 - code);
+                    break;
+                }
+            }
+            const GLchar* parts[3] = { code, defines, code + split };
+            const GLint lengths[3] = { split, definesLength, codeLength - split };
+            // 3. compile
+            unsigned int shader = glCreateShader(stages[i].type);
+            glShaderSource(shader, 3, parts, lengths);
+            glCompileShader(shader);
+            checkCompileErrors(shader, stages[i].label);
+            glAttachShader(program, shader);
+            // flagged for deletion, freed with the program
+            glDeleteShader(shader);
+        }
+        glLinkProgram(program);
+        checkCompileErrors(program, "PROGRAM");
+        return program;
+    }
+    // SpecId decorations of a SPIR-V module: OpDecorate <target> SpecId <id>
+    // ------------------------------------------------------------------------
+    static std::vector<GLuint> specializationIds(const MappedFile& module)
+    {
+        const uint32_t OP_DECORATE = 71;
+        const uint32_t DECORATION_SPEC_ID = 1;
+        std::vector<GLuint> ids;
+        const uint32_t* words = (const uint32_t*)module.data();
+        size_t wordCount = (size_t)(module.size() / sizeof(uint32_t));
+        // five word header, then instructions with their word count in the high half
+        for (size_t i = 5; i < wordCount; )
+        {
+            uint32_t length = words[i] >> 16;
+            if (length == 0)
+                break;
+            if ((words[i] & 0xFFFFu) == OP_DECORATE && length >= 4 && i + 3 < wordCount && words[i + 2] == DECORATION_SPEC_ID)
+                ids.push_back(words[i + 3]);
+            i += length;
+        }
+        return ids;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static void checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -0,0 +1,175 @@
+#include "ShaderCooker.h"
+
+#include <windows.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "MappedFile.h"
+
+#define SHADER_COMPILER "glslangValidator.exe"
+
+// glslang stage names; .vs/.fs/.tcs/.tes are not extensions it recognizes itself
+struct ShaderStageExtension
+{
+    const char* extension;
+    const char* stage;
+};
+static const ShaderStageExtension stageExtensions[] = {
+    { ".vs", "vert" }, { ".vert", "vert" },
+    { ".fs", "frag" }, { ".frag", "frag" },
+    { ".tcs", "tesc" }, { ".tes", "tese" },
+    { ".geom", "geom" }, { ".comp", "comp" },
+};
+
+static const char* stageOf(const char* source)
+{
+    const char* extension = strrchr(source, '.');
+    if (extension == NULL)
+        return NULL;
+    for (size_t i = 0; i < sizeof(stageExtensions) / sizeof(stageExtensions[0]); i++)
+        if (_stricmp(extension, stageExtensions[i].extension) == 0)
+            return stageExtensions[i].stage;
+    return NULL;
+}
+
+static std::string findCompiler()
+{
+    char path[MAX_PATH];
+    DWORD length = GetEnvironmentVariableA("VULKAN_SDK", path, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+    {
+        std::string candidate = std::string(path) + "\\Bin\\" SHADER_COMPILER;
+        if (GetFileAttributesA(candidate.c_str()) != INVALID_FILE_ATTRIBUTES)
+            return candidate;
+    }
+    if (SearchPathA(NULL, SHADER_COMPILER, NULL, MAX_PATH, path, NULL) > 0)
+        return path;
+    return std::string();
+}
+
+static const std::string& compilerPath()
+{
+    static const std::string compiler = findCompiler();
+    return compiler;
+}
+
+// starts the compiler on one shader, writing to <module>.tmp; its diagnostics
+// go to the shared console. NULL when the process could not be started.
+static HANDLE launchCompiler(const char* source, const std::string& temporary)
+{
+    // -G: SPIR-V with OpenGL semantics (GL_SPIRV defined), names are kept for reflection
+    std::string commandLine = "\"" + compilerPath() + "\" -G --auto-map-locations --auto-map-bindings -S " + stageOf(source) +
+        " -o \"" + temporary + "\" \"" + source + "\"";
+    std::vector<char> mutableCommandLine(commandLine.begin(), commandLine.end());
+    mutableCommandLine.push_back('\0');
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION process = {};
+    if (!CreateProcessA(NULL, mutableCommandLine.data(), NULL, NULL, FALSE, 0, NULL, NULL, &startup, &process))
+        return NULL;
+    CloseHandle(process.hThread);
+    return process.hProcess;
+}
+
+// waits for the compiler and moves its output in place
+static bool finishCompiler(HANDLE process, const char* source, const std::string& temporary)
+{
+    WaitForSingleObject(process, INFINITE);
+    DWORD exitCode = 1;
+    GetExitCodeProcess(process, &exitCode);
+    CloseHandle(process);
+
+    std::string output = ShaderCooker::spirvPath(source);
+    if (exitCode != 0 || !MoveFileExA(temporary.c_str(), output.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        LOG_ERROR("ShaderCooker: %s failed to compile (exit code %lu), it will load from source", source, (unsigned long)exitCode);
+        DeleteFileA(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string ShaderCooker::spirvPath(const char* source)
+{
+    return std::string(source) + ".spv";
+}
+
+bool ShaderCooker::isAvailable()
+{
+    return !compilerPath().empty();
+}
+
+bool ShaderCooker::needsCook(const char* source)
+{
+    uint64_t cooked, original;
+    if (!MappedFile::LastWriteTime(spirvPath(source).c_str(), cooked))
+        return true;
+    return MappedFile::LastWriteTime(source, original) && original > cooked;
+}
+
+bool ShaderCooker::cook(const char* source)
+{
+    if (!isAvailable() || stageOf(source) == NULL)
+        return false;
+
+    double startTime = Timer::getAppRunTime();
+    std::string temporary = spirvPath(source) + ".tmp";
+    HANDLE process = launchCompiler(source, temporary);
+    if (process == NULL)
+    {
+        LOG_ERROR("ShaderCooker: cannot start %s", compilerPath().c_str());
+        return false;
+    }
+    if (!finishCompiler(process, source, temporary))
+        return false;
+
+    LOG_INFO("ShaderCooker: %s in %.2f seconds", spirvPath(source).c_str(), Timer::getAppRunTime() - startTime);
+    return true;
+}
+
+bool ShaderCooker::cookAll(const char* const* sources, int count)
+{
+    if (!isAvailable())
+    {
+        LOG_INFO("ShaderCooker: %s not found (VULKAN_SDK, PATH), shaders load from GLSL source", SHADER_COMPILER);
+        return true;
+    }
+
+    double startTime = Timer::getAppRunTime();
+    std::vector<std::string> stale;
+    for (int i = 0; i < count; i++)
+        if (stageOf(sources[i]) != NULL && needsCook(sources[i]))
+            stale.push_back(sources[i]);
+
+    // one compiler process per core at a time
+    size_t batch = std::thread::hardware_concurrency();
+    if (batch == 0)
+        batch = 4;
+    bool cooked = true;
+    for (size_t first = 0; first < stale.size(); first += batch)
+    {
+        size_t last = (first + batch < stale.size()) ? first + batch : stale.size();
+        std::vector<HANDLE> processes(last - first, (HANDLE)NULL);
+        for (size_t i = first; i < last; i++)
+        {
+            processes[i - first] = launchCompiler(stale[i].c_str(), spirvPath(stale[i].c_str()) + ".tmp");
+            if (processes[i - first] == NULL)
+            {
+                LOG_ERROR("ShaderCooker: cannot start %s", compilerPath().c_str());
+                cooked = false;
+            }
+        }
+        for (size_t i = first; i < last; i++)
+            if (processes[i - first] != NULL)
+                cooked = finishCompiler(processes[i - first], stale[i].c_str(), spirvPath(stale[i].c_str()) + ".tmp") && cooked;
+    }
+
+    LOG_INFO("ShaderCooker: %d of %d shaders were stale, compiled to SPIR-V in %.2f seconds", (int)stale.size(), count, Timer::getAppRunTime() - startTime);
+    return cooked;
+}
@@ -0,0 +1,27 @@
+#ifndef SHADERCOOKER_H
+#define SHADERCOOKER_H
+
+#include <string>
+
+// Offline shader step: compiles GLSL from shaders/ to SPIR-V for OpenGL
+// (<source>.spv next to it) with glslangValidator from the Vulkan SDK,
+// uniform locations and bindings assigned automatically so the sources need
+// no changes. Shader loads the SPIR-V and specializes it at runtime, and
+// falls back to the GLSL source when a module is missing or stale, the
+// driver lacks GL_ARB_gl_spirv or the compiler is not installed. Runs from
+// "OGL.exe -cook" and the startup "cook shaders" phase, never from Shader:
+// the compiler is a process of its own and no GL thread waits on it.
+class ShaderCooker
+{
+public:
+    static bool cook(const char* source);
+    // every source in the list that needs it, the compiler runs once per core
+    static bool cookAll(const char* const* sources, int count);
+    // module missing or older than the source
+    static bool needsCook(const char* source);
+    // glslangValidator found in %VULKAN_SDK%\Bin or on the PATH, looked up once
+    static bool isAvailable();
+    static std::string spirvPath(const char* source);
+};
+
+#endif // SHADERCOOKER_H
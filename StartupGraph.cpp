@@ -0,0 +1,324 @@
+#include "StartupGraph.h"
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <string.h>
+
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Timer.h"
+
+static const char* const laneNames[STARTUP_LANE_COUNT] = { "main", "gl", "loader", "cpu" };
+
+StartupGraph::StartupGraph()
+    : phaseCount(0), started(false), loaderAvailable(false)
+{
+}
+
+StartupGraph::~StartupGraph()
+{
+    if (loader.joinable())
+        loader.join();
+}
+
+int StartupGraph::add(const char* name, StartupLane lane, PhaseFunction function, std::initializer_list<int> dependencies)
+{
+    if (phaseCount >= STARTUP_MAX_PHASES)
+    {
+        LOG_ERROR("Startup phase %s dropped, STARTUP_MAX_PHASES is %d", name, STARTUP_MAX_PHASES);
+        return -1;
+    }
+
+    int index = phaseCount++;
+    Phase& phase = phases[index];
+    phase.name = name;
+    phase.lane = lane;
+    phase.function = function;
+    phase.dependencyCount = 0;
+    phase.state = PHASE_PENDING;
+    phase.skipped = false;
+    phase.start = 0.0;
+    phase.end = 0.0;
+    for (int dependency : dependencies)
+    {
+        if (dependency < 0 || dependency >= index)
+            continue;
+        if (phase.dependencyCount == STARTUP_MAX_DEPENDENCIES)
+        {
+            LOG_ERROR("Startup phase %s has more than %d dependencies", name, STARTUP_MAX_DEPENDENCIES);
+            break;
+        }
+        phase.dependencies[phase.dependencyCount++] = dependency;
+    }
+    return index;
+}
+
+void StartupGraph::start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    started = true;
+    propagateFailures();
+    dispatchReady();
+}
+
+bool StartupGraph::runLane(StartupLane lane)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        int index = -1;
+        if (claim(lane, index))
+        {
+            lock.unlock();
+            execute(index);
+            lock.lock();
+        }
+        else if (laneFinished(lane))
+            break;
+        else
+            signal.wait(lock);
+    }
+
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (laneOf(i) == lane && phases[i].state == PHASE_FAILED)
+            return false;
+    }
+    return true;
+}
+
+void StartupGraph::startLoader(HDC deviceContext, HGLRC context)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaderAvailable = context != NULL;
+    }
+    if (context == NULL)
+        return;
+
+    loader = std::thread([this, deviceContext, context]()
+    {
+        if (wglMakeCurrent(deviceContext, context) == FALSE)
+        {
+            LOG_ERROR("Startup loader context could not be made current");
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < phaseCount; i++)
+            {
+                if (phases[i].lane == STARTUP_LANE_LOADER && phases[i].state == PHASE_PENDING)
+                    phases[i].state = PHASE_FAILED;
+            }
+            propagateFailures();
+            dispatchReady();
+            signal.notify_all();
+        }
+        else
+        {
+            runLane(STARTUP_LANE_LOADER);
+            wglMakeCurrent(NULL, NULL);
+        }
+        wglDeleteContext(context);
+    });
+}
+
+bool StartupGraph::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    signal.wait(lock, [this]()
+    {
+        for (int i = 0; i < phaseCount; i++)
+        {
+            if (phases[i].state != PHASE_DONE && phases[i].state != PHASE_FAILED)
+                return false;
+        }
+        return true;
+    });
+
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (phases[i].state == PHASE_FAILED)
+            return false;
+    }
+    return true;
+}
+
+void StartupGraph::report(double firstFrameSeconds)
+{
+    if (loader.joinable())
+        loader.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // critical path: back from the phase that finished last
+    bool critical[STARTUP_MAX_PHASES] = {};
+    int last = -1;
+    double work = 0.0;
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (phases[i].state != PHASE_DONE)
+            continue;
+        work += phases[i].end - phases[i].start;
+        if (last < 0 || phases[i].end > phases[last].end)
+            last = i;
+    }
+    for (int i = last; i >= 0 && !critical[i]; i = blockerOf(i))
+        critical[i] = true;
+
+    double span = firstFrameSeconds > 0.0 ? firstFrameSeconds : (last >= 0 ? phases[last].end : 0.0);
+    LOG_INFO("Startup: first frame at %.1f ms, %.1f ms of phase work, * is the critical path", firstFrameSeconds * 1000.0, work * 1000.0);
+    LOG_INFO("  phase                  lane     start ms  length ms");
+    for (int i = 0; i < phaseCount; i++)
+    {
+        const Phase& phase = phases[i];
+        if (phase.state != PHASE_DONE)
+        {
+            LOG_INFO("  %-22s %-7s %s", phase.name, laneNames[laneOf(i)], phase.skipped ? "skipped" : "failed");
+            continue;
+        }
+
+        char bar[STARTUP_TIMELINE_COLUMNS + 1];
+        memset(bar, ' ', STARTUP_TIMELINE_COLUMNS);
+        bar[STARTUP_TIMELINE_COLUMNS] = '\0';
+        if (span > 0.0)
+        {
+            int from = (int)(phase.start / span * STARTUP_TIMELINE_COLUMNS);
+            int to = (int)(phase.end / span * STARTUP_TIMELINE_COLUMNS);
+            if (from > STARTUP_TIMELINE_COLUMNS - 1)
+                from = STARTUP_TIMELINE_COLUMNS - 1;
+            if (to > STARTUP_TIMELINE_COLUMNS)
+                to = STARTUP_TIMELINE_COLUMNS;
+            if (to <= from)
+                to = from + 1;
+            memset(bar + from, critical[i] ? '#' : '=', to - from);
+        }
+        LOG_INFO("%c %-22s %-7s %9.1f %10.1f |%s|", critical[i] ? '*' : ' ', phase.name, laneNames[laneOf(i)],
+            phase.start * 1000.0, (phase.end - phase.start) * 1000.0, bar);
+    }
+}
+
+bool StartupGraph::isReady(int index) const
+{
+    const Phase& phase = phases[index];
+    if (phase.state != PHASE_PENDING)
+        return false;
+    for (int i = 0; i < phase.dependencyCount; i++)
+    {
+        if (phases[phase.dependencies[i]].state != PHASE_DONE)
+            return false;
+    }
+    return true;
+}
+
+StartupLane StartupGraph::laneOf(int index) const
+{
+    StartupLane lane = phases[index].lane;
+    return lane == STARTUP_LANE_LOADER && !loaderAvailable ? STARTUP_LANE_GL : lane;
+}
+
+// first ready phase of the lane in the order they were added
+bool StartupGraph::claim(StartupLane lane, int& index)
+{
+    propagateFailures();
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (laneOf(i) == lane && isReady(i))
+        {
+            phases[i].state = PHASE_RUNNING;
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool StartupGraph::laneFinished(StartupLane lane) const
+{
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (laneOf(i) == lane && phases[i].state != PHASE_DONE && phases[i].state != PHASE_FAILED)
+            return false;
+    }
+    return true;
+}
+
+// dependencies come first, so one pass in order reaches every dependent
+void StartupGraph::propagateFailures()
+{
+    for (int i = 0; i < phaseCount; i++)
+    {
+        Phase& phase = phases[i];
+        if (phase.state != PHASE_PENDING)
+            continue;
+        for (int d = 0; d < phase.dependencyCount; d++)
+        {
+            if (phases[phase.dependencies[d]].state == PHASE_FAILED)
+            {
+                phase.state = PHASE_FAILED;
+                phase.skipped = true;
+                break;
+            }
+        }
+    }
+}
+
+// CPU phases run as background jobs: idle workers pick them up and nothing
+// waiting on a frame job ends up inside a cook
+void StartupGraph::dispatchReady()
+{
+    if (!started)
+        return;
+    for (int i = 0; i < phaseCount; i++)
+    {
+        if (phases[i].lane != STARTUP_LANE_CPU || !isReady(i))
+            continue;
+        phases[i].state = PHASE_QUEUED;
+        JobSystem::Run([this, i]() { execute(i); }, JOB_PRIORITY_BACKGROUND);
+    }
+}
+
+void StartupGraph::execute(int index)
+{
+    Phase& phase = phases[index];
+    double start = TIMER_NOW();
+    bool succeeded = phase.function();
+    // programs and uploads from the loader context are complete before anything depending on them runs
+    if (phase.lane == STARTUP_LANE_LOADER && laneOf(index) == STARTUP_LANE_LOADER)
+        glFinish();
+    double end = TIMER_NOW();
+    TIMER_RECORD(phase.name, start, end);
+    if (!succeeded)
+        LOG_ERROR("Startup phase %s failed", phase.name);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    phase.start = start;
+    phase.end = end;
+    phase.state = succeeded ? PHASE_DONE : PHASE_FAILED;
+    propagateFailures();
+    dispatchReady();
+    signal.notify_all();
+}
+
+// what held the phase up: the dependency or (outside the CPU lane) the
+// earlier phase of its thread that finished closest before it started
+int StartupGraph::blockerOf(int index) const
+{
+    const Phase& phase = phases[index];
+    int blocker = -1;
+    for (int d = 0; d < phase.dependencyCount; d++)
+    {
+        int dependency = phase.dependencies[d];
+        if (blocker < 0 || phases[dependency].end > phases[blocker].end)
+            blocker = dependency;
+    }
+    StartupLane lane = laneOf(index);
+    if (lane != STARTUP_LANE_CPU)
+    {
+        for (int i = 0; i < phaseCount; i++)
+        {
+            if (i == index || laneOf(i) != lane || phases[i].state != PHASE_DONE || phases[i].end > phase.start)
+                continue;
+            if (blocker < 0 || phases[i].end > phases[blocker].end)
+                blocker = i;
+        }
+    }
+    return blocker;
+}
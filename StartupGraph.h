@@ -0,0 +1,112 @@
+#ifndef STARTUPGRAPH_H
+#define STARTUPGRAPH_H
+
+#include <windows.h>
+
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#define STARTUP_MAX_PHASES 32
+#define STARTUP_MAX_DEPENDENCIES 8
+// width of the bars in the timeline report
+#define STARTUP_TIMELINE_COLUMNS 40
+
+enum StartupLane
+{
+    STARTUP_LANE_MAIN,      // the thread owning the window, WinMain
+    STARTUP_LANE_GL,        // the thread the main GL context is current on, the render thread
+    STARTUP_LANE_LOADER,    // a thread of its own on a context sharing objects with the main one:
+                            // programs, buffers and textures only, no VAOs, FBOs or GLState
+    STARTUP_LANE_CPU,       // job system workers, no GL
+    STARTUP_LANE_COUNT
+};
+
+// Startup as a graph of named phases instead of one serial chain. Each phase
+// names the lane it must run on and the phases it needs; CPU phases go to
+// the job system as soon as their dependencies finished, while the window,
+// the render thread and the loader each work through their own lane in
+// dependency order. So cooking and reading assets overlaps window and
+// context creation, and program builds on the loader context overlap the
+// render thread's buffer and texture setup. A phase that fails (returns
+// false) fails everything depending on it. Every phase is recorded in Timer
+// (TIMER_GET(name) works for it) and report() prints the timeline with the
+// critical path: starting from the last phase, the phase that held up each
+// one, be it a dependency or the previous phase on the same thread. Phase
+// names are kept by pointer and must be string literals.
+class StartupGraph
+{
+public:
+    typedef std::function<bool()> PhaseFunction;
+
+    StartupGraph();
+    // joins the loader thread
+    ~StartupGraph();
+
+    StartupGraph(const StartupGraph&) = delete;
+    StartupGraph& operator=(const StartupGraph&) = delete;
+
+    // dependencies are indices returned by earlier add() calls, -1 is ignored; returns the phase's index
+    int add(const char* name, StartupLane lane, PhaseFunction function, std::initializer_list<int> dependencies = {});
+    // hands the ready CPU phases to the job system; once every phase is added, after JobSystem::Init()
+    void start();
+    // runs the lane's phases on the calling thread as they become ready;
+    // false if one of them failed or was skipped
+    bool runLane(StartupLane lane);
+    // runs the loader lane on a thread of its own with context current (taken
+    // over, deleted when the lane is done); with NULL it runs on the GL lane.
+    // From the GL thread, before runLane(STARTUP_LANE_GL)
+    void startLoader(HDC deviceContext, HGLRC context);
+    // blocks until every phase finished or failed, false if any failed
+    bool wait();
+    // time to first frame, then every phase on the timeline to the log
+    void report(double firstFrameSeconds);
+
+private:
+    enum PhaseState
+    {
+        PHASE_PENDING,
+        PHASE_QUEUED,       // CPU phase handed to the job system
+        PHASE_RUNNING,
+        PHASE_DONE,
+        PHASE_FAILED
+    };
+
+    struct Phase
+    {
+        const char* name;
+        StartupLane lane;
+        PhaseFunction function;
+        int dependencies[STARTUP_MAX_DEPENDENCIES];
+        int dependencyCount;
+        PhaseState state;
+        bool skipped;       // failed because a dependency did
+        double start;       // Timer::GetTimeSinceStart()
+        double end;
+    };
+
+    Phase phases[STARTUP_MAX_PHASES];
+    int phaseCount;
+    bool started;
+    bool loaderAvailable;
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable signal;
+
+    // under the mutex
+    bool isReady(int index) const;
+    // the lane a phase really runs on, loader phases move to GL without a loader
+    StartupLane laneOf(int index) const;
+    bool claim(StartupLane lane, int& index);
+    bool laneFinished(StartupLane lane) const;
+    void propagateFailures();
+    void dispatchReady();
+
+    void execute(int index);
+    // the phase that finished last before index could start
+    int blockerOf(int index) const;
+};
+
+#endif // STARTUPGRAPH_H
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef STATIC_MESH_H
+#define STATIC_MESH_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Logger.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "CookedMesh.h"
+
+// attribute locations shared with shaders/mesh.vs
+#define MESH_ATTRIB_POSITION 0
+#define MESH_ATTRIB_NORMAL 1
+#define MESH_ATTRIB_TEXCOORD 2
+
+// Model loaded from a CookedMesh file. Vertex and index data go from the
+// mapped file straight into immutable buffers and are bound in their
+// quantized form; the position decode is folded into the model matrix.
+class StaticMesh
+{
+public:
+    GLVertexArray vao;
+    GLBuffer vbo;
+    GLBuffer ebo;
+
+    StaticMesh() : indexType(GL_UNSIGNED_SHORT), indexSize(2), decode(1.0f), boundsMin(0.0f), boundsMax(0.0f) {}
+
+    StaticMesh(const StaticMesh&) = delete;
+    StaticMesh& operator=(const StaticMesh&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool load(const char* path)
+    {
+        CookedMesh cooked;
+        if (!cooked.open(path))
+            return false;
+
+        const CookedMeshHeader& header = cooked.getHeader();
+        vbo.storage(header.vertexCount * sizeof(CookedMeshVertex), cooked.getVertices(), 0);
+        ebo.storage((GLsizeiptr)header.indexCount * header.indexSize, cooked.getIndices(), 0);
+        indexType = (header.indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        indexSize = header.indexSize;
+
+        vao.vertexBuffer(0, vbo, 0, sizeof(CookedMeshVertex));
+        vao.attrib(MESH_ATTRIB_POSITION, 4, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(CookedMeshVertex, position), 0);
+        vao.attrib(MESH_ATTRIB_NORMAL, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(CookedMeshVertex, normal), 0);
+        vao.attrib(MESH_ATTRIB_TEXCOORD, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(CookedMeshVertex, texCoord), 0);
+        vao.elementBuffer(ebo);
+
+        subsets.assign(cooked.getSubsets(), cooked.getSubsets() + header.subsetCount);
+        materials.assign(cooked.getMaterials(), cooked.getMaterials() + header.materialCount);
+        decode = cooked.getDecodeMatrix();
+        boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+        LOG_INFO("StaticMesh %s: %u vertices, %u triangles, %u subsets", path, header.vertexCount, header.indexCount / 3, header.subsetCount);
+        return true;
+    }
+    // one draw per subset, material color in uDiffuse
+    // ------------------------------------------------------------------------
+    void draw(const Shader& shader, const glm::mat4& model) const
+    {
+        shader.setMat4("uModel", model * decode);
+        shader.setMat3("uNormalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+
+        GLState::BindVertexArray(vao.ID);
+        for (size_t i = 0; i < subsets.size(); i++)
+        {
+            const CookedMeshMaterial& material = materials[subsets[i].material];
+            shader.setVec4("uDiffuse", glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.diffuse[3]));
+            glDrawElements(GL_TRIANGLES, subsets[i].indexCount, indexType, (const void*)((size_t)subsets[i].indexOffset * indexSize));
+        }
+        Profiler::CountDraw(subsets.size());
+    }
+    // ------------------------------------------------------------------------
+    glm::vec3 getBoundsMin() const
+    {
+        return boundsMin;
+    }
+    // ------------------------------------------------------------------------
+    glm::vec3 getBoundsMax() const
+    {
+        return boundsMax;
+    }
+
+private:
+    GLenum indexType;
+    uint32_t indexSize;
+    glm::mat4 decode;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    std::vector<CookedMeshSubset> subsets;
+    std::vector<CookedMeshMaterial> materials;
+};
+
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <string.h>
+#include <stdint.h>
+
+#include "Logger.h"
+#include "GLObjects.h"
+#include "GLState.h"
+
+#define STREAM_BUFFER_FRAMES_IN_FLIGHT 3
+
+// Persistently mapped ring buffer for data rewritten every frame (per-frame
+// uniforms, instance data, dynamic vertices). The storage is split into one
+// region per frame in flight; a frame bump-allocates from its region and
+// fences it at endFrame(), and the region is only reused once that fence has
+// signalled, so writes never race the GPU and the driver never has to copy
+// or orphan anything.
+class StreamBuffer
+{
+public:
+    struct Allocation
+    {
+        void* ptr;          // CPU write pointer, NULL when the region is full
+        GLintptr offset;    // offset inside buffer, for glBindBufferRange etc.
+        GLsizeiptr size;
+    };
+
+    GLBuffer buffer;
+
+    StreamBuffer(GLsizeiptr bytesPerFrame)
+        : regionSize(bytesPerFrame), mapped(NULL), frameIndex(0), head(0), stallCount(0)
+    {
+        for (int i = 0; i < STREAM_BUFFER_FRAMES_IN_FLIGHT; i++)
+            fences[i] = 0;
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        buffer.storage(regionSize * STREAM_BUFFER_FRAMES_IN_FLIGHT, NULL, flags);
+        mapped = (uint8_t*)buffer.mapRange(0, regionSize * STREAM_BUFFER_FRAMES_IN_FLIGHT, flags);
+
+        if (mapped == NULL)
+            LOG_ERROR("StreamBuffer: persistent map of %d bytes failed", (int)(regionSize * STREAM_BUFFER_FRAMES_IN_FLIGHT));
+    }
+
+    ~StreamBuffer()
+    {
+        for (int i = 0; i < STREAM_BUFFER_FRAMES_IN_FLIGHT; i++)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+        }
+        buffer.unmap();
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // wait until the GPU is done with this frame's region, then rewind it
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        GLsync fence = fences[frameIndex];
+        if (fence)
+        {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED)
+            {
+                // the GPU is more than STREAM_BUFFER_FRAMES_IN_FLIGHT frames behind
+                stallCount++;
+                do
+                {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                } while (result == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+            fences[frameIndex] = 0;
+        }
+        head = 0;
+    }
+    // bump-allocate from the current frame's region
+    // alignment must be a power of two (query GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    // or GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT for buffer-range bindings)
+    // ------------------------------------------------------------------------
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        Allocation allocation = { NULL, 0, size };
+        GLsizeiptr aligned = (head + alignment - 1) & ~(alignment - 1);
+        if (mapped == NULL || aligned + size > regionSize)
+        {
+            LOG_ERROR("StreamBuffer: frame region exhausted (%d of %d bytes requested)", (int)(aligned + size), (int)regionSize);
+            return allocation;
+        }
+
+        allocation.offset = frameIndex * regionSize + aligned;
+        allocation.ptr = mapped + allocation.offset;
+        head = aligned + size;
+        return allocation;
+    }
+    // allocate and copy in one go
+    // ------------------------------------------------------------------------
+    Allocation write(const void* data, GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        Allocation allocation = allocate(size, alignment);
+        if (allocation.ptr)
+            memcpy(allocation.ptr, data, size);
+        return allocation;
+    }
+    // fence everything submitted this frame and move to the next region
+    // ------------------------------------------------------------------------
+    void endFrame()
+    {
+        fences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameIndex = (frameIndex + 1) % STREAM_BUFFER_FRAMES_IN_FLIGHT;
+    }
+    // ------------------------------------------------------------------------
+    void bindRange(GLenum target, GLuint index, const Allocation& allocation) const
+    {
+        GLState::BindBufferRange(target, index, buffer.ID, allocation.offset, allocation.size);
+    }
+    // ------------------------------------------------------------------------
+    GLsizeiptr getUsedBytes() const
+    {
+        return head;
+    }
+    // number of beginFrame() calls that had to block on the GPU
+    // ------------------------------------------------------------------------
+    uint64_t getStallCount() const
+    {
+        return stallCount;
+    }
+
+private:
+    GLsizeiptr regionSize;
+    uint8_t* mapped;
+    GLsync fences[STREAM_BUFFER_FRAMES_IN_FLIGHT];
+    int frameIndex;
+    GLsizeiptr head;
+    uint64_t stallCount;
+};
+
+
+#endif
@@ -0,0 +1,159 @@
+#pragma once
+#ifndef TEMPORAL_UPSAMPLER_H
+#define TEMPORAL_UPSAMPLER_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+
+#include "Shader.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+// texture units and image binding shared with shaders/temporal_upsample.comp
+#define TEMPORAL_UPSAMPLE_COLOR_UNIT 0
+#define TEMPORAL_UPSAMPLE_DEPTH_UNIT 1
+#define TEMPORAL_UPSAMPLE_HISTORY_UNIT 2
+#define TEMPORAL_UPSAMPLE_OUTPUT_IMAGE 0
+#define TEMPORAL_UPSAMPLE_TILE 16
+
+// Halton(2, 3) jitter phases at full resolution; scaled by the pixel ratio
+// when upsampling so every output pixel still gets a sample nearby
+#define TEMPORAL_UPSAMPLE_PHASES 8
+#define TEMPORAL_UPSAMPLE_MAX_PHASES 32
+// share of the current frame in the history: far from any sample, right on one
+#define TEMPORAL_UPSAMPLE_MIN_BLEND 0.04f
+#define TEMPORAL_UPSAMPLE_MAX_BLEND 0.2f
+
+// Reconstructs the output resolution image from a scene rendered at a lower,
+// changing resolution. The projection is jittered by a sub-pixel offset
+// every frame; temporal_upsample.comp splats the render samples around each
+// output pixel with a Gaussian of their distance to it, reprojects the pixel
+// into the previous frame from the scene depth (camera motion only: there
+// are no motion vectors, the grass sway is left to the clamp), clamps that
+// history to the neighbourhood of the new samples in YCoCg and blends.
+// History is kept at output resolution in RGBA16F, so a change of render
+// scale keeps it; only a new output size starts over.
+class TemporalUpsampler
+{
+public:
+    TemporalUpsampler()
+        : shader("shaders/temporal_upsample.comp", { { "TILE_SIZE", 0, TEMPORAL_UPSAMPLE_TILE }, { "TILE_SIZE", 1, TEMPORAL_UPSAMPLE_TILE } }),
+          jitter(0.0f), previousViewProjection(1.0f), width(0), height(0), frameIndex(0), current(0), valid(false)
+    {
+    }
+
+    TemporalUpsampler(const TemporalUpsampler&) = delete;
+    TemporalUpsampler& operator=(const TemporalUpsampler&) = delete;
+
+    // next frame's jitter in render pixels, within +-0.5
+    // ------------------------------------------------------------------------
+    glm::vec2 nextJitter(int renderWidth, int renderHeight, int outputWidth, int outputHeight)
+    {
+        float ratio = ((float)outputWidth * outputHeight) / ((float)renderWidth * renderHeight);
+        int phases = (int)(TEMPORAL_UPSAMPLE_PHASES * ratio + 0.5f);
+        if (phases > TEMPORAL_UPSAMPLE_MAX_PHASES)
+            phases = TEMPORAL_UPSAMPLE_MAX_PHASES;
+        // Halton starts at index 1, 0 would sit on the pixel center every cycle
+        int index = (int)(frameIndex++ % (unsigned int)phases) + 1;
+        jitter = glm::vec2(Halton(index, 2) - 0.5f, Halton(index, 3) - 0.5f);
+        return jitter;
+    }
+    // projection shifted by a jitter in render pixels: the image moves by
+    // +offset, so texel t samples the scene at t + 0.5 - offset, which is what
+    // temporal_upsample.comp assumes for u_jitter. Right-handed projection,
+    // w = -z_view, hence the subtraction
+    // ------------------------------------------------------------------------
+    static glm::mat4 JitterProjection(const glm::mat4& projection, const glm::vec2& offset, int renderWidth, int renderHeight)
+    {
+        glm::mat4 jittered = projection;
+        jittered[2][0] -= offset.x * 2.0f / renderWidth;
+        jittered[2][1] -= offset.y * 2.0f / renderHeight;
+        return jittered;
+    }
+    // the next resolve starts from the current frame alone (cuts, toggling on)
+    // ------------------------------------------------------------------------
+    void invalidate()
+    {
+        valid = false;
+    }
+    // reconstruct into the output sized history, returns its texture (RGBA16F)
+    // viewProjection is the frame's unjittered matrix
+    // ------------------------------------------------------------------------
+    GLuint resolve(GLuint color, GLuint depth, int renderWidth, int renderHeight, int outputWidth, int outputHeight, const glm::mat4& viewProjection)
+    {
+        if (!history[0] || outputWidth != width || outputHeight != height)
+        {
+            GPU_MEMORY_OWNER("temporal history");
+            width = outputWidth;
+            height = outputHeight;
+            for (int i = 0; i < 2; i++)
+            {
+                history[i].reset(new GLTexture(GL_TEXTURE_2D));
+                history[i]->storage2D(1, GL_RGBA16F, width, height);
+                history[i]->parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                history[i]->parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                history[i]->parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                history[i]->parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            }
+            valid = false;
+        }
+
+        int previous = current;
+        current ^= 1;
+
+        shader.use();
+        glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_renderSize"), renderWidth, renderHeight);
+        glProgramUniform2i(shader.ID, glGetUniformLocation(shader.ID, "u_outputSize"), width, height);
+        shader.setVec2("u_jitter", jitter);
+        // current clip space straight to the previous frame's
+        shader.setMat4("u_reprojection", previousViewProjection * glm::inverse(viewProjection));
+        shader.setBool("u_reset", !valid);
+        shader.setFloat("u_minBlend", TEMPORAL_UPSAMPLE_MIN_BLEND);
+        shader.setFloat("u_maxBlend", TEMPORAL_UPSAMPLE_MAX_BLEND);
+
+        GLState::BindTextureUnit(TEMPORAL_UPSAMPLE_COLOR_UNIT, color);
+        GLState::BindTextureUnit(TEMPORAL_UPSAMPLE_DEPTH_UNIT, depth);
+        GLState::BindTextureUnit(TEMPORAL_UPSAMPLE_HISTORY_UNIT, history[previous]->ID);
+        glBindImageTexture(TEMPORAL_UPSAMPLE_OUTPUT_IMAGE, history[current]->ID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        glDispatchCompute((width + TEMPORAL_UPSAMPLE_TILE - 1) / TEMPORAL_UPSAMPLE_TILE, (height + TEMPORAL_UPSAMPLE_TILE - 1) / TEMPORAL_UPSAMPLE_TILE, 1);
+        Profiler::CountDispatch();
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        previousViewProjection = viewProjection;
+        valid = true;
+        return history[current]->ID;
+    }
+
+private:
+    Shader shader;
+    std::unique_ptr<GLTexture> history[2];     // ping-pong, current is the one written last
+    glm::vec2 jitter;
+    glm::mat4 previousViewProjection;
+    int width;
+    int height;
+    unsigned int frameIndex;
+    int current;
+    bool valid;
+
+    static float Halton(int index, int base)
+    {
+        float result = 0.0f;
+        float fraction = 1.0f;
+        while (index > 0)
+        {
+            fraction /= base;
+            result += fraction * (index % base);
+            index /= base;
+        }
+        return result;
+    }
+};
+
+
+#endif
@@ -0,0 +1,251 @@
+#pragma once
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+#include "Logger.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "Shader.h"
+#include "StreamBuffer.h"
+#include "CookedFont.h"
+
+// attribute locations shared with shaders/textShader.vert
+#define TEXT_ATTRIB_VERTEX 0
+#define TEXT_ATTRIB_COLOR 1
+
+#define TEXT_GLYPH_TABLE_SIZE 128
+
+// Screen-space text from a cooked glyph atlas. addText() lays strings out on
+// the CPU into one vertex list; flush() copies it into the frame's stream
+// buffer region and draws every string queued this frame with one call.
+// Coordinates are pixels with the origin at the top-left of the window.
+class TextRenderer
+{
+public:
+    struct TextVertex
+    {
+        float x, y;
+        float u, v;
+        uint32_t color;     // RGBA8
+    };
+
+    GLTexture atlas;
+    GLVertexArray vao;
+
+    TextRenderer()
+        : atlas(GL_TEXTURE_2D), shader("shaders/textShader.vert", "shaders/textShader.frag"),
+          solidTexCoord(-1.0f), pixelSize(1.0f), ascent(0.0f), lineHeight(0.0f), distanceField(false), lastGlyphCount(0)
+    {
+        for (int i = 0; i < TEXT_GLYPH_TABLE_SIZE; i++)
+            glyphTable[i] = -1;
+
+        vao.attrib(TEXT_ATTRIB_VERTEX, 4, GL_FLOAT, GL_FALSE, offsetof(TextVertex, x), 0);
+        vao.attrib(TEXT_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(TextVertex, color), 0);
+        shader.setInt("text", 0);
+    }
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    // ------------------------------------------------------------------------
+    bool load(const char* path)
+    {
+        CookedFont font;
+        if (!font.open(path))
+        {
+            LOG_ERROR("TextRenderer: cooked font %s could not be opened", path);
+            return false;
+        }
+
+        const CookedFontHeader& header = font.getHeader();
+        atlas.storage2D(1, GL_R8, header.atlasWidth, header.atlasHeight);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        atlas.subImage2D(0, 0, 0, header.atlasWidth, header.atlasHeight, GL_RED, GL_UNSIGNED_BYTE, font.getPixels());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        atlas.parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        atlas.parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        atlas.parameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        atlas.parameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glyphs.assign(font.getGlyphs(), font.getGlyphs() + header.glyphCount);
+        for (size_t i = 0; i < glyphs.size(); i++)
+        {
+            if (glyphs[i].codepoint < TEXT_GLYPH_TABLE_SIZE)
+                glyphTable[glyphs[i].codepoint] = (int)i;
+        }
+        // sample the middle of the solid block so filtering never reaches its border
+        int solid = glyphTable[COOKED_FONT_SOLID_GLYPH];
+        solidTexCoord = (solid < 0) ? glm::vec2(-1.0f) :
+            glm::vec2((glyphs[solid].x + glyphs[solid].width * 0.5f) / header.atlasWidth, (glyphs[solid].y + glyphs[solid].height * 0.5f) / header.atlasHeight);
+        atlasScale = glm::vec2(1.0f / header.atlasWidth, 1.0f / header.atlasHeight);
+        pixelSize = header.pixelSize;
+        ascent = header.ascent;
+        lineHeight = header.lineHeight;
+        distanceField = (header.flags & COOKED_FONT_DISTANCE_FIELD) != 0;
+        shader.setBool("uDistanceField", distanceField);
+
+        LOG_INFO("TextRenderer: %s, %u glyphs, %ux%u atlas", path, header.glyphCount, header.atlasWidth, header.atlasHeight);
+        return true;
+    }
+    // queue a string; (x, y) is the top-left of the first line, size the em height in pixels
+    // ------------------------------------------------------------------------
+    void addText(const char* text, float x, float y, float size, const glm::vec4& color)
+    {
+        if (glyphs.empty())
+            return;
+
+        float scale = size / pixelSize;
+        uint32_t packed = packColor(color);
+        float penX = x;
+        float baseline = floorf(y + ascent * scale + 0.5f);
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '\n')
+            {
+                penX = x;
+                baseline += floorf(lineHeight * scale + 0.5f);
+                continue;
+            }
+
+            const CookedFontGlyph* glyph = findGlyph((unsigned char)*c);
+            if (glyph == NULL)
+                continue;
+
+            if (glyph->width > 0)
+            {
+                float x0 = floorf(penX + 0.5f) + glyph->bearingX * scale;
+                float y0 = baseline - glyph->bearingY * scale;
+                float x1 = x0 + glyph->width * scale;
+                float y1 = y0 + glyph->height * scale;
+                float u0 = glyph->x * atlasScale.x;
+                float v0 = glyph->y * atlasScale.y;
+                float u1 = (glyph->x + glyph->width) * atlasScale.x;
+                float v1 = (glyph->y + glyph->height) * atlasScale.y;
+
+                TextVertex quad[6] = {
+                    { x0, y0, u0, v0, packed }, { x0, y1, u0, v1, packed }, { x1, y1, u1, v1, packed },
+                    { x0, y0, u0, v0, packed }, { x1, y1, u1, v1, packed }, { x1, y0, u1, v0, packed },
+                };
+                vertices.insert(vertices.end(), quad, quad + 6);
+            }
+            penX += glyph->advance * scale;
+        }
+    }
+    // filled rectangle in the same batch as the text, for panels and graphs
+    // ------------------------------------------------------------------------
+    void addRect(float x, float y, float width, float height, const glm::vec4& color)
+    {
+        if (solidTexCoord.x < 0.0f)
+            return;
+
+        uint32_t packed = packColor(color);
+        float u = solidTexCoord.x, v = solidTexCoord.y;
+        TextVertex quad[6] = {
+            { x, y, u, v, packed }, { x, y + height, u, v, packed }, { x + width, y + height, u, v, packed },
+            { x, y, u, v, packed }, { x + width, y + height, u, v, packed }, { x + width, y, u, v, packed },
+        };
+        vertices.insert(vertices.end(), quad, quad + 6);
+    }
+    // width of the longest line in pixels
+    // ------------------------------------------------------------------------
+    float measure(const char* text, float size) const
+    {
+        float scale = size / pixelSize;
+        float width = 0.0f, line = 0.0f;
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '\n')
+            {
+                width = (line > width) ? line : width;
+                line = 0.0f;
+                continue;
+            }
+            const CookedFontGlyph* glyph = findGlyph((unsigned char)*c);
+            if (glyph)
+                line += glyph->advance * scale;
+        }
+        return (line > width) ? line : width;
+    }
+    // ------------------------------------------------------------------------
+    float getLineHeight(float size) const
+    {
+        return lineHeight * size / pixelSize;
+    }
+    // draw everything queued since the last flush, blended over the frame
+    // ------------------------------------------------------------------------
+    void flush(StreamBuffer& stream, int width, int height)
+    {
+        lastGlyphCount = vertices.size() / 6;
+        if (vertices.empty())
+            return;
+
+        StreamBuffer::Allocation allocation = stream.write(vertices.data(), vertices.size() * sizeof(TextVertex));
+        size_t vertexCount = vertices.size();
+        vertices.clear();
+        if (allocation.ptr == NULL)
+            return;
+
+        vao.vertexBuffer(0, stream.buffer, allocation.offset, sizeof(TextVertex));
+        shader.use();
+        shader.setMat4("projection", glm::ortho(0.0f, (float)width, (float)height, 0.0f));
+        GLState::BindTextureUnit(0, atlas.ID);
+        GLState::BindVertexArray(vao.ID);
+
+        GLState::Disable(GL_DEPTH_TEST);
+        GLState::Enable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertexCount);
+        Profiler::CountDraw();
+        GLState::Disable(GL_BLEND);
+        GLState::Enable(GL_DEPTH_TEST);
+    }
+    // glyphs and rectangles drawn by the last flush
+    // ------------------------------------------------------------------------
+    size_t getGlyphCount() const
+    {
+        return lastGlyphCount;
+    }
+
+private:
+    Shader shader;
+    std::vector<CookedFontGlyph> glyphs;
+    int glyphTable[TEXT_GLYPH_TABLE_SIZE];
+    std::vector<TextVertex> vertices;
+    glm::vec2 atlasScale;
+    glm::vec2 solidTexCoord;
+    float pixelSize;
+    float ascent;
+    float lineHeight;
+    bool distanceField;
+    size_t lastGlyphCount;
+
+    const CookedFontGlyph* findGlyph(unsigned int codepoint) const
+    {
+        int index = (codepoint < TEXT_GLYPH_TABLE_SIZE) ? glyphTable[codepoint] : -1;
+        if (index < 0)
+            index = glyphTable['?'];
+        return (index < 0) ? NULL : &glyphs[index];
+    }
+
+    static uint32_t packColor(const glm::vec4& color)
+    {
+        uint32_t r = (uint32_t)(glm::clamp(color.x, 0.0f, 1.0f) * 255.0f + 0.5f);
+        uint32_t g = (uint32_t)(glm::clamp(color.y, 0.0f, 1.0f) * 255.0f + 0.5f);
+        uint32_t b = (uint32_t)(glm::clamp(color.z, 0.0f, 1.0f) * 255.0f + 0.5f);
+        uint32_t a = (uint32_t)(glm::clamp(color.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+};
+
+
+#endif
@@ -0,0 +1,160 @@
+#include "TextureCooker.h"
+
+#include <windows.h>
+#include <objbase.h>
+#include <GL/glew.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "Image.h"
+#include "CookedTexture.h"
+
+static GLenum glFormatFor(BlockFormat format, bool srgb)
+{
+    switch (format)
+    {
+    case BLOCK_BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BLOCK_BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool TextureCooker::needsCook(const TextureRecipe& recipe)
+{
+    uint64_t cooked;
+    if (!MappedFile::LastWriteTime(recipe.output.c_str(), cooked))
+        return true;
+
+    for (size_t i = 0; i < recipe.layers.size(); i++)
+    {
+        uint64_t source;
+        if (MappedFile::LastWriteTime(recipe.layers[i].c_str(), source) && source > cooked)
+            return true;
+    }
+
+    CookedTexture existing;
+    return !existing.open(recipe.output.c_str());
+}
+
+bool TextureCooker::cook(const TextureRecipe& recipe)
+{
+    double startTime = Timer::getAppRunTime();
+    size_t layerCount = recipe.layers.size();
+    if (layerCount == 0)
+        return false;
+
+    // decode every layer in parallel (WIC needs COM on each thread)
+    std::vector<Image> images(layerCount);
+    std::vector<char> loaded(layerCount, 0);
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < layerCount; i++)
+        {
+            threads.emplace_back([&, i]
+            {
+                CoInitializeEx(NULL, COINIT_MULTITHREADED);
+                loaded[i] = images[i].load(recipe.layers[i]);
+                CoUninitialize();
+            });
+        }
+        for (size_t i = 0; i < layerCount; i++)
+            threads[i].join();
+    }
+
+    for (size_t i = 0; i < layerCount; i++)
+    {
+        if (!loaded[i])
+        {
+            LOG_ERROR("TextureCooker: could not decode %s", recipe.layers[i].c_str());
+            return false;
+        }
+    }
+
+    // array layers share one size, the first layer's
+    int width = images[0].width;
+    int height = images[0].height;
+    for (size_t i = 1; i < layerCount; i++)
+    {
+        if (images[i].width != width || images[i].height != height)
+        {
+            LOG_INFO("TextureCooker: resampling %s from %dx%d to %dx%d", recipe.layers[i].c_str(), images[i].width, images[i].height, width, height);
+            images[i] = images[i].resized(width, height);
+        }
+    }
+
+    // mips + block compression, again one thread per layer
+    CookedTextureHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.internalFormat = glFormatFor(recipe.format, recipe.srgb);
+    header.blockBytes = (uint32_t)BlockBytes(recipe.format);
+    header.width = width;
+    header.height = height;
+    header.layers = (uint32_t)layerCount;
+
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+    levels = (levels < COOKED_TEXTURE_MAX_LEVELS) ? levels : COOKED_TEXTURE_MAX_LEVELS;
+    header.levels = levels;
+
+    uint64_t offset = (sizeof(CookedTextureHeader) + COOKED_TEXTURE_ALIGNMENT - 1) & ~(uint64_t)(COOKED_TEXTURE_ALIGNMENT - 1);
+    std::vector<size_t> layerLevelSize(levels);
+    for (int level = 0; level < levels; level++)
+    {
+        layerLevelSize[level] = CompressedLevelSize(recipe.format, images[0].levelWidth(level), images[0].levelHeight(level));
+        header.level[level].offset = offset;
+        header.level[level].size = (uint64_t)layerLevelSize[level] * layerCount;
+        offset = (offset + header.level[level].size + COOKED_TEXTURE_ALIGNMENT - 1) & ~(uint64_t)(COOKED_TEXTURE_ALIGNMENT - 1);
+    }
+
+    std::vector<uint8_t> fileData((size_t)offset, 0);
+    memcpy(fileData.data(), &header, sizeof(header));
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < layerCount; i++)
+        {
+            threads.emplace_back([&, i]
+            {
+                images[i].buildMipChain(recipe.srgb);
+                for (int level = 0; level < levels; level++)
+                {
+                    uint8_t* out = &fileData[(size_t)header.level[level].offset + layerLevelSize[level] * i];
+                    CompressLevel(recipe.format, images[i].level(level), images[i].levelWidth(level), images[i].levelHeight(level), out);
+                }
+            });
+        }
+        for (size_t i = 0; i < layerCount; i++)
+            threads[i].join();
+    }
+
+    // write next to the target and swap in, so a crash never leaves a torn file
+    std::string temporary = recipe.output + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == NULL)
+    {
+        LOG_ERROR("TextureCooker: cannot write %s", temporary.c_str());
+        return false;
+    }
+    bool written = fwrite(fileData.data(), 1, fileData.size(), file) == fileData.size();
+    fclose(file);
+    if (!written || !MoveFileExA(temporary.c_str(), recipe.output.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        LOG_ERROR("TextureCooker: failed to write %s", recipe.output.c_str());
+        DeleteFileA(temporary.c_str());
+        return false;
+    }
+
+    size_t uncompressed = 0;
+    for (size_t i = 0; i < layerCount; i++)
+        uncompressed += images[i].pixels.size();
+    LOG_INFO("TextureCooker: %s, %d layers %dx%d, %d KB (RGBA8 %d KB) in %.2f seconds", recipe.output.c_str(), (int)layerCount, width, height,
+        (int)(fileData.size() / 1024), (int)(uncompressed / 1024), Timer::getAppRunTime() - startTime);
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+
+#include <vector>
+#include <string>
+
+#include "BlockCompress.h"
+
+// One cooked texture array: source images in layer order, the block format
+// they are compressed to and where the result is written.
+struct TextureRecipe
+{
+    std::string output;
+    BlockFormat format;
+    bool srgb;
+    std::vector<std::string> layers;
+};
+
+// Offline asset step: decodes the recipe's source images, brings them to a
+// common size, builds mip chains and block-compresses every level into a
+// CookedTexture file. Layers are processed in parallel. Runs from "OGL.exe
+// -cook" or automatically at startup when a cooked file is missing or older
+// than any of its sources.
+class TextureCooker
+{
+public:
+    static bool cook(const TextureRecipe& recipe);
+    // output missing, unreadable or older than one of the layers
+    static bool needsCook(const TextureRecipe& recipe);
+};
+
+#endif // TEXTURECOOKER_H
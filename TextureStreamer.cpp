@@ -0,0 +1,236 @@
+#include "TextureStreamer.h"
+
+#include <string.h>
+
+#include "Logger.h"
+#include "Timer.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+
+TextureStreamer::TextureStreamer(GLsizeiptr uploadBudgetPerFrame)
+    : placeholderColor(GL_TEXTURE_2D), placeholderData(GL_TEXTURE_2D), staging(uploadBudgetPerFrame),
+      uploadBudget(uploadBudgetPerFrame), pending(0), quit(false)
+{
+    GPU_MEMORY_OWNER("texture streamer");
+    const uint8_t grey[4] = { 128, 128, 128, 255 };
+    const uint8_t flatNormal[4] = { 128, 128, 255, 255 };
+    placeholderColor.storage2D(1, GL_SRGB8_ALPHA8, 1, 1);
+    placeholderColor.subImage2D(0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    placeholderData.storage2D(1, GL_RGBA8, 1, 1);
+    placeholderData.subImage2D(0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, flatNormal);
+
+    LOG_INFO("TextureStreamer started, %d KB upload budget per frame", (int)(uploadBudgetPerFrame / 1024));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // queued decodes still reference this, they return early once quit is set
+    quit = true;
+    for (size_t i = 0; i < entries.size(); i++)
+        JobSystem::Wait(entries[i]->decode);
+}
+
+TextureHandle TextureStreamer::load(const char* path, TextureUsage usage)
+{
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->path = path;
+    entry->usage = usage;
+    entry->format = (usage == TEXTURE_COLOR) ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    entry->width = entry->height = entry->levels = 0;
+    entry->uploadLevel = 0;
+    entry->uploadRow = 0;
+    entry->resident = false;
+    entry->requestTime = Timer::getAppRunTime();
+    entries.push_back(std::move(entry));
+
+    TextureHandle handle = (TextureHandle)entries.size() - 1;
+    pending++;
+
+    std::string file = path;
+    bool srgb = (usage == TEXTURE_COLOR);
+    entries.back()->decode = JobSystem::Run([this, handle, file, srgb] { decode(handle, file, srgb); }, JOB_PRIORITY_BACKGROUND);
+    return handle;
+}
+
+GLuint TextureStreamer::get(TextureHandle handle) const
+{
+    const Entry& entry = *entries[handle];
+    if (entry.resident)
+        return entry.texture->ID;
+    return (entry.usage == TEXTURE_COLOR) ? placeholderColor.ID : placeholderData.ID;
+}
+
+bool TextureStreamer::isResident(TextureHandle handle) const
+{
+    return entries[handle]->resident;
+}
+
+int TextureStreamer::pendingCount() const
+{
+    return pending;
+}
+
+void TextureStreamer::update()
+{
+    GPU_MEMORY_OWNER("texture streamer");
+
+    // collect whatever the workers finished since last frame
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        while (!finished.empty())
+        {
+            Entry& entry = *entries[finished.front().first];
+            entry.image = std::move(finished.front().second);
+            finished.pop_front();
+
+            if (!entry.image)
+            {
+                LOG_ERROR("Texture %s failed to decode, keeping placeholder", entry.path.c_str());
+                pending--;
+                continue;
+            }
+
+            entry.width = entry.image->width;
+            entry.height = entry.image->height;
+            entry.levels = entry.image->levelCount();
+            entry.texture.reset(new GLTexture(GL_TEXTURE_2D));
+            entry.texture->storage2D(entry.levels, entry.format, entry.width, entry.height);
+            setSampling(*entry.texture);
+        }
+    }
+
+    if (pending == 0)
+        return;
+
+    staging.beginFrame();
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer.ID);
+
+    GLsizeiptr budget = uploadBudget;
+    for (size_t i = 0; i < entries.size() && budget > 0; i++)
+    {
+        Entry& entry = *entries[i];
+        if (!entry.image)
+            continue;
+
+        if (uploadSome(entry, budget))
+        {
+            entry.resident = true;
+            entry.image.reset();
+            pending--;
+            LOG_INFO("Texture %s resident after %.3f seconds", entry.path.c_str(), Timer::getAppRunTime() - entry.requestTime);
+        }
+    }
+
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    staging.endFrame();
+}
+
+uint64_t TextureStreamer::trim(uint64_t bytes)
+{
+    GPU_MEMORY_OWNER("texture streamer");
+
+    uint64_t freed = 0;
+    while (freed < bytes)
+    {
+        Entry* largest = NULL;
+        uint64_t largestBytes = 0;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            Entry& entry = *entries[i];
+            if (!entry.resident || entry.levels <= 1 || (entry.width < entry.height ? entry.width : entry.height) / 2 < TEXTURE_TRIM_MIN_SIZE)
+                continue;
+            uint64_t size = GpuMemory::TextureBytes(entry.format, entry.width, entry.height, 1, entry.levels, false);
+            if (size > largestBytes)
+            {
+                largest = &entry;
+                largestBytes = size;
+            }
+        }
+        if (largest == NULL)
+            break;
+
+        // the remaining levels are already resident, copy them down instead of re-decoding
+        Entry& entry = *largest;
+        int width = entry.width / 2;
+        int height = entry.height / 2;
+        int levels = entry.levels - 1;
+        std::unique_ptr<GLTexture> smaller(new GLTexture(GL_TEXTURE_2D));
+        smaller->storage2D(levels, entry.format, width, height);
+        setSampling(*smaller);
+        for (int level = 0; level < levels; level++)
+        {
+            int levelWidth = (width >> level) > 0 ? (width >> level) : 1;
+            int levelHeight = (height >> level) > 0 ? (height >> level) : 1;
+            glCopyImageSubData(entry.texture->ID, GL_TEXTURE_2D, level + 1, 0, 0, 0, smaller->ID, GL_TEXTURE_2D, level, 0, 0, 0, levelWidth, levelHeight, 1);
+        }
+        entry.texture = std::move(smaller);
+        entry.width = width;
+        entry.height = height;
+        entry.levels = levels;
+
+        freed += largestBytes - GpuMemory::TextureBytes(entry.format, width, height, 1, levels, false);
+        LOG_INFO("Texture %s trimmed to %dx%d", entry.path.c_str(), width, height);
+    }
+    return freed;
+}
+
+void TextureStreamer::setSampling(GLTexture& texture)
+{
+    texture.parameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+    texture.parameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+    texture.parameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    texture.parameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameterf(texture.ID, GL_TEXTURE_MAX_ANISOTROPY, 8.0f);
+}
+
+// upload row bands of the remaining levels until the budget runs out,
+// returns true once the last level is in
+bool TextureStreamer::uploadSome(Entry& entry, GLsizeiptr& budget)
+{
+    const Image& image = *entry.image;
+    int levels = image.levelCount();
+
+    while (entry.uploadLevel < levels)
+    {
+        int width = image.levelWidth(entry.uploadLevel);
+        int height = image.levelHeight(entry.uploadLevel);
+
+        GLsizeiptr rowBytes = (GLsizeiptr)width * 4;
+        int rows = (int)(budget / rowBytes);
+        if (rows <= 0)
+            return false;
+        if (rows > height - entry.uploadRow)
+            rows = height - entry.uploadRow;
+
+        const uint8_t* source = image.level(entry.uploadLevel) + (size_t)entry.uploadRow * rowBytes;
+        StreamBuffer::Allocation allocation = staging.write(source, rowBytes * rows, 4);
+        if (allocation.ptr == NULL)
+            return false;
+
+        entry.texture->subImage2D(entry.uploadLevel, 0, entry.uploadRow, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)allocation.offset);
+        budget -= rowBytes * rows;
+
+        entry.uploadRow += rows;
+        if (entry.uploadRow >= height)
+        {
+            entry.uploadRow = 0;
+            entry.uploadLevel++;
+        }
+    }
+    return true;
+}
+
+void TextureStreamer::decode(TextureHandle handle, const std::string& path, bool srgb)
+{
+    if (quit)
+        return;
+
+    std::unique_ptr<Image> image(new Image());
+    if (image->load(path))
+        image->buildMipChain(srgb);
+    else
+        image.reset();
+
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    finished.emplace_back(handle, std::move(image));
+}
@@ -0,0 +1,98 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <windows.h>
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+#include "GLObjects.h"
+#include "StreamBuffer.h"
+#include "Image.h"
+#include "JobSystem.h"
+
+enum TextureUsage
+{
+    TEXTURE_COLOR,  // sRGB albedo, grey placeholder
+    TEXTURE_DATA    // linear (normal / dudv maps), flat-normal placeholder
+};
+
+typedef int TextureHandle;
+
+// trim() never shrinks a texture below this on its smaller side
+#define TEXTURE_TRIM_MIN_SIZE 256
+
+// Loads textures without blocking the render thread. Background jobs on the
+// JobSystem decode the file (WIC) and build the full mip chain on the CPU;
+// update() on the GL
+// thread then copies finished levels into a persistent-mapped pixel unpack
+// buffer and issues glTextureSubImage2D from it, never more than
+// uploadBudget bytes per frame. Until every level is resident get() returns a
+// shared 1x1 placeholder so callers can bind unconditionally.
+class TextureStreamer
+{
+public:
+    // needs JobSystem::Init() first, decoding runs on its workers
+    TextureStreamer(GLsizeiptr uploadBudgetPerFrame = 8 * 1024 * 1024);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // queue a file for decoding, returns immediately
+    TextureHandle load(const char* path, TextureUsage usage);
+    // texture to bind for this handle right now
+    GLuint get(TextureHandle handle) const;
+    bool isResident(TextureHandle handle) const;
+    // GL thread, once per frame: upload decoded data within the byte budget
+    void update();
+    // textures requested but not yet resident
+    int pendingCount() const;
+    // memory pressure: drop the top mip of the largest resident textures until
+    // at least bytes are released (copied down on the GPU), returns bytes freed
+    uint64_t trim(uint64_t bytes);
+
+private:
+    struct Entry
+    {
+        std::string path;
+        TextureUsage usage;
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<Image> image;    // owned by the GL thread once decoded
+        GLenum format;
+        int width;
+        int height;
+        int levels;
+        int uploadLevel;
+        int uploadRow;
+        bool resident;
+        double requestTime;
+        JobHandle decode;
+    };
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    GLTexture placeholderColor;
+    GLTexture placeholderData;
+    StreamBuffer staging;
+    GLsizeiptr uploadBudget;
+    int pending;
+
+    // job side
+    std::deque<std::pair<TextureHandle, std::unique_ptr<Image>>> finished;   // NULL image = decode failed
+    std::mutex finishedMutex;
+    std::atomic<bool> quit;
+
+    void decode(TextureHandle handle, const std::string& path, bool srgb);
+    bool uploadSome(Entry& entry, GLsizeiptr& budget);
+    static void setSampling(GLTexture& texture);
+};
+
+#endif // TEXTURESTREAMER_H
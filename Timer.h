@@ -2,9 +2,14 @@
 #define TIMER_H
 
 #include <chrono>
-#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 
+// distinct TIMER_INIT phases kept; phase names are kept by pointer and must be string literals
+#define TIMER_MAX_INIT_PHASES 32
+
 
 class Timer {
 private:
@@ -18,7 +23,9 @@ private:
         m_FramesPerSecond(0.0),
         m_SecondsPerFrame(0.0),
         m_TimeScale(1.0),
-        m_InitStartTime(m_StartTime)
+        m_InitStartTime(m_StartTime),
+        m_CurrentInitPhase(nullptr),
+        m_InitPhaseCount(0)
     {}
 
     // Delete copy constructor and assignment
@@ -65,11 +72,13 @@ public:
         timer.m_FrameCount = 0;
         timer.m_FramesPerSecond = 0.0;
         timer.m_SecondsPerFrame = 0.0;
-        timer.m_InitializationTimes.clear();
+        std::lock_guard<std::mutex> lock(timer.m_InitMutex);
+        timer.m_InitPhaseCount = 0;
     }
 
-    // Initialization timing methods
-    static void StartInit(const std::string& phase) noexcept {
+    // Initialization timing methods; StartInit/EndInit time one phase at a
+    // time on one thread, phases timed elsewhere come in through RecordInit
+    static void StartInit(const char* phase) noexcept {
         auto& timer = Get();
         timer.m_InitStartTime = std::chrono::high_resolution_clock::now();
         timer.m_CurrentInitPhase = phase;
@@ -78,23 +87,56 @@ public:
     static void EndInit() noexcept {
         auto& timer = Get();
         auto currentTime = std::chrono::high_resolution_clock::now();
-        double duration = std::chrono::duration<double>(currentTime - timer.m_InitStartTime).count();
-        timer.m_InitializationTimes[timer.m_CurrentInitPhase] = duration;
+        double start = std::chrono::duration<double>(timer.m_InitStartTime - timer.m_StartTime).count();
+        double end = std::chrono::duration<double>(currentTime - timer.m_StartTime).count();
+        RecordInit(timer.m_CurrentInitPhase, start, end);
+    }
+
+    // Seconds since the timer was created, the time base of the init timeline
+    [[nodiscard]] static double GetTimeSinceStart() noexcept {
+        auto& timer = Get();
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - timer.m_StartTime).count();
+    }
+
+    // Record a phase measured on any thread, start and end from GetTimeSinceStart()
+    static void RecordInit(const char* phase, double start, double end) noexcept {
+        auto& timer = Get();
+        std::lock_guard<std::mutex> lock(timer.m_InitMutex);
+        InitPhase* found = timer.FindInitPhase(phase);
+        if (!found && phase && timer.m_InitPhaseCount < TIMER_MAX_INIT_PHASES) {
+            found = &timer.m_InitPhases[timer.m_InitPhaseCount++];
+            found->name = phase;
+        }
+        if (found) {
+            found->start = start;
+            found->seconds = end - start;
+        }
     }
 
     // Get initialization time for a specific phase
-    [[nodiscard]] static double GetInitTime(const std::string& phase) noexcept {
+    [[nodiscard]] static double GetInitTime(const char* phase) noexcept {
+        auto& timer = Get();
+        std::lock_guard<std::mutex> lock(timer.m_InitMutex);
+        const InitPhase* found = timer.FindInitPhase(phase);
+        return found ? found->seconds : 0.0;
+    }
+
+    // When a phase started on the init timeline
+    [[nodiscard]] static double GetInitStart(const char* phase) noexcept {
         auto& timer = Get();
-        auto it = timer.m_InitializationTimes.find(phase);
-        return (it != timer.m_InitializationTimes.end()) ? it->second : 0.0;
+        std::lock_guard<std::mutex> lock(timer.m_InitMutex);
+        const InitPhase* found = timer.FindInitPhase(phase);
+        return found ? found->start : 0.0;
     }
 
-    // Get total initialization time
+    // Get total initialization time: the sum of the phases, more than the
+    // elapsed time when phases ran in parallel
     [[nodiscard]] static double GetTotalInitTime() noexcept {
         auto& timer = Get();
+        std::lock_guard<std::mutex> lock(timer.m_InitMutex);
         double total = 0.0;
-        for (const auto& [phase, time] : timer.m_InitializationTimes) {
-            total += time;
+        for (int i = 0; i < timer.m_InitPhaseCount; i++) {
+            total += timer.m_InitPhases[i].seconds;
         }
         return total;
     }
@@ -128,6 +170,25 @@ public:
     static void SetTimeScale(double scale) noexcept { Get().m_TimeScale = scale; }
 
 private:
+    struct InitPhase {
+        const char* name;
+        double start;
+        double seconds;
+    };
+
+    // Phases are few, a linear search beats hashing a string; m_InitMutex held
+    InitPhase* FindInitPhase(const char* phase) noexcept {
+        if (!phase) {
+            return nullptr;
+        }
+        for (int i = 0; i < m_InitPhaseCount; i++) {
+            if (m_InitPhases[i].name == phase || strcmp(m_InitPhases[i].name, phase) == 0) {
+                return &m_InitPhases[i];
+            }
+        }
+        return nullptr;
+    }
+
     // Runtime performance members
     std::chrono::high_resolution_clock::time_point m_StartTime;
     std::chrono::high_resolution_clock::time_point m_LastTime;
@@ -141,8 +202,10 @@ private:
 
     // Initialization timing members
     std::chrono::high_resolution_clock::time_point m_InitStartTime;
-    std::string m_CurrentInitPhase;
-    std::unordered_map<std::string, double> m_InitializationTimes;
+    const char* m_CurrentInitPhase;
+    InitPhase m_InitPhases[TIMER_MAX_INIT_PHASES];
+    int m_InitPhaseCount;
+    std::mutex m_InitMutex;
 };
 
 
@@ -152,6 +215,8 @@ private:
 #define TIMER_END() Timer::EndInit()
 #define TIMER_GET(phase) Timer::GetInitTime(phase)
 #define TIMER_TOTAL_INIT() Timer::GetTotalInitTime()
+#define TIMER_RECORD(phase, start, end) Timer::RecordInit(phase, start, end)
+#define TIMER_NOW() Timer::GetTimeSinceStart()
 #define TIMER_TICK() Timer::Tick()
 #define TIMER_DELTA() Timer::GetDeltaTime()
 #define TIMER_FPS() Timer::GetFramesPerSecond()
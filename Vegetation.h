@@ -0,0 +1,163 @@
+#pragma once
+#ifndef VEGETATION_H
+#define VEGETATION_H
+
+#include <GL/glew.h>
+#include <gl/GL.h>
+#include <glm/glm.hpp>
+
+#include <math.h>
+
+#include "Shader.h"
+#include "Frustum.h"
+#include "GLObjects.h"
+#include "GLState.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+
+// SSBO binding points shared with shaders/vegetation_scatter.comp and shaders/grass.vs
+#define VEGETATION_BLADES_BINDING 5
+#define VEGETATION_COMMANDS_BINDING 6
+
+// tiles per side of the grid scattered around the camera, and their size in world units
+#define VEGETATION_GRID 32
+#define VEGETATION_TILE_SIZE 4.0f
+// candidates per tile at full density, a multiple of the scatter workgroup size
+#define VEGETATION_BLADES_PER_TILE 2048
+// blades each LOD region holds, the scatter stops counting there
+#define VEGETATION_LOD_CAPACITY (512 * 1024)
+#define VEGETATION_NEAR_DISTANCE 24.0f
+#define VEGETATION_FAR_DISTANCE 60.0f
+#define VEGETATION_MAX_BLADE_HEIGHT 0.6f
+// triangle strip vertices per blade: three segments near, a single triangle far
+#define VEGETATION_NEAR_VERTICES 7
+#define VEGETATION_FAR_VERTICES 3
+
+// terrain shape as the terrain shaders see it (see terrain.tes / terrain.frag)
+struct TerrainShape
+{
+    glm::vec3 seed;
+    float baseHeight;       // world height of the undisplaced terrain
+    float dispFactor;
+    float frequency;
+    int octaves;
+    float power;
+    float grassCoverage;    // minimum cos of the slope that still gets grass
+    float shoreHeight;      // water level plus the sand band
+};
+
+// Procedural grass placed entirely on the GPU. Every frame
+// vegetation_scatter.comp walks a VEGETATION_GRID^2 tile grid centred on the
+// camera, one workgroup per tile: the tile is frustum tested as a box, its
+// density fades with distance, and candidate blades that pass the terrain's
+// grass rules are appended to the near or far LOD region of the blade
+// buffer, counting themselves into that LOD's indirect command. draw() is a
+// single glMultiDrawArraysIndirect over both LODs; grass.vs builds the
+// blades from gl_VertexID, so there is no vertex data and no readback.
+class Vegetation
+{
+public:
+    struct DrawArraysIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    // std430 layout, must match Blade in the shaders
+    struct BladeData
+    {
+        glm::vec4 position;
+        glm::vec4 shape;
+    };
+
+    Vegetation()
+        : scatterShader("shaders/vegetation_scatter.comp"), shader("shaders/grass.vs", "shaders/camera.fs"),
+          depthShader("shaders/grass.vs", "shaders/depth_only.fs")
+    {
+        const DrawArraysIndirectCommand lods[2] =
+        {
+            { VEGETATION_NEAR_VERTICES, 0, 0, 0 },
+            { VEGETATION_FAR_VERTICES, 0, 0, VEGETATION_LOD_CAPACITY }
+        };
+        blades.storage(2 * VEGETATION_LOD_CAPACITY * sizeof(BladeData), NULL, 0);
+        commandTemplate.storage(sizeof(lods), lods, 0);
+        commandBuffer.storage(sizeof(lods), lods, 0);
+    }
+
+    Vegetation(const Vegetation&) = delete;
+    Vegetation& operator=(const Vegetation&) = delete;
+
+    // scatter this frame's blades for the view, GPU only
+    // ------------------------------------------------------------------------
+    void update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, const TerrainShape& terrain)
+    {
+        // reset instanceCount of both LODs from the template
+        commandTemplate.copyTo(commandBuffer, 0, 0, 2 * sizeof(DrawArraysIndirectCommand));
+
+        Frustum frustum = Frustum::FromMatrix(viewProjection);
+        int originX = (int)floorf(cameraPosition.x / VEGETATION_TILE_SIZE) - VEGETATION_GRID / 2;
+        int originZ = (int)floorf(cameraPosition.z / VEGETATION_TILE_SIZE) - VEGETATION_GRID / 2;
+
+        scatterShader.use();
+        glProgramUniform4fv(scatterShader.ID, glGetUniformLocation(scatterShader.ID, "u_frustumPlanes"), 6, &frustum.planes[0][0]);
+        scatterShader.setVec3("u_cameraPosition", cameraPosition);
+        glProgramUniform2i(scatterShader.ID, glGetUniformLocation(scatterShader.ID, "u_tileOrigin"), originX, originZ);
+        scatterShader.setFloat("u_tileSize", VEGETATION_TILE_SIZE);
+        glProgramUniform1ui(scatterShader.ID, glGetUniformLocation(scatterShader.ID, "u_bladesPerTile"), VEGETATION_BLADES_PER_TILE);
+        scatterShader.setFloat("u_nearDistance", VEGETATION_NEAR_DISTANCE);
+        scatterShader.setFloat("u_farDistance", VEGETATION_FAR_DISTANCE);
+        glProgramUniform1ui(scatterShader.ID, glGetUniformLocation(scatterShader.ID, "u_lodCapacity"), VEGETATION_LOD_CAPACITY);
+        scatterShader.setFloat("u_maxBladeHeight", VEGETATION_MAX_BLADE_HEIGHT);
+
+        scatterShader.setVec3("seed", terrain.seed);
+        scatterShader.setFloat("gDispFactor", terrain.dispFactor);
+        scatterShader.setFloat("freq", terrain.frequency);
+        scatterShader.setInt("octaves", terrain.octaves);
+        scatterShader.setFloat("power", terrain.power);
+        scatterShader.setFloat("u_baseHeight", terrain.baseHeight);
+        // every octave's noise is below 1, so the sum stays below dispFactor
+        scatterShader.setFloat("u_heightRange", powf(terrain.dispFactor, terrain.power));
+        scatterShader.setFloat("u_grassCoverage", terrain.grassCoverage);
+        scatterShader.setFloat("u_shoreHeight", terrain.shoreHeight);
+
+        bindStorage();
+        glDispatchCompute(VEGETATION_GRID, VEGETATION_GRID, 1);
+        Profiler::CountDispatch();
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    // both LODs in one multi-draw; blades are seen from both sides
+    // depthOnly draws the same blades for the depth prepass
+    // ------------------------------------------------------------------------
+    void draw(bool depthOnly = false)
+    {
+        if (depthOnly)
+            depthShader.use();
+        else
+            shader.use();
+        bindStorage();
+        GLState::BindVertexArray(vao.ID);
+        GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.ID);
+        glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)0, 2, 0);
+        Profiler::CountDraw();
+    }
+
+private:
+    Shader scatterShader;
+    Shader shader;
+    Shader depthShader;
+    GLVertexArray vao;
+    GLBuffer blades;            // near LOD region, then far LOD region
+    GLBuffer commandBuffer;
+    GLBuffer commandTemplate;
+
+    void bindStorage()
+    {
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, VEGETATION_BLADES_BINDING, blades.ID);
+        GLState::BindBufferBase(GL_SHADER_STORAGE_BUFFER, VEGETATION_COMMANDS_BINDING, commandBuffer.ID);
+    }
+};
+
+
+#endif
@@ -19,62 +19,13 @@ WindowManager::WindowManager() {
     currentInstance = GetModuleHandle(NULL);
     windowHandle = NULL;
     renderingContext = NULL;
+    loaderContext = NULL;
     deviceContext = NULL;
     isRunning = FALSE;
 };
 
 WindowManager::~WindowManager() {};
 
-bool WindowManager:: initialize() 
-{
-    if (!currentInstance) 
-    {
-        LOG_ERROR("Current Instance NULL");
-        return false;
-    }
-    else 
-    {
-        LOG_INFO("Current Instance Valid");
-    }
-
-
-    TIMER_INIT("Win32");
-    if (!initializeWin32())  
-    {
-        LOG_ERROR("Failed to initialize Win32 Window.\n");
-        TIMER_END();
-        return false;
-    }
-    else 
-    { 
-        TIMER_END(); 
-        LOG_INFO("initializeWin32 Initialized in %.6f seconds", TIMER_GET("Win32")); 
-    }
-
-
-    TIMER_INIT("OpenGL");
-    if (!initializeOpenGL()) 
-    {
-        LOG_ERROR("Failed to initialize OpenGL.\n");
-        TIMER_END();
-        return false;
-    }
-    else 
-    { 
-        TIMER_END(); 
-        LOG_INFO("OpenGL Initialized in %.6f seconds", TIMER_GET("OpenGL")); 
-    }
-   
-    /*
-    if (!initializeImGUI()) 
-    {
-        LOG_ERROR("Failed to initialize ImGUI.\n");
-        return false;
-    */
-
-    return true;
-}
-
 ATOM WindowManager::MyRegisterClass()
 {
     WNDCLASSEXW wcex;
@@ -113,6 +64,17 @@ BOOL WindowManager::InitInstance()
     return TRUE;
 }
 
+// the loader context is handed to the startup loader by RenderInit; when
+// that never ran (no context made current, no render thread) it is freed here
+void WindowManager::releaseLoaderContext()
+{
+    if (loaderContext != NULL)
+    {
+        wglDeleteContext(loaderContext);
+        loaderContext = NULL;
+    }
+}
+
 void WindowManager::uninitialize() {
 
    LOG_INFO("Window handle found to be NULL after createWindow");
@@ -128,6 +90,12 @@ bool WindowManager::initializeWin32() {
     MONITORINFO mi = { sizeof(MONITORINFO) };
     DWORD dwStyle = 0;
     WINDOWPLACEMENT wpPrev = { sizeof(WINDOWPLACEMENT) };
+    if (!currentInstance)
+    {
+        LOG_ERROR("Current Instance NULL");
+        return false;
+    }
+
     // Initialize global strings
     MyRegisterClass();
 
@@ -258,6 +226,13 @@ bool WindowManager::initializeOpenGL() {
 
     // Create modern OpenGL context
     renderingContext = wglCreateContextAttribsARB(deviceContext, NULL, contextAttribs);
+    // a second context in the same share group lets startup build programs on another thread
+    if (renderingContext != NULL)
+    {
+        loaderContext = wglCreateContextAttribsARB(deviceContext, renderingContext, contextAttribs);
+        if (loaderContext == NULL)
+            LOG_INFO("No shared loader context, startup GL work stays on the render thread");
+    }
 
     // Delete temporary context
     wglMakeCurrent(NULL, NULL);
@@ -13,13 +13,14 @@ class WindowManager
 		HWND windowHandle;
 		HINSTANCE currentInstance;
 		HGLRC renderingContext;
+		HGLRC loaderContext;	// shares objects with renderingContext, for a startup loader thread; NULL if unavailable
 		HDC deviceContext;
 		BOOL isRunning;
 		
 		WindowManager();
 		~WindowManager();
-		bool initialize();
 		void uninitialize();
+		void releaseLoaderContext();
 		void bind();
 		void swapDisplayBuffer();
 		bool initializeWin32(); 
@@ -18,7 +18,7 @@ enum Camera_Movement {
 // Default camera values
 const float YAW = -90.0f;
 const float PITCH = 0.0f;
-const float SPEED = 2000.f;
+const float SPEED = 5.0f;		// units per second
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 60.0f;
 const float MAX_FOV = 100.0f;
@@ -62,12 +62,20 @@ public:
 	}
 
 	// Returns the view matrix calculated using Euler Angles and the LookAt Matrix
+	// (the direction vectors are kept current whenever the angles change)
 	glm::mat4 GetViewMatrix()
 	{
-		updateCameraVectors();
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// Sets the Euler angles directly and refreshes the direction vectors
+	void SetOrientation(float yaw, float pitch)
+	{
+		Yaw = yaw;
+		Pitch = pitch;
+		updateCameraVectors();
+	}
+
 	// Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
@@ -0,0 +1,25 @@
+#version 460 core 
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec4 aCol;
+layout (location = 2) in mat4 aModel;
+		
+out vec4 oColor; 
+invariant gl_Position;
+
+// per-frame data streamed through the persistent ring buffer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 uViewProjection;
+	mat4 uView;
+	mat4 uProjection;
+	vec4 uCameraPosition;
+	vec4 uTime;		// x = seconds since start, y = delta time
+	mat4 uInverseView;
+	mat4 uInverseProjection;
+};
+
+void main(void) 
+{ 
+	gl_Position = uViewProjection * aModel * aPos; 
+	oColor = aCol; 
+}
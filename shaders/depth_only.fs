@@ -0,0 +1,9 @@
+#version 460 core
+
+// depth prepass, paired with the scene's vertex shaders: no color output,
+// the fragment only exists to write depth. Those vertex shaders declare
+// gl_Position invariant so this pass and the GL_EQUAL shading pass after it
+// compute bit-identical depth
+void main(void)
+{
+}
@@ -0,0 +1,37 @@
+#version 460 core 
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec4 aCol;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uvec4 meshId;
+};
+
+layout(std430, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+layout(std430, binding = 2) readonly buffer Visible { uint visibleIds[]; };
+		
+out vec4 oColor; 
+invariant gl_Position;
+
+// per-frame data streamed through the persistent ring buffer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 uViewProjection;
+	mat4 uView;
+	mat4 uProjection;
+	vec4 uCameraPosition;
+	vec4 uTime;		// x = seconds since start, y = delta time
+	mat4 uInverseView;
+	mat4 uInverseProjection;
+};
+
+void main(void) 
+{ 
+	// each draw's instances sit at its baseInstance in the compacted id list
+	uint id = visibleIds[gl_BaseInstance + gl_InstanceID];
+	gl_Position = uViewProjection * objects[id].model * aPos; 
+	oColor = aCol; 
+}
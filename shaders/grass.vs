@@ -0,0 +1,64 @@
+#version 460 core
+
+/*
+	Grass blades built from gl_VertexID, no vertex buffer. Draw 0 is the near
+	LOD (three segments, 7 strip vertices), draw 1 the far LOD (one
+	triangle); each reads its blades from its region of the buffer that
+	vegetation_scatter.comp filled, starting at gl_BaseInstance.
+*/
+
+struct Blade
+{
+	vec4 position;	// xyz root, w height
+	vec4 shape;		// x facing angle, y bend, z width, w colour variation
+};
+
+layout(std430, binding = 5) readonly buffer Blades { Blade blades[]; };
+
+out vec4 oColor;
+invariant gl_Position;
+
+// per-frame data streamed through the persistent ring buffer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 uViewProjection;
+	mat4 uView;
+	mat4 uProjection;
+	vec4 uCameraPosition;
+	vec4 uTime;		// x = seconds since start, y = delta time
+	mat4 uInverseView;
+	mat4 uInverseProjection;
+};
+
+void main(void)
+{
+	Blade blade = blades[gl_BaseInstance + gl_InstanceID];
+	int segments = gl_DrawID == 0 ? 3 : 1;
+
+	// pairs of vertices up the blade, the last one is the tip
+	int level = gl_VertexID / 2;
+	float t = float(level) / float(segments);
+	float side = (gl_VertexID & 1) == 0 ? -1.0 : 1.0;
+	if (gl_VertexID == segments * 2)
+		side = 0.0;
+
+	float angle = blade.shape.x;
+	vec3 facing = vec3(cos(angle), 0.0, sin(angle));
+	vec3 right = vec3(-facing.z, 0.0, facing.x);
+
+	float sway = sin(uTime.x * 1.7 + blade.position.x * 0.35 + blade.position.z * 0.25) * 0.12;
+	float bend = (blade.shape.y + sway) * t * t;
+
+	vec3 position = blade.position.xyz
+		+ right * side * blade.shape.z * (1.0 - t)
+		+ vec3(0.0, blade.position.w * t, 0.0)
+		+ facing * bend * blade.position.w;
+	gl_Position = uViewProjection * vec4(position, 1.0);
+
+	// two-sided lambert on the blade's facing, darker at the root
+	vec3 normal = normalize(facing - vec3(0.0, bend, 0.0));
+	float diffuse = abs(dot(normal, normalize(vec3(0.4, 1.0, 0.3))));
+	vec3 root = vec3(0.05, 0.16, 0.03);
+	vec3 tip = mix(vec3(0.30, 0.55, 0.12), vec3(0.45, 0.55, 0.15), blade.shape.w);
+	oColor = vec4(mix(root, tip, t) * (0.35 + 0.65 * diffuse), 1.0);
+}
@@ -0,0 +1,32 @@
+#version 460 core
+layout (location = 0) in vec4 aPos;			// unorm16 in [0, 1], uModel maps it onto the mesh bounds
+layout (location = 1) in vec4 aNormal;		// snorm 10:10:10:2
+layout (location = 2) in vec2 aTexCoord;	// half float
+
+out vec4 oColor;
+invariant gl_Position;
+
+// per-frame data streamed through the persistent ring buffer
+layout(std140, binding = 0) uniform FrameData
+{
+	mat4 uViewProjection;
+	mat4 uView;
+	mat4 uProjection;
+	vec4 uCameraPosition;
+	vec4 uTime;		// x = seconds since start, y = delta time
+	mat4 uInverseView;
+	mat4 uInverseProjection;
+};
+
+uniform mat4 uModel;
+uniform mat3 uNormalMatrix;
+uniform vec4 uDiffuse;
+
+void main(void)
+{
+	gl_Position = uViewProjection * uModel * vec4(aPos.xyz, 1.0);
+
+	vec3 normal = normalize(uNormalMatrix * aNormal.xyz);
+	float diffuse = max(dot(normal, normalize(vec3(0.4, 1.0, 0.3))), 0.0);
+	oColor = vec4(uDiffuse.rgb * (0.25 + 0.75 * diffuse), uDiffuse.a);
+}
@@ -1,12 +1,20 @@
-#version 330 core
+#version 460 core
 in vec2 TexCoords;
+in vec4 TextColor;
 out vec4 color;
 
 uniform sampler2D text;
-uniform vec3 textColor;
+uniform bool uDistanceField;
 
 void main()
-{    
-    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-    color = vec4(textColor, 1.0) * sampled;
-}  
\ No newline at end of file
+{
+    float sampled = texture(text, TexCoords).r;
+    float alpha = sampled;
+    if (uDistanceField)
+    {
+        // 0.5 is the outline; ramp over one screen pixel at any scale
+        float width = max(fwidth(sampled), 1e-4);
+        alpha = clamp((sampled - 0.5) / width + 0.5, 0.0, 1.0);
+    }
+    color = vec4(TextColor.rgb, TextColor.a * alpha);
+}
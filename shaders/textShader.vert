@@ -1,6 +1,8 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
+layout (location = 1) in vec4 color;
 out vec2 TexCoords;
+out vec4 TextColor;
 
 uniform mat4 projection;
 
@@ -8,4 +10,5 @@ void main()
 {
     gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
     TexCoords = vertex.zw;
-}  
\ No newline at end of file
+    TextColor = color;
+}